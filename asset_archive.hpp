@@ -0,0 +1,183 @@
+#ifndef ASSET_ARCHIVE_HPP
+#define ASSET_ARCHIVE_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include "mapped_file.hpp"
+
+// Packed asset archive written by nexyl-cook.
+// Layout: ArchiveHeader, then every entry's data aligned to ARCHIVE_ALIGNMENT, then the index
+// (ArchiveEntry records followed by the name strings). Entries are sorted by name.
+
+enum AssetType : uint32_t {
+    ASSET_RAW = 0,
+    ASSET_TEXTURE = 1, // DDS blob (BCn with mips)
+    ASSET_MESH = 2,    // Mesh blob, see mesh_data.hpp
+    ASSET_SHADER = 3   // GLSL with #include already expanded
+};
+
+static const uint32_t ARCHIVE_MAGIC = 0x5241584E; // "NXAR"
+static const uint32_t ARCHIVE_VERSION = 1;
+static const uint64_t ARCHIVE_ALIGNMENT = 256;    // Keeps slices usable as GL buffer offsets
+
+struct ArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t indexOffset;
+    uint64_t indexSize;
+};
+
+struct ArchiveEntry {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t type;
+    uint32_t nameOffset; // Into the name table that follows the entries
+    uint32_t nameLength;
+    uint32_t reserved;
+};
+
+// Bytes of one entry inside the mapped archive
+struct AssetSlice {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    AssetType type = ASSET_RAW;
+};
+
+// Collects entries in memory and writes the archive in one go
+class AssetArchiveWriter {
+private:
+    struct Pending {
+        std::string name;
+        AssetType type;
+        std::vector<unsigned char> data;
+    };
+    std::vector<Pending> entries;
+
+public:
+    void add(const std::string& name, AssetType type, std::vector<unsigned char>&& data) {
+        entries.push_back({ name, type, std::move(data) });
+    }
+
+    size_t getEntryCount() const {
+        return entries.size();
+    }
+
+    bool write(const std::string& path) {
+        std::sort(entries.begin(), entries.end(), [](const Pending& a, const Pending& b) { return a.name < b.name; });
+        FILE* file = fopen(path.c_str(), "wb");
+        if (!file) {
+            printf("Failed to create archive: %s\n", path.c_str());
+            return false;
+        }
+        ArchiveHeader header = {};
+        header.magic = ARCHIVE_MAGIC;
+        header.version = ARCHIVE_VERSION;
+        header.entryCount = (uint32_t)entries.size();
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+        std::vector<ArchiveEntry> index;
+        std::string names;
+        uint64_t offset = sizeof(header);
+        static const unsigned char zeros[ARCHIVE_ALIGNMENT] = {};
+        for (const auto& entry : entries) {
+            uint64_t aligned = (offset + ARCHIVE_ALIGNMENT - 1) / ARCHIVE_ALIGNMENT * ARCHIVE_ALIGNMENT;
+            ok = ok && fwrite(zeros, 1, aligned - offset, file) == aligned - offset;
+            ok = ok && fwrite(entry.data.data(), 1, entry.data.size(), file) == entry.data.size();
+            index.push_back({ aligned, entry.data.size(), entry.type, (uint32_t)names.size(), (uint32_t)entry.name.size(), 0 });
+            names += entry.name;
+            offset = aligned + entry.data.size();
+        }
+        header.indexOffset = offset;
+        header.indexSize = index.size() * sizeof(ArchiveEntry) + names.size();
+        ok = ok && fwrite(index.data(), sizeof(ArchiveEntry), index.size(), file) == index.size();
+        ok = ok && fwrite(names.data(), 1, names.size(), file) == names.size();
+        ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+        fclose(file);
+        if (!ok) {
+            printf("Failed to write archive: %s\n", path.c_str());
+            std::remove(path.c_str());
+        }
+        return ok;
+    }
+};
+
+// Read-only archive mapped into memory. Slices point straight into the mapping and stay valid
+// until close(), so loaders can hand them to GL uploads without an intermediate copy.
+class AssetArchive {
+private:
+    MappedFile file;
+    std::unordered_map<std::string, AssetSlice> slices;
+
+public:
+    ~AssetArchive() {
+        close();
+    }
+
+    bool open(const char* path) {
+        close();
+        if (!file.open(path)) return false;
+        const unsigned char* base = file.data();
+        size_t fileSize = file.size();
+        ArchiveHeader header;
+        bool valid = fileSize >= sizeof(header);
+        if (valid) {
+            memcpy(&header, base, sizeof(header));
+            valid = header.magic == ARCHIVE_MAGIC && header.version == ARCHIVE_VERSION &&
+                    header.indexOffset <= fileSize && header.indexSize <= fileSize - header.indexOffset &&
+                    (uint64_t)header.entryCount * sizeof(ArchiveEntry) <= header.indexSize;
+        }
+        if (!valid) {
+            printf("Invalid asset archive: %s\n", path);
+            close();
+            return false;
+        }
+        const unsigned char* index = base + header.indexOffset;
+        const char* names = (const char*)index + header.entryCount * sizeof(ArchiveEntry);
+        uint64_t namesSize = header.indexSize - header.entryCount * sizeof(ArchiveEntry);
+        for (uint32_t i = 0; i < header.entryCount; i++) {
+            ArchiveEntry entry;
+            memcpy(&entry, index + i * sizeof(ArchiveEntry), sizeof(entry));
+            if (entry.offset > fileSize || entry.size > fileSize - entry.offset ||
+                (uint64_t)entry.nameOffset + entry.nameLength > namesSize) {
+                printf("Corrupt entry %u in asset archive: %s\n", i, path);
+                continue;
+            }
+            AssetSlice slice;
+            slice.data = base + entry.offset;
+            slice.size = (size_t)entry.size;
+            slice.type = (AssetType)entry.type;
+            slices[std::string(names + entry.nameOffset, entry.nameLength)] = slice;
+        }
+        return true;
+    }
+
+    bool isOpen() const {
+        return file.isOpen();
+    }
+
+    // Looks an asset up by its path relative to the cooked source folder ("/" separators)
+    bool find(const std::string& name, AssetSlice& slice) const {
+        auto it = slices.find(name);
+        if (it == slices.end()) return false;
+        slice = it->second;
+        return true;
+    }
+
+    size_t getEntryCount() const {
+        return slices.size();
+    }
+
+    void close() {
+        file.close();
+        slices.clear();
+    }
+};
+
+#endif
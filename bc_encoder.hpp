@@ -0,0 +1,198 @@
+#ifndef BC_ENCODER_HPP
+#define BC_ENCODER_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "image_loader.hpp"
+#include "compressed_texture.hpp"
+
+// CPU block compressor for BC1 (opaque) and BC3 (with alpha). Endpoints come from the
+// principal axis of the block's colours, which is close to what offline tools produce at a
+// fraction of the cost. BC7 is read by the runtime but not produced here.
+
+inline uint16_t packRGB565(const float c[3]) {
+    int r = (int)(c[0] * 31.0f / 255.0f + 0.5f);
+    int g = (int)(c[1] * 63.0f / 255.0f + 0.5f);
+    int b = (int)(c[2] * 31.0f / 255.0f + 0.5f);
+    r = r < 0 ? 0 : (r > 31 ? 31 : r);
+    g = g < 0 ? 0 : (g > 63 ? 63 : g);
+    b = b < 0 ? 0 : (b > 31 ? 31 : b);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void unpackRGB565(uint16_t c, int out[3]) {
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+// 16 RGBA texels in, 8-byte BC1 colour block out (always the 4-colour mode)
+inline void encodeBC1Block(const unsigned char texels[64], unsigned char out[8]) {
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) mean[c] += texels[i * 4 + c];
+    }
+    for (int c = 0; c < 3; c++) mean[c] /= 16.0f;
+
+    float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++) {
+        float r = texels[i * 4] - mean[0], g = texels[i * 4 + 1] - mean[1], b = texels[i * 4 + 2] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+    // Power iteration for the dominant eigenvector
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iter = 0; iter < 8; iter++) {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float length = x * x + y * y + z * z;
+        if (length < 1e-6f) break;
+        length = 1.0f / std::sqrt(length);
+        axis[0] = x * length; axis[1] = y * length; axis[2] = z * length;
+    }
+
+    float minT = 1e9f, maxT = -1e9f;
+    for (int i = 0; i < 16; i++) {
+        float t = (texels[i * 4] - mean[0]) * axis[0] + (texels[i * 4 + 1] - mean[1]) * axis[1] + (texels[i * 4 + 2] - mean[2]) * axis[2];
+        minT = t < minT ? t : minT;
+        maxT = t > maxT ? t : maxT;
+    }
+    float high[3], low[3];
+    for (int c = 0; c < 3; c++) {
+        high[c] = mean[c] + axis[c] * maxT;
+        low[c] = mean[c] + axis[c] * minT;
+    }
+    uint16_t c0 = packRGB565(high), c1 = packRGB565(low);
+    if (c0 < c1) {
+        uint16_t t = c0;
+        c0 = c1;
+        c1 = t;
+    }
+
+    int palette[4][3];
+    unpackRGB565(c0, palette[0]);
+    unpackRGB565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int dr = texels[i * 4] - palette[p][0], dg = texels[i * 4 + 1] - palette[p][1], db = texels[i * 4 + 2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (i * 2);
+        }
+    }
+    memcpy(out, &c0, 2);
+    memcpy(out + 2, &c1, 2);
+    memcpy(out + 4, &indices, 4);
+}
+
+// 16 RGBA texels in, 16-byte BC3 block out: 8-value alpha block followed by a BC1 colour block
+inline void encodeBC3Block(const unsigned char texels[64], unsigned char out[16]) {
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++) {
+        int a = texels[i * 4 + 3];
+        a0 = a > a0 ? a : a0;
+        a1 = a < a1 ? a : a1;
+    }
+    int palette[8] = { a0, a1 };
+    for (int p = 1; p < 7; p++) {
+        palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+    }
+    uint64_t bits = 0;
+    if (a0 != a1) {
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 8; p++) {
+                int error = std::abs(texels[i * 4 + 3] - palette[p]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            bits |= (uint64_t)best << (i * 3);
+        }
+    }
+    out[0] = (unsigned char)a0;
+    out[1] = (unsigned char)a1;
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = (unsigned char)(bits >> (i * 8));
+    }
+    encodeBC1Block(texels, out + 8);
+}
+
+// True if any texel is not fully opaque, i.e. the image needs BC3 instead of BC1
+inline bool imageHasAlpha(const Image& image) {
+    for (size_t i = 3; i < image.pixels.size(); i += 4) {
+        if (image.pixels[i] != 255) return true;
+    }
+    return false;
+}
+
+// Compresses one image; block rows are spread over threadCount threads (0 = all cores).
+// Edge blocks of images that are not a multiple of 4 repeat the last row/column.
+inline void encodeBCImage(const Image& image, BlockFormat format, std::vector<unsigned char>& out, int threadCount = 0) {
+    int blocksX = (image.width + 3) / 4;
+    int blocksY = (image.height + 3) / 4;
+    int blockBytes = blockFormatBytes(format);
+    out.assign((size_t)blocksX * blocksY * blockBytes, 0);
+
+    std::atomic<int> nextRow(0);
+    auto worker = [&]() {
+        unsigned char texels[64];
+        for (int by = nextRow.fetch_add(1); by < blocksY; by = nextRow.fetch_add(1)) {
+            for (int bx = 0; bx < blocksX; bx++) {
+                for (int i = 0; i < 16; i++) {
+                    int x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+                    x = x < image.width ? x : image.width - 1;
+                    y = y < image.height ? y : image.height - 1;
+                    memcpy(&texels[i * 4], &image.pixels[((size_t)y * image.width + x) * 4], 4);
+                }
+                unsigned char* block = &out[((size_t)by * blocksX + bx) * blockBytes];
+                if (format == BLOCK_BC3) encodeBC3Block(texels, block);
+                else encodeBC1Block(texels, block);
+            }
+        }
+    };
+    if (threadCount <= 0) threadCount = (int)std::thread::hardware_concurrency();
+    if (threadCount > blocksY) threadCount = blocksY;
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; i++) threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads) t.join();
+}
+
+// Full mip chain, BC1 for opaque images and BC3 otherwise
+inline void compressImage(const Image& image, CompressedImage& compressed, int threadCount = 0) {
+    std::vector<Image> mips;
+    buildMipChain(image, mips);
+    compressed.format = imageHasAlpha(image) ? BLOCK_BC3 : BLOCK_BC1;
+    compressed.srgb = false;
+    compressed.source = nullptr;
+    compressed.levels.clear();
+    compressed.bytes.clear();
+    std::vector<unsigned char> blocks;
+    for (const auto& mip : mips) {
+        encodeBCImage(mip, compressed.format, blocks, threadCount);
+        compressed.levels.push_back({ mip.width, mip.height, compressed.bytes.size(), blocks.size() });
+        compressed.bytes.insert(compressed.bytes.end(), blocks.begin(), blocks.end());
+    }
+}
+
+#endif
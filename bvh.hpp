@@ -0,0 +1,368 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include "frustum.hpp"
+#include "scene.hpp"
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 dir;
+};
+
+// Box with arbitrary orientation; axes are unit vectors
+struct OrientedBox {
+    glm::vec3 center;
+    glm::vec3 axes[3];
+    glm::vec3 halfExtents;
+    int objectId;
+};
+
+struct BVHHit {
+    float t;
+    int box;          // Index into the boxes passed to build()
+    glm::vec3 normal; // World-space normal of the hit face
+};
+
+// Cubes are unit cubes rotated by X then Y and uniformly scaled (see instanceModelMatrix)
+inline OrientedBox cubeOrientedBox(const SceneObject& obj) {
+    glm::mat4 rotation = glm::mat4(1.0f);
+    rotation = glm::rotate(rotation, glm::radians(obj.rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    rotation = glm::rotate(rotation, glm::radians(obj.rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+    OrientedBox box;
+    box.center = obj.position;
+    for (int i = 0; i < 3; i++) {
+        box.axes[i] = glm::normalize(glm::vec3(rotation[i]));
+    }
+    box.halfExtents = glm::vec3(0.5f * obj.scale);
+    box.objectId = obj.id;
+    return box;
+}
+
+// Slab test in the box frame. Returns entry distance (or exit distance when the origin is inside).
+inline bool intersectOrientedBox(const OrientedBox& box, const Ray& ray, float tMax, float& tHit, glm::vec3& normal) {
+    glm::vec3 delta = box.center - ray.origin;
+    float tNear = -FLT_MAX, tFar = FLT_MAX;
+    int nearAxis = 0, farAxis = 0;
+    float nearSign = 1.0f, farSign = 1.0f;
+    for (int i = 0; i < 3; i++) {
+        float e = glm::dot(box.axes[i], delta);
+        float f = glm::dot(box.axes[i], ray.dir);
+        if (glm::abs(f) > 1e-8f) {
+            float t1 = (e + box.halfExtents[i]) / f;
+            float t2 = (e - box.halfExtents[i]) / f;
+            float s1 = 1.0f, s2 = -1.0f;
+            if (t1 > t2) { std::swap(t1, t2); std::swap(s1, s2); }
+            if (t1 > tNear) { tNear = t1; nearAxis = i; nearSign = s1; }
+            if (t2 < tFar) { tFar = t2; farAxis = i; farSign = s2; }
+            if (tNear > tFar || tFar < 0.0f) return false;
+        } else if (-e - box.halfExtents[i] > 0.0f || -e + box.halfExtents[i] < 0.0f) {
+            return false;
+        }
+    }
+    if (tNear > 0.0f) {
+        if (tNear > tMax) return false;
+        tHit = tNear;
+        normal = box.axes[nearAxis] * nearSign;
+    } else {
+        if (tFar > tMax) return false;
+        tHit = tFar;
+        normal = box.axes[farAxis] * farSign;
+    }
+    return true;
+}
+
+// Conservative: false only when the box lies entirely outside one plane
+inline bool intersectFrustum(const OrientedBox& box, const Frustum& frustum) {
+    for (const auto& plane : frustum.planes) {
+        glm::vec3 normal(plane);
+        float reach = 0.0f;
+        for (int a = 0; a < 3; a++) {
+            reach += glm::abs(glm::dot(normal, box.axes[a])) * box.halfExtents[a];
+        }
+        if (glm::dot(normal, box.center) + plane.w < -reach) return false;
+    }
+    return true;
+}
+
+// Axis-aligned bounds of an oriented box
+inline void orientedBoxBounds(const OrientedBox& box, glm::vec3& boundsMin, glm::vec3& boundsMax) {
+    glm::vec3 reach(0.0f);
+    for (int a = 0; a < 3; a++) {
+        reach += glm::abs(box.axes[a]) * box.halfExtents[a];
+    }
+    boundsMin = box.center - reach;
+    boundsMax = box.center + reach;
+}
+
+// Bounding volume hierarchy over oriented boxes (median split, 4 boxes per leaf). Moved boxes can
+// be refitted in place; the tree keeps its split, so queries slow down as boxes drift far from
+// where they were built, and callers rebuild when the set of boxes changes.
+class BVH {
+private:
+    struct Node {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        int leftOrFirst; // Left child index for inner nodes, first box for leaves
+        int count;       // 0 for inner nodes
+    };
+
+    std::vector<Node> nodes;
+    std::vector<OrientedBox> boxes;
+    std::vector<int> parents;    // Parent node of each node, -1 for the root
+    std::vector<int> boxLeaves;  // Leaf node holding each box
+    std::vector<int> dirtyLeaves; // Leaves with boxes replaced since the last refit()
+    // Build-time copy of each box's bounds, partitioned in place; boxes are gathered into leaf order
+    // once at the end
+    struct BuildRef {
+        glm::vec3 boundsMin, boundsMax, center;
+        int box;
+    };
+    std::vector<BuildRef> refs;
+
+    static bool intersectBounds(const glm::vec3& bmin, const glm::vec3& bmax, const glm::vec3& origin,
+                                const glm::vec3& invDir, float tMax, float& tEntry) {
+        glm::vec3 t1 = (bmin - origin) * invDir;
+        glm::vec3 t2 = (bmax - origin) * invDir;
+        glm::vec3 tSmall = glm::min(t1, t2);
+        glm::vec3 tLarge = glm::max(t1, t2);
+        tEntry = glm::max(glm::max(tSmall.x, tSmall.y), glm::max(tSmall.z, 0.0f));
+        float tExit = glm::min(glm::min(tLarge.x, tLarge.y), glm::min(tLarge.z, tMax));
+        return tEntry <= tExit;
+    }
+
+    void buildNode(int nodeIndex, int first, int count) {
+        Node& node = nodes[nodeIndex];
+        node.boundsMin = glm::vec3(FLT_MAX);
+        node.boundsMax = glm::vec3(-FLT_MAX);
+        glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+        for (int i = first; i < first + count; i++) {
+            node.boundsMin = glm::min(node.boundsMin, refs[i].boundsMin);
+            node.boundsMax = glm::max(node.boundsMax, refs[i].boundsMax);
+            centroidMin = glm::min(centroidMin, refs[i].center);
+            centroidMax = glm::max(centroidMax, refs[i].center);
+        }
+        if (count <= 4) {
+            node.leftOrFirst = first;
+            node.count = count;
+            for (int i = first; i < first + count; i++) {
+                boxLeaves[i] = nodeIndex;
+            }
+            return;
+        }
+
+        glm::vec3 extent = centroidMax - centroidMin;
+        int axis = 0;
+        if (extent.y > extent.x) axis = 1;
+        if (extent.z > extent[axis]) axis = 2;
+
+        // Partition around the median centroid
+        int half = count / 2;
+        std::nth_element(refs.begin() + first, refs.begin() + first + half, refs.begin() + first + count, [axis](const BuildRef& a, const BuildRef& b) {
+            return a.center[axis] < b.center[axis];
+        });
+
+        int left = (int)nodes.size();
+        nodes.push_back(Node());
+        nodes.push_back(Node());
+        parents.push_back(nodeIndex);
+        parents.push_back(nodeIndex);
+        nodes[nodeIndex].leftOrFirst = left;
+        nodes[nodeIndex].count = 0;
+        buildNode(left, first, half);
+        buildNode(left + 1, first + half, count - half);
+    }
+
+public:
+    void build(const std::vector<OrientedBox>& input) {
+        nodes.clear();
+        parents.clear();
+        dirtyLeaves.clear();
+        refs.resize(input.size());
+        for (size_t i = 0; i < input.size(); i++) {
+            orientedBoxBounds(input[i], refs[i].boundsMin, refs[i].boundsMax);
+            refs[i].center = input[i].center;
+            refs[i].box = (int)i;
+        }
+        boxes.clear();
+        boxLeaves.assign(input.size(), 0);
+        if (input.empty()) return;
+        nodes.reserve(input.size() * 2);
+        parents.reserve(input.size() * 2);
+        nodes.push_back(Node());
+        parents.push_back(-1);
+        buildNode(0, 0, (int)input.size());
+
+        boxes.resize(input.size());
+        for (size_t i = 0; i < input.size(); i++) {
+            boxes[i] = input[refs[i].box];
+        }
+        std::vector<BuildRef>().swap(refs);
+    }
+
+    // Replaces a box (index as in getBoxes()) after its object moved; takes effect at refit()
+    void updateBox(int box, const OrientedBox& moved) {
+        boxes[box] = moved;
+        dirtyLeaves.push_back(boxLeaves[box]);
+    }
+
+    // Recomputes the bounds of the leaves touched by updateBox() and of their ancestors
+    void refit() {
+        if (dirtyLeaves.empty()) return;
+        std::sort(dirtyLeaves.begin(), dirtyLeaves.end());
+        dirtyLeaves.erase(std::unique(dirtyLeaves.begin(), dirtyLeaves.end()), dirtyLeaves.end());
+        for (int leaf : dirtyLeaves) {
+            Node& node = nodes[leaf];
+            node.boundsMin = glm::vec3(FLT_MAX);
+            node.boundsMax = glm::vec3(-FLT_MAX);
+            for (int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+                glm::vec3 boundsMin, boundsMax;
+                orientedBoxBounds(boxes[i], boundsMin, boundsMax);
+                node.boundsMin = glm::min(node.boundsMin, boundsMin);
+                node.boundsMax = glm::max(node.boundsMax, boundsMax);
+            }
+            // Walk up while the ancestors' bounds change
+            for (int n = parents[leaf]; n >= 0; n = parents[n]) {
+                const Node& l = nodes[nodes[n].leftOrFirst];
+                const Node& r = nodes[nodes[n].leftOrFirst + 1];
+                glm::vec3 boundsMin = glm::min(l.boundsMin, r.boundsMin);
+                glm::vec3 boundsMax = glm::max(l.boundsMax, r.boundsMax);
+                if (boundsMin == nodes[n].boundsMin && boundsMax == nodes[n].boundsMax) break;
+                nodes[n].boundsMin = boundsMin;
+                nodes[n].boundsMax = boundsMax;
+            }
+        }
+        dirtyLeaves.clear();
+    }
+
+    // Nearest hit along the ray within (0, tMax]
+    bool intersect(const Ray& ray, float tMax, BVHHit& hit) const {
+        if (nodes.empty()) return false;
+        glm::vec3 invDir = 1.0f / ray.dir;
+        int stack[64];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        bool found = false;
+        hit.t = tMax;
+        while (stackSize > 0) {
+            const Node& node = nodes[stack[--stackSize]];
+            float tEntry;
+            if (!intersectBounds(node.boundsMin, node.boundsMax, ray.origin, invDir, hit.t, tEntry)) continue;
+            if (node.count > 0) {
+                for (int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+                    float t;
+                    glm::vec3 normal;
+                    if (intersectOrientedBox(boxes[i], ray, hit.t, t, normal)) {
+                        hit.t = t;
+                        hit.box = i;
+                        hit.normal = normal;
+                        found = true;
+                    }
+                }
+            } else {
+                // Visit the nearer child first so the far one is more likely to be culled
+                float tLeft, tRight;
+                const Node& l = nodes[node.leftOrFirst];
+                const Node& r = nodes[node.leftOrFirst + 1];
+                bool hitLeft = intersectBounds(l.boundsMin, l.boundsMax, ray.origin, invDir, hit.t, tLeft);
+                bool hitRight = intersectBounds(r.boundsMin, r.boundsMax, ray.origin, invDir, hit.t, tRight);
+                if (hitLeft && hitRight) {
+                    if (tLeft <= tRight) {
+                        stack[stackSize++] = node.leftOrFirst + 1;
+                        stack[stackSize++] = node.leftOrFirst;
+                    } else {
+                        stack[stackSize++] = node.leftOrFirst;
+                        stack[stackSize++] = node.leftOrFirst + 1;
+                    }
+                } else if (hitLeft) {
+                    stack[stackSize++] = node.leftOrFirst;
+                } else if (hitRight) {
+                    stack[stackSize++] = node.leftOrFirst + 1;
+                }
+            }
+        }
+        return found;
+    }
+
+    // Any hit within (0, tMax], used for shadow rays
+    bool occluded(const Ray& ray, float tMax) const {
+        if (nodes.empty()) return false;
+        glm::vec3 invDir = 1.0f / ray.dir;
+        int stack[64];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0) {
+            const Node& node = nodes[stack[--stackSize]];
+            float tEntry;
+            if (!intersectBounds(node.boundsMin, node.boundsMax, ray.origin, invDir, tMax, tEntry)) continue;
+            if (node.count > 0) {
+                for (int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+                    float t;
+                    glm::vec3 normal;
+                    if (intersectOrientedBox(boxes[i], ray, tMax, t, normal)) return true;
+                }
+            } else {
+                stack[stackSize++] = node.leftOrFirst;
+                stack[stackSize++] = node.leftOrFirst + 1;
+            }
+        }
+        return false;
+    }
+
+    // Calls visit(box index) for every box that intersects the frustum. Subtrees entirely inside
+    // it are taken without testing their boxes.
+    template <typename Visit>
+    void queryFrustum(const Frustum& frustum, Visit visit) const {
+        if (nodes.empty()) return;
+        int stack[64];
+        bool insideStack[64];
+        int stackSize = 0;
+        stack[stackSize] = 0;
+        insideStack[stackSize++] = false;
+        while (stackSize > 0) {
+            stackSize--;
+            const Node& node = nodes[stack[stackSize]];
+            bool inside = insideStack[stackSize];
+            if (!inside) {
+                glm::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+                glm::vec3 extent = (node.boundsMax - node.boundsMin) * 0.5f;
+                bool outside = false;
+                inside = true;
+                for (const auto& plane : frustum.planes) {
+                    float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+                    float reach = glm::dot(glm::abs(glm::vec3(plane)), extent);
+                    if (distance < -reach) {
+                        outside = true;
+                        break;
+                    }
+                    if (distance < reach) inside = false;
+                }
+                if (outside) continue;
+            }
+            if (node.count > 0) {
+                for (int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+                    if (inside || intersectFrustum(boxes[i], frustum)) visit(i);
+                }
+            } else {
+                stack[stackSize] = node.leftOrFirst;
+                insideStack[stackSize++] = inside;
+                stack[stackSize] = node.leftOrFirst + 1;
+                insideStack[stackSize++] = inside;
+            }
+        }
+    }
+
+    const std::vector<OrientedBox>& getBoxes() const {
+        return boxes;
+    }
+
+    bool empty() const {
+        return boxes.empty();
+    }
+};
+
+#endif
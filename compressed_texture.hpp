@@ -0,0 +1,221 @@
+#ifndef COMPRESSED_TEXTURE_HPP
+#define COMPRESSED_TEXTURE_HPP
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Block-compressed formats the renderer can upload as-is (4x4 texel blocks)
+enum BlockFormat {
+    BLOCK_BC1, // 8 bytes per block, RGB + 1-bit alpha
+    BLOCK_BC3, // 16 bytes per block, RGB + interpolated alpha
+    BLOCK_BC7  // 16 bytes per block, high quality RGBA
+};
+
+inline int blockFormatBytes(BlockFormat format) {
+    return format == BLOCK_BC1 ? 8 : 16;
+}
+
+struct CompressedLevel {
+    int width;
+    int height;
+    size_t offset; // Into CompressedImage::data()
+    size_t size;
+};
+
+// Mip chain of a block-compressed 2D texture, largest level first. When source is set the
+// image is a view: level offsets point into memory owned by someone else (e.g. a mapped archive)
+// and bytes stays empty.
+struct CompressedImage {
+    BlockFormat format = BLOCK_BC1;
+    bool srgb = false;
+    std::vector<CompressedLevel> levels;
+    std::vector<unsigned char> bytes;
+    const unsigned char* source = nullptr;
+
+    const unsigned char* data() const {
+        return source ? source : bytes.data();
+    }
+};
+
+inline size_t compressedLevelSize(BlockFormat format, int width, int height) {
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockFormatBytes(format);
+}
+
+// Records a level of a loaded file, copying it unless the image is a view; fails if it runs past the end
+inline bool appendCompressedLevel(CompressedImage& image, const unsigned char* data, size_t dataSize,
+                                  size_t offset, int width, int height) {
+    size_t size = compressedLevelSize(image.format, width, height);
+    if (offset > dataSize || size > dataSize - offset) return false;
+    if (image.source) {
+        image.levels.push_back({ width, height, offset, size });
+    } else {
+        image.levels.push_back({ width, height, image.bytes.size(), size });
+        image.bytes.insert(image.bytes.end(), data + offset, data + offset + size);
+    }
+    return true;
+}
+
+// DDS with DXT1/DXT5 FourCC or a DX10 header with BC1/BC3/BC7 (UNORM or SRGB).
+// With view set, image references data instead of copying it; data must outlive image.
+inline bool parseDDS(const unsigned char* data, size_t size, CompressedImage& image, const char* name = "DDS", bool view = false) {
+    if (size < 128 || memcmp(data, "DDS ", 4) != 0) {
+        printf("Not a DDS file: %s\n", name);
+        return false;
+    }
+    uint32_t height, width, mipCount;
+    memcpy(&height, data + 12, 4);
+    memcpy(&width, data + 16, 4);
+    memcpy(&mipCount, data + 28, 4);
+    if (mipCount == 0) mipCount = 1;
+
+    size_t offset = 128;
+    if (memcmp(data + 84, "DXT1", 4) == 0) {
+        image.format = BLOCK_BC1;
+    } else if (memcmp(data + 84, "DXT5", 4) == 0) {
+        image.format = BLOCK_BC3;
+    } else if (memcmp(data + 84, "DX10", 4) == 0 && size >= 148) {
+        uint32_t dxgiFormat, dimension, arraySize;
+        memcpy(&dxgiFormat, data + 128, 4);
+        memcpy(&dimension, data + 132, 4);
+        memcpy(&arraySize, data + 140, 4);
+        offset = 148;
+        switch (dxgiFormat) {
+        case 71: image.format = BLOCK_BC1; image.srgb = false; break;
+        case 72: image.format = BLOCK_BC1; image.srgb = true; break;
+        case 77: image.format = BLOCK_BC3; image.srgb = false; break;
+        case 78: image.format = BLOCK_BC3; image.srgb = true; break;
+        case 98: image.format = BLOCK_BC7; image.srgb = false; break;
+        case 99: image.format = BLOCK_BC7; image.srgb = true; break;
+        default:
+            printf("Unsupported DXGI format %u: %s\n", dxgiFormat, name);
+            return false;
+        }
+        if (dimension != 3 || arraySize > 1) { // 3 = D3D10_RESOURCE_DIMENSION_TEXTURE2D
+            printf("Only single 2D DDS textures are supported: %s\n", name);
+            return false;
+        }
+    } else {
+        printf("Unsupported DDS pixel format: %s\n", name);
+        return false;
+    }
+
+    image.levels.clear();
+    image.bytes.clear();
+    image.source = view ? data : nullptr;
+    int w = (int)width, h = (int)height;
+    for (uint32_t level = 0; level < mipCount; level++) {
+        if (!appendCompressedLevel(image, data, size, offset, w, h)) {
+            printf("Truncated DDS file: %s\n", name);
+            return false;
+        }
+        offset += image.levels.back().size;
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+    return true;
+}
+
+// KTX2 without supercompression, holding one 2D image in a BC1/BC3/BC7 VkFormat
+inline bool parseKTX2(const unsigned char* data, size_t size, CompressedImage& image, const char* name = "KTX2") {
+    static const unsigned char IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    if (size < 80 || memcmp(data, IDENTIFIER, 12) != 0) {
+        printf("Not a KTX2 file: %s\n", name);
+        return false;
+    }
+    uint32_t vkFormat, width, height, depth, layers, faces, levelCount, supercompression;
+    memcpy(&vkFormat, data + 12, 4);
+    memcpy(&width, data + 20, 4);
+    memcpy(&height, data + 24, 4);
+    memcpy(&depth, data + 28, 4);
+    memcpy(&layers, data + 32, 4);
+    memcpy(&faces, data + 36, 4);
+    memcpy(&levelCount, data + 40, 4);
+    memcpy(&supercompression, data + 44, 4);
+    if (supercompression != 0 || depth > 1 || layers > 1 || faces != 1) {
+        printf("Only uncompressed single 2D KTX2 textures are supported: %s\n", name);
+        return false;
+    }
+    switch (vkFormat) {
+    case 131: case 133: image.format = BLOCK_BC1; image.srgb = false; break;
+    case 132: case 134: image.format = BLOCK_BC1; image.srgb = true; break;
+    case 137: image.format = BLOCK_BC3; image.srgb = false; break;
+    case 138: image.format = BLOCK_BC3; image.srgb = true; break;
+    case 145: image.format = BLOCK_BC7; image.srgb = false; break;
+    case 146: image.format = BLOCK_BC7; image.srgb = true; break;
+    default:
+        printf("Unsupported KTX2 VkFormat %u: %s\n", vkFormat, name);
+        return false;
+    }
+    if (levelCount == 0) levelCount = 1;
+    if (80 + (size_t)levelCount * 24 > size) {
+        printf("Truncated KTX2 level index: %s\n", name);
+        return false;
+    }
+
+    image.levels.clear();
+    image.bytes.clear();
+    image.source = nullptr;
+    int w = (int)width, h = (int)height;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        uint64_t byteOffset;
+        memcpy(&byteOffset, data + 80 + level * 24, 8);
+        if (!appendCompressedLevel(image, data, size, (size_t)byteOffset, w, h)) {
+            printf("Truncated KTX2 file: %s\n", name);
+            return false;
+        }
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+    return true;
+}
+
+// Serialises an owned image as DDS with a DX10 header (the format parseDDS reads back)
+inline void writeDDS(const CompressedImage& image, std::vector<unsigned char>& out) {
+    unsigned char header[148] = {};
+    uint32_t value;
+    memcpy(header, "DDS ", 4);
+    value = 124; memcpy(header + 4, &value, 4);                   // dwSize
+    value = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;         // CAPS | HEIGHT | WIDTH | PIXELFORMAT | MIPMAPCOUNT | LINEARSIZE
+    memcpy(header + 8, &value, 4);
+    value = image.levels.empty() ? 0 : image.levels[0].height; memcpy(header + 12, &value, 4);
+    value = image.levels.empty() ? 0 : image.levels[0].width; memcpy(header + 16, &value, 4);
+    value = image.levels.empty() ? 0 : (uint32_t)image.levels[0].size; memcpy(header + 20, &value, 4);
+    value = (uint32_t)image.levels.size(); memcpy(header + 28, &value, 4);
+    value = 32; memcpy(header + 76, &value, 4);                   // ddspf.dwSize
+    value = 0x4; memcpy(header + 80, &value, 4);                  // DDPF_FOURCC
+    memcpy(header + 84, "DX10", 4);
+    value = 0x1000 | 0x400000 | 0x8; memcpy(header + 108, &value, 4); // TEXTURE | MIPMAP | COMPLEX
+    static const uint32_t DXGI[3][2] = { { 71, 72 }, { 77, 78 }, { 98, 99 } };
+    value = DXGI[image.format][image.srgb ? 1 : 0]; memcpy(header + 128, &value, 4);
+    value = 3; memcpy(header + 132, &value, 4);                   // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+    value = 1; memcpy(header + 140, &value, 4);                   // arraySize
+    out.insert(out.end(), header, header + sizeof(header));
+    for (const auto& level : image.levels) {
+        out.insert(out.end(), image.data() + level.offset, image.data() + level.offset + level.size);
+    }
+}
+
+// Reads a .dds or .ktx2 file (chosen by extension)
+inline bool loadCompressedImage(const std::string& path, CompressedImage& image) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        printf("Failed to open texture file: %s\n", path.c_str());
+        return false;
+    }
+    std::vector<unsigned char> data;
+    unsigned char chunk[65536];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + read);
+    }
+    fclose(file);
+    size_t dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+    if (extension == "ktx2") return parseKTX2(data.data(), data.size(), image, path.c_str());
+    return parseDDS(data.data(), data.size(), image, path.c_str());
+}
+
+#endif
@@ -0,0 +1,22 @@
+// Покадровые константы (FrameConstants в frame_constants.hpp)
+layout (std140) uniform FrameConstants {
+    mat4 projection;
+    mat4 view;
+    mat4 viewProjection;
+    vec3 viewPos;
+    float time;
+    vec3 light_position;
+    int light_type;
+    vec3 light_color;
+    float light_ambientStrength;
+    vec3 light_direction;
+    int useProbes;
+    vec3 probeGridOrigin;
+    float probeGridSpacing;
+};
+
+// Константы прохода (PassConstants)
+layout (std140) uniform PassConstants {
+    int isOutline;
+    float outlineWidth;
+};
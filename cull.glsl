@@ -0,0 +1,233 @@
+#version 430 core
+// GPU-отсечение и выбор LOD (gpu_culling.hpp). Проходы собираются с #define:
+// CULL_CLASSIFY  — видимость, уровень и переход для каждого экземпляра, счётчики списков фазы 1;
+// CULL_OCCLUSION — проверка по пирамиде глубины, счётчики списков фазы 2;
+// CULL_OFFSETS   — смещения списков фазы и аргументы непрямых вызовов;
+// CULL_SCATTER   — ссылки на видимые экземпляры в списки фазы.
+// Список = (фаза, группа-меш, уровень, в переходе); уровень NUM_LODS — импостор.
+// Фаза 1 — видимые в прошлом кадре, фаза 2 — открывшиеся по пирамиде, построенной после фазы 1.
+
+#ifdef CULL_OFFSETS
+layout (local_size_x = 1) in;
+#else
+layout (local_size_x = 64) in;
+#endif
+
+#define TIERS (NUM_LODS + 1)
+#define NO_TIER 15u
+#define STATE_VISIBLE 0x80000000u     // В поле зрения камеры
+#define STATE_UNOCCLUDED 0x40000000u  // Прошёл проверку перекрытия (в прошлом кадре до CULL_OCCLUSION)
+#define STATE_EARLY 0x20000000u       // Нарисован в фазе 1
+
+struct CullInstance {
+    vec4 positionScale;
+    uint group;
+    uint pad0, pad1, pad2;
+};
+
+struct CullGroup {
+    vec4 errors;       // Ошибка каждого LOD в единицах меша, w — радиус ограничивающей сферы
+    uvec4 indexCounts; // Индексы каждого LOD, w — индексы квадрата импостора или 0
+};
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Instances { CullInstance instances[]; };
+layout (std430, binding = 1) readonly buffer Groups { CullGroup groups[]; };
+layout (std430, binding = 2) buffer States { uint states[]; };     // tier | from << 4 | fade16 << 8 | флаги
+layout (std430, binding = 3) buffer Counts { uint counts[]; };     // CLASSIFY считает, OFFSETS превращает в курсоры
+layout (std430, binding = 4) buffer Commands { DrawCommand commands[]; };
+layout (std430, binding = 5) writeonly buffer References { uvec2 references[]; }; // (экземпляр, fade)
+
+uniform uint instanceCount;
+uniform uint listCount;               // Обе фазы
+uniform uint phase;
+uniform bool occlusion;               // Без перекрытия всё видимое идёт в фазу 1
+uniform vec4 frustumPlanes[6];
+uniform vec3 cameraPosition;
+uniform float pixelScale;
+uniform float lodThreshold;    // pixelError * qualityBias
+uniform float lodHysteresis;
+uniform float impostorPixels;  // impostorPixels * qualityBias, 0 = без импосторов
+uniform float fadeStep;        // Прирост перехода за кадр, 0 = без плавной смены
+
+uniform mat4 viewProjection;
+uniform sampler2D depthPyramid;
+
+uint listIndex(uint group, uint tier, uint fading) {
+    return phase * (listCount / 2u) + (group * TIERS + tier) * 2u + fading;
+}
+
+void countInstance(uint group, uint state) {
+    uint tier = state & 15u;
+    uint from = (state >> 4) & 15u;
+    if (from == NO_TIER) {
+        atomicAdd(counts[listIndex(group, tier, 0u)], 1u);
+    } else {
+        atomicAdd(counts[listIndex(group, tier, 1u)], 1u);
+        atomicAdd(counts[listIndex(group, from, 1u)], 1u);
+    }
+}
+
+#if defined(CULL_CLASSIFY)
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= instanceCount) return;
+    CullInstance instance = instances[i];
+    CullGroup group = groups[instance.group];
+    vec3 center = instance.positionScale.xyz;
+    float scale = instance.positionScale.w;
+    float radius = group.errors.w * scale;
+
+    bool visible = true;
+    for (int p = 0; p < 6; p++) {
+        if (dot(frustumPlanes[p].xyz, center) + frustumPlanes[p].w < -radius) visible = false;
+    }
+
+    uint state = states[i];
+    uint current = state & 15u;
+    uint from = (state >> 4) & 15u;
+    float fade = float((state >> 8) & 0xFFFFu) / 65535.0;
+
+    // То же, что selectLOD и selectImpostor в lod_selection.hpp
+    float centerDistance = length(center - cameraPosition);
+    float distance = centerDistance - radius;
+    uint tier = 0u;
+    if (distance > 1e-4) {
+        float pixelsPerError = pixelScale / distance;
+        for (uint level = 1u; level < uint(NUM_LODS); level++) {
+            float limit = lodThreshold;
+            if (current != NO_TIER) limit *= level <= current ? 1.0 + lodHysteresis : 1.0 - lodHysteresis;
+            if (group.errors[level] * scale * pixelsPerError <= limit) tier = level;
+        }
+    }
+    if (group.indexCounts.w > 0u && impostorPixels > 0.0 && centerDistance > radius) {
+        float diameter = 2.0 * radius * pixelScale / centerDistance;
+        float limit = impostorPixels * (current == uint(NUM_LODS) ? 1.0 + lodHysteresis : 1.0 - lodHysteresis);
+        if (diameter < limit) tier = uint(NUM_LODS);
+    }
+
+    // Невидимые меняют уровень сразу, переход нужен только на экране
+    if (!visible || fadeStep <= 0.0) {
+        from = NO_TIER;
+    } else if (current != NO_TIER && tier != current) {
+        from = current;
+        fade = 0.0;
+    } else if (from != NO_TIER) {
+        fade += fadeStep;
+        if (fade >= 1.0) from = NO_TIER;
+    }
+    if (from == NO_TIER) fade = 1.0;
+    bool unoccluded = occlusion ? (state & STATE_UNOCCLUDED) != 0u : visible;
+    bool early = visible && unoccluded;
+    state = tier | (from << 4) | (uint(clamp(fade, 0.0, 1.0) * 65535.0 + 0.5) << 8);
+    if (visible) state |= STATE_VISIBLE;
+    if (unoccluded) state |= STATE_UNOCCLUDED;
+    if (early) state |= STATE_EARLY;
+    states[i] = state;
+    if (early) countInstance(instance.group, state);
+}
+
+#elif defined(CULL_OCCLUSION)
+// Куб вокруг сферы в экран: перекрыт, если его ближайшая глубина дальше всех текселей пирамиды
+// на уровне, где прямоугольник занимает не больше 2x2
+bool isOccluded(vec3 center, float radius) {
+    vec2 minNdc = vec2(1.0);
+    vec2 maxNdc = vec2(-1.0);
+    float nearestDepth = 1.0;
+    for (int c = 0; c < 8; c++) {
+        vec3 corner = center + radius * vec3((c & 1) != 0 ? 1.0 : -1.0, (c & 2) != 0 ? 1.0 : -1.0, (c & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = viewProjection * vec4(corner, 1.0);
+        // Угол перед ближней плоскостью или за камерой — проекции верить нельзя
+        if (clip.z < -clip.w) return false;
+        vec3 ndc = clip.xyz / clip.w;
+        minNdc = min(minNdc, ndc.xy);
+        maxNdc = max(maxNdc, ndc.xy);
+        nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);
+    }
+    vec2 pyramidSize = vec2(textureSize(depthPyramid, 0));
+    vec2 pixelMin = clamp(minNdc * 0.5 + 0.5, 0.0, 1.0) * pyramidSize;
+    vec2 pixelMax = clamp(maxNdc * 0.5 + 0.5, 0.0, 1.0) * pyramidSize;
+    vec2 extent = pixelMax - pixelMin;
+    int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, textureQueryLevels(depthPyramid) - 1);
+    ivec2 levelSize = textureSize(depthPyramid, level);
+    ivec2 first = clamp(ivec2(pixelMin) >> level, ivec2(0), levelSize - 1);
+    ivec2 last = clamp(ivec2(pixelMax) >> level, ivec2(0), levelSize - 1);
+    float farthest = 0.0;
+    for (int y = first.y; y <= last.y; y++) {
+        for (int x = first.x; x <= last.x; x++) {
+            farthest = max(farthest, texelFetch(depthPyramid, ivec2(x, y), level).r);
+        }
+    }
+    return nearestDepth > farthest;
+}
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= instanceCount) return;
+    uint state = states[i];
+    if ((state & STATE_VISIBLE) == 0u) {
+        states[i] = state & ~STATE_UNOCCLUDED;
+        return;
+    }
+    CullInstance instance = instances[i];
+    float radius = groups[instance.group].errors.w * instance.positionScale.w;
+    if (isOccluded(instance.positionScale.xyz, radius)) {
+        states[i] = state & ~STATE_UNOCCLUDED;
+        return;
+    }
+    states[i] = state | STATE_UNOCCLUDED;
+    // Уже нарисованные в фазе 1 второй раз не рисуются
+    if ((state & STATE_EARLY) == 0u) countInstance(instance.group, state);
+}
+
+#elif defined(CULL_OFFSETS)
+// Списков немного (меши * уровни * 4), последовательной суммы хватает.
+// Ссылки фазы 2 идут после ссылок фазы 1, их команды уже записаны.
+void main() {
+    uint phaseLists = listCount / 2u;
+    uint offset = 0u;
+    for (uint list = 0u; list < phase * phaseLists; list++) {
+        offset += commands[list].instanceCount;
+    }
+    for (uint list = phase * phaseLists; list < (phase + 1u) * phaseLists; list++) {
+        uint count = counts[list];
+        CullGroup group = groups[(list % phaseLists) / (TIERS * 2u)];
+        uint tier = (list / 2u) % TIERS;
+        commands[list].count = tier < uint(NUM_LODS) ? group.indexCounts[tier] : group.indexCounts.w;
+        commands[list].instanceCount = count;
+        commands[list].firstIndex = 0u;
+        commands[list].baseVertex = 0;
+        commands[list].baseInstance = offset;
+        counts[list] = offset;
+        offset += count;
+    }
+}
+
+#elif defined(CULL_SCATTER)
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= instanceCount) return;
+    uint state = states[i];
+    if ((state & STATE_VISIBLE) == 0u) return;
+    bool early = (state & STATE_EARLY) != 0u;
+    if (phase == 0u ? !early : early || (state & STATE_UNOCCLUDED) == 0u) return;
+    uint group = instances[i].group;
+    uint tier = state & 15u;
+    uint from = (state >> 4) & 15u;
+    float fade = float((state >> 8) & 0xFFFFu) / 65535.0;
+    if (from == NO_TIER) {
+        references[atomicAdd(counts[listIndex(group, tier, 0u)], 1u)] = uvec2(i, floatBitsToUint(1.0));
+    } else {
+        // Дополняющие маски, как у LOD_FADE в fragment.glsl
+        references[atomicAdd(counts[listIndex(group, tier, 1u)], 1u)] = uvec2(i, floatBitsToUint(fade));
+        references[atomicAdd(counts[listIndex(group, from, 1u)], 1u)] = uvec2(i, floatBitsToUint(fade - 1.0));
+    }
+}
+#endif
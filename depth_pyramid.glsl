@@ -0,0 +1,38 @@
+#version 430 core
+// Пирамида глубины для отсечения перекрытых (depth_pyramid.hpp). Проходы собираются с #define:
+// PYRAMID_COPY   — уровень 0 из копии буфера глубины;
+// PYRAMID_REDUCE — каждый следующий уровень как максимум (самое дальнее) из 2x2 текселей предыдущего.
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (r32f, binding = 1) writeonly uniform image2D destination;
+
+#if defined(PYRAMID_COPY)
+uniform sampler2D depthTexture;
+
+void main() {
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(p, imageSize(destination)))) return;
+    imageStore(destination, p, vec4(texelFetch(depthTexture, p, 0).r));
+}
+
+#elif defined(PYRAMID_REDUCE)
+layout (r32f, binding = 0) readonly uniform image2D source;
+
+void main() {
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(destination);
+    if (any(greaterThanEqual(p, size))) return;
+    ivec2 sourceSize = imageSize(source);
+    // При нечётном размере последний тексель забирает и лишний столбец/строку, иначе они потеряются
+    ivec2 first = p * 2;
+    ivec2 last = min(first + 1 + ivec2(equal(p, size - 1)) * (sourceSize & 1), sourceSize - 1);
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; y++) {
+        for (int x = first.x; x <= last.x; x++) {
+            depth = max(depth, imageLoad(source, ivec2(x, y)).r);
+        }
+    }
+    imageStore(destination, p, vec4(depth));
+}
+#endif
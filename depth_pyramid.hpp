@@ -0,0 +1,155 @@
+#ifndef DEPTH_PYRAMID_HPP
+#define DEPTH_PYRAMID_HPP
+
+#include <GL/glew.h>
+#include <stdio.h>
+#include <string>
+#include "shader_variants.hpp"
+
+// Hierarchical depth (Hi-Z) for GPU occlusion culling (depth_pyramid.glsl). The default
+// framebuffer's depth is blitted into a texture, copied to level 0 of an R32F pyramid and reduced
+// level by level, each texel holding the farthest depth under it. A bounding box whose nearest depth
+// is behind every texel it covers is hidden.
+#define DEPTH_PYRAMID_TEXTURE_UNIT 8
+
+class DepthPyramid {
+private:
+    enum { PASS_COPY, PASS_REDUCE, PASS_COUNT };
+    GLuint programs[PASS_COUNT] = { 0, 0 };
+    GLuint depthTexture = 0, depthFramebuffer = 0, pyramidTexture = 0;
+    int width = 0, height = 0, levels = 0;
+    bool blitChecked = false;
+
+    void resize(int newWidth, int newHeight) {
+        releaseTextures();
+        width = newWidth;
+        height = newHeight;
+        levels = 1;
+        while ((width | height) >> levels) levels++;
+
+        // Формат как у стандартного буфера GLFW (24/8), иначе blit глубины запрещён
+        glGenTextures(1, &depthTexture);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glGenFramebuffers(1, &depthFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, depthFramebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenTextures(1, &pyramidTexture);
+        glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+        glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void releaseTextures() {
+        if (depthFramebuffer) glDeleteFramebuffers(1, &depthFramebuffer);
+        if (depthTexture) glDeleteTextures(1, &depthTexture);
+        if (pyramidTexture) glDeleteTextures(1, &pyramidTexture);
+        depthFramebuffer = depthTexture = pyramidTexture = 0;
+        width = height = levels = 0;
+    }
+
+    static void dispatch(int levelWidth, int levelHeight) {
+        glDispatchCompute((levelWidth + 7) / 8, (levelHeight + 7) / 8, 1);
+    }
+
+public:
+    // source: depth_pyramid.glsl. Needs GL 4.3 like GpuCuller.
+    bool init(const std::string& source) {
+        if (!GLEW_VERSION_4_3) return false;
+        const char* passes[PASS_COUNT] = { "PYRAMID_COPY", "PYRAMID_REDUCE" };
+        for (int pass = 0; pass < PASS_COUNT; pass++) {
+            programs[pass] = createComputeProgram(injectDefines(source, std::string("#define ") + passes[pass] + "\n"));
+            if (!programs[pass]) {
+                destroy();
+                return false;
+            }
+        }
+        glUseProgram(programs[PASS_COPY]);
+        glUniform1i(glGetUniformLocation(programs[PASS_COPY], "depthTexture"), DEPTH_PYRAMID_TEXTURE_UNIT);
+        glUseProgram(0);
+        return true;
+    }
+
+    bool isReady() const {
+        return programs[PASS_COPY] != 0;
+    }
+
+    // Rebuilds the pyramid from the depth currently in the default framebuffer
+    void build(int viewportWidth, int viewportHeight) {
+        if (!isReady() || viewportWidth <= 0 || viewportHeight <= 0) return;
+        if (viewportWidth != width || viewportHeight != height) resize(viewportWidth, viewportHeight);
+
+        if (!blitChecked) {
+            while (glGetError() != GL_NO_ERROR) {}
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthFramebuffer);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (!blitChecked) {
+            blitChecked = true;
+            if (glGetError() != GL_NO_ERROR) {
+                printf("Depth pyramid: default framebuffer depth format is not 24/8, occlusion culling disabled\n");
+                destroy();
+                return;
+            }
+        }
+
+        glActiveTexture(GL_TEXTURE0 + DEPTH_PYRAMID_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glActiveTexture(GL_TEXTURE0);
+        glUseProgram(programs[PASS_COPY]);
+        glBindImageTexture(1, pyramidTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        dispatch(width, height);
+
+        glUseProgram(programs[PASS_REDUCE]);
+        for (int level = 1; level < levels; level++) {
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            glBindImageTexture(0, pyramidTexture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+            glBindImageTexture(1, pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+            dispatch(getLevelWidth(level), getLevelHeight(level));
+        }
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        glUseProgram(0);
+    }
+
+    GLuint getTexture() const {
+        return pyramidTexture;
+    }
+
+    int getWidth() const {
+        return width;
+    }
+
+    int getHeight() const {
+        return height;
+    }
+
+    int getLevelWidth(int level) const {
+        return width >> level > 0 ? width >> level : 1;
+    }
+
+    int getLevelHeight(int level) const {
+        return height >> level > 0 ? height >> level : 1;
+    }
+
+    int getLevels() const {
+        return levels;
+    }
+
+    void destroy() {
+        for (GLuint& program : programs) {
+            if (program) glDeleteProgram(program);
+            program = 0;
+        }
+        releaseTextures();
+    }
+};
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef FILE_WATCHER_HPP
+#define FILE_WATCHER_HPP
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Reports changes to a set of files without blocking. On Linux the parent directories are
+// watched with inotify, which also catches editors that save by writing a new file and
+// renaming it over the old one. Elsewhere modification times are compared on every poll.
+class FileWatcher {
+private:
+    std::vector<std::string> files;
+    std::vector<std::filesystem::file_time_type> writeTimes;
+#ifdef __linux__
+    int fd = -1;
+    std::unordered_map<int, std::string> directories; // Watch descriptor -> directory
+    std::unordered_set<std::string> watched;          // "directory/name" of every file
+#endif
+
+    static std::string parentDirectory(const std::string& path) {
+        std::string directory = std::filesystem::path(path).parent_path().string();
+        return directory.empty() ? "." : directory;
+    }
+
+    static std::string fileName(const std::string& path) {
+        return std::filesystem::path(path).filename().string();
+    }
+
+    std::filesystem::file_time_type writeTime(const std::string& path) const {
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(path, error);
+        return error ? std::filesystem::file_time_type() : time;
+    }
+
+public:
+    // Replaces the watched set
+    void watch(const std::vector<std::string>& paths) {
+        destroy();
+        files = paths;
+        writeTimes.clear();
+        for (const auto& path : files) {
+            writeTimes.push_back(writeTime(path));
+        }
+#ifdef __linux__
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) {
+            printf("inotify unavailable, falling back to polling file times\n");
+            return;
+        }
+        std::unordered_map<std::string, int> added;
+        for (const auto& path : files) {
+            std::string directory = parentDirectory(path);
+            if (!added.count(directory)) {
+                int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+                if (wd < 0) {
+                    printf("Failed to watch %s\n", directory.c_str());
+                    continue;
+                }
+                added[directory] = wd;
+                directories[wd] = directory;
+            }
+            watched.insert(directory + "/" + fileName(path));
+        }
+#endif
+    }
+
+    // True if any watched file changed since the previous call
+    bool poll() {
+        bool changed = false;
+#ifdef __linux__
+        if (fd >= 0) {
+            alignas(inotify_event) char buffer[4096];
+            ssize_t length;
+            while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+                for (char* p = buffer; p < buffer + length;) {
+                    const inotify_event* event = (const inotify_event*)p;
+                    auto directory = directories.find(event->wd);
+                    if (event->len > 0 && directory != directories.end() && watched.count(directory->second + "/" + event->name)) {
+                        changed = true;
+                    }
+                    p += sizeof(inotify_event) + event->len;
+                }
+            }
+            return changed;
+        }
+#endif
+        for (size_t i = 0; i < files.size(); i++) {
+            auto time = writeTime(files[i]);
+            if (time != writeTimes[i]) {
+                writeTimes[i] = time;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    void destroy() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+        fd = -1;
+        directories.clear();
+        watched.clear();
+#endif
+        files.clear();
+        writeTimes.clear();
+    }
+};
+
+#endif
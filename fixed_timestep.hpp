@@ -0,0 +1,51 @@
+#ifndef FIXED_TIMESTEP_HPP
+#define FIXED_TIMESTEP_HPP
+
+// Accumulator for a fixed simulation rate: frame time goes in, whole ticks come out, and the
+// remainder (as a fraction of a tick) is what rendering interpolates by. A long frame runs at most
+// maxTicks ticks and drops the rest, so a stall does not snowball into ever longer catch-up frames.
+class FixedTimestep {
+private:
+    double step;
+    double accumulator = 0.0;
+    int maxTicks;
+
+public:
+    explicit FixedTimestep(double ticksPerSecond = 60.0, int maxTicksPerFrame = 8)
+        : step(1.0 / ticksPerSecond), maxTicks(maxTicksPerFrame) {}
+
+    void setRate(double ticksPerSecond) {
+        if (ticksPerSecond <= 0.0) return;
+        // Keep the same fraction of a tick pending so interpolation does not jump
+        accumulator = accumulator / step * (1.0 / ticksPerSecond);
+        step = 1.0 / ticksPerSecond;
+    }
+
+    // Ticks to run for this frame
+    int advance(double frameSeconds) {
+        if (frameSeconds > 0.0) accumulator += frameSeconds;
+        int ticks = (int)(accumulator / step);
+        if (ticks > maxTicks) {
+            ticks = maxTicks;
+            accumulator = step * maxTicks;
+        }
+        accumulator -= ticks * step;
+        return ticks;
+    }
+
+    float getStep() const {
+        return (float)step;
+    }
+
+    double getRate() const {
+        return 1.0 / step;
+    }
+
+    // Position between the last two ticks, [0, 1)
+    float getAlpha() const {
+        float alpha = (float)(accumulator / step);
+        return alpha < 1.0f ? alpha : 0.9999f;
+    }
+};
+
+#endif
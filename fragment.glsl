@@ -1,75 +1,201 @@
 #version 330 core
+// Варианты собираются с #define из shader_variants.hpp, ветвлений по типу объекта нет
+#include "constants.glsl"
+
+#if !defined(DEPTH_ONLY) && !defined(IMPOSTOR_BAKE) && !defined(OBJECT_ID)
 out vec4 FragColor;
+#endif
+
+#ifdef LOD_FADE
+flat in float LodFade;
+
+const float BAYER4[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0, 3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+
+// Screen-door cross-fade: the incoming level (LodFade = f) keeps the Bayer cells below f, the
+// outgoing one (LodFade = f - 1) the rest, so together they cover every pixel exactly once
+void lodFadeDiscard() {
+    ivec2 cell = ivec2(gl_FragCoord.xy) & 3;
+    float threshold = (BAYER4[cell.y * 4 + cell.x] + 0.5) / 16.0;
+    if (LodFade >= 0.0 ? threshold >= LodFade : threshold < LodFade + 1.0) discard;
+}
+#endif
+
+#ifdef IMPOSTOR
+in vec2 ImpostorUV;
+flat in mat3 ImpostorRotation;
+uniform sampler2D impostor_surface; // (u, v, 0, покрытие)
+uniform sampler2D impostor_normal;  // нормаль объекта * 0.5 + 0.5
+
+// Mesh UV at this pixel of the nearest baked frame; pixels outside the silhouette are dropped
+vec2 impostorTexCoord() {
+    vec4 surface = texture(impostor_surface, ImpostorUV);
+    if (surface.a < 0.5) discard;
+    return surface.xy;
+}
+
+vec3 impostorNormal() {
+    return ImpostorRotation * (texture(impostor_normal, ImpostorUV).xyz * 2.0 - 1.0);
+}
+#endif
+
+#if defined(GIZMO)
+in vec3 GizmoColor;
+
+void main() {
+    FragColor = vec4(GizmoColor, 1.0);
+}
+
+#elif defined(IMPOSTOR_BAKE)
+in vec2 TexCoord;
+in vec3 Normal;
+layout (location = 0) out vec4 ImpostorSurface;
+layout (location = 1) out vec4 ImpostorNormal;
+
+void main() {
+    ImpostorSurface = vec4(TexCoord, 0.0, 1.0);
+    ImpostorNormal = vec4(normalize(Normal) * 0.5 + 0.5, 1.0);
+}
+
+#elif defined(OBJECT_ID)
+flat in int ObjectId;
+layout (location = 0) out uint FragObjectId; // 0 — пусто
+
+void main() {
+#ifdef LOD_FADE
+    lodFadeDiscard();
+#endif
+#ifdef IMPOSTOR
+    impostorTexCoord();
+#endif
+    FragObjectId = uint(ObjectId + 1);
+}
+
+#elif defined(OUTLINE)
+flat in float isSelected;
+
+void main() {
+#ifdef LOD_FADE
+    lodFadeDiscard();
+#endif
+#ifdef IMPOSTOR
+    impostorTexCoord();
+#endif
+    if (isSelected < 0.25) {
+        discard;
+    }
+    // Жёлтый контур для выбранных объектов, голубой для объекта под курсором
+    FragColor = isSelected > 0.75 ? vec4(1.0, 1.0, 0.0, 1.0) : vec4(0.3, 0.8, 1.0, 1.0);
+}
 
+#elif defined(LIGHT_PROXY)
+void main() {
+#ifdef LOD_FADE
+    lodFadeDiscard();
+#endif
+    FragColor = vec4(light_color, 1.0); // Источники света используют свой цвет
+}
+
+#elif defined(LIT)
 in vec2 TexCoord;
 in vec3 Normal;
 in vec3 FragPos;
-in float isSelected;
-in float isLightSource;
-// Данные для гизмо
-in vec3 GizmoColor;
-in float GizmoType;
+flat in vec4 Material;
 
-uniform sampler2D material_diffuse;
+uniform sampler2DArray material_diffuse; // Один слой на материал
 uniform vec3 material_specular;
 uniform float material_shininess;
 
-uniform vec3 light_position;
-uniform vec3 light_color;
-uniform float light_ambientStrength;
-uniform vec3 light_direction;
-uniform int light_type;
+#ifdef LIGHTMAP
+in vec3 LocalPos;
+flat in vec4 LightmapRect;
+uniform sampler2D lightmap;
+
+// Same face/tile layout as cubeFacePoint() in lightmap_baker.hpp
+vec2 lightmapUV() {
+    vec3 a = abs(LocalPos);
+    int axis = (a.x >= a.y && a.x >= a.z) ? 0 : (a.y >= a.z ? 1 : 2);
+    int face = axis * 2 + (LocalPos[axis] >= 0.0 ? 0 : 1);
+    vec2 uv = vec2(LocalPos[(axis + 1) % 3], LocalPos[(axis + 2) % 3]) / (2.0 * a[axis]) + 0.5;
+    float tile = LightmapRect.z;
+    vec2 texel = vec2(float(face) * tile, 0.0) + 0.5 + clamp(uv, 0.0, 1.0) * (tile - 1.0);
+    return LightmapRect.xy + texel / vec2(textureSize(lightmap, 0));
+}
+#endif
 
-uniform vec3 viewPos;
-uniform float time;
+#ifdef PROBES
+// Irradiance volume: L1 SH per probe, one RGBA volume per colour channel
+uniform sampler3D probeSH_r;
+uniform sampler3D probeSH_g;
+uniform sampler3D probeSH_b;
 
-uniform int isOutline;
-uniform float outlineWidth;
+// Probes sit on texel centres, so trilinear filtering interpolates between the 8 nearest
+vec3 probeIrradiance(vec3 n) {
+    vec3 uvw = ((FragPos - probeGridOrigin) / probeGridSpacing + 0.5) / vec3(textureSize(probeSH_r, 0));
+    vec4 sh = vec4(1.0, n);
+    return max(vec3(dot(texture(probeSH_r, uvw), sh),
+                    dot(texture(probeSH_g, uvw), sh),
+                    dot(texture(probeSH_b, uvw), sh)), 0.0);
+}
+#endif
 
 void main() {
-    // Если это гизмо (GizmoType >= 0), используем фиксированный цвет
-    if (GizmoType >= 0.0) {
-        FragColor = vec4(GizmoColor, 1.0);
+#ifdef LOD_FADE
+    lodFadeDiscard();
+#endif
+#ifdef IMPOSTOR
+    vec2 uv = impostorTexCoord();
+    vec3 norm = normalize(impostorNormal());
+#else
+    vec2 uv = TexCoord;
+    vec3 norm = normalize(Normal);
+#endif
+    vec3 albedo = texture(material_diffuse, vec3(uv, Material.x)).rgb * Material.yzw;
+
+#ifdef LIGHTMAP
+    // Запечённое освещение: одна выборка из лайтмапы вместо динамического расчёта
+    if (LightmapRect.w > 0.5) {
+        FragColor = vec4(texture(lightmap, lightmapUV()).rgb * albedo, 1.0);
         return;
     }
+#endif
 
-    // Обычная логика для объектов сцены (кубы, источники света)
-    vec3 norm = normalize(Normal);
-    vec3 lightDir;
-    float diff;
-    vec3 diffuse;
+#ifdef PROBES
+    vec3 ambient = probeIrradiance(norm);
+#else
     vec3 ambient = light_ambientStrength * light_color;
+#endif
 
-    if (light_type == 0) { // Point light
-        lightDir = normalize(light_position - FragPos);
-        diff = max(dot(norm, lightDir), 0.0);
-        diffuse = diff * light_color;
-    } else if (light_type == 1) { // Directional light
-        lightDir = normalize(-light_direction);
-        diff = max(dot(norm, lightDir), 0.0);
-        diffuse = diff * light_color;
-    } else { // Ambient light
-        diffuse = vec3(0.0);
-    }
+#if defined(LIGHT_POINT) || defined(LIGHT_DIRECTIONAL)
+#ifdef LIGHT_POINT
+    vec3 lightDir = normalize(light_position - FragPos);
+#else
+    vec3 lightDir = normalize(-light_direction);
+#endif
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * light_color;
 
     vec3 viewDir = normalize(viewPos - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material_shininess);
-    vec3 specular = (light_type != 2) ? material_specular * spec * light_color : vec3(0.0);
-
-    vec3 result = (ambient + diffuse + specular) * texture(material_diffuse, TexCoord).rgb;
+    vec3 specular = material_specular * spec * light_color;
 
-    if (isLightSource > 0.5) {
-        result = light_color; // Источники света используют свой цвет
-    }
-
-    if (isOutline == 1) {
-        if (isSelected > 0.5) {
-            result = vec3(1.0, 1.0, 0.0); // Жёлтый контур для выбранных объектов
-        } else {
-            discard;
-        }
-    }
+    vec3 result = (ambient + diffuse + specular) * albedo;
+#else
+    // Только окружающий свет
+    vec3 result = ambient * albedo;
+#endif
 
     FragColor = vec4(result, 1.0);
 }
+
+#else
+// DEPTH_ONLY: только глубина
+void main() {
+#ifdef LOD_FADE
+    lodFadeDiscard();
+#endif
+#ifdef IMPOSTOR
+    impostorTexCoord();
+#endif
+}
+#endif
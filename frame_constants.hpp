@@ -0,0 +1,119 @@
+#ifndef FRAME_CONSTANTS_HPP
+#define FRAME_CONSTANTS_HPP
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <string.h>
+
+// Uniform block binding points shared by all programs
+#define FRAME_CONSTANTS_BINDING 0
+#define PASS_CONSTANTS_BINDING 1
+
+// std140 mirror of the FrameConstants block in vertex.glsl/fragment.glsl. Written once per frame.
+struct FrameConstants {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::mat4 viewProjection;
+    glm::vec3 viewPos;
+    float time;
+    glm::vec3 lightPosition;
+    int lightType;
+    glm::vec3 lightColor;
+    float lightAmbientStrength;
+    glm::vec3 lightDirection;
+    int useProbes;
+    glm::vec3 probeGridOrigin;
+    float probeGridSpacing;
+};
+
+// std140 mirror of the PassConstants block. One instance per render pass.
+struct PassConstants {
+    int isOutline;
+    float outlineWidth;
+    float padding[2];
+};
+
+// Uniform buffer split into per-frame segments. Each frame writes into the next segment,
+// so the CPU never overwrites data the GPU may still be reading; a fence per segment
+// guards the wrap-around when the CPU runs more than segmentCount frames ahead.
+class UniformRing {
+private:
+    static const int MAX_SEGMENTS = 4;
+    GLuint buffer;
+    GLsizeiptr segmentSize;
+    int segmentCount;
+    int current;
+    GLint alignment;
+    GLintptr writeOffset;
+    unsigned char* mapped;
+    GLsync fences[MAX_SEGMENTS];
+
+public:
+    UniformRing() : buffer(0), segmentSize(0), segmentCount(0), current(0), alignment(256), writeOffset(0), mapped(nullptr) {
+        for (int i = 0; i < MAX_SEGMENTS; i++) fences[i] = 0;
+    }
+
+    void init(GLsizeiptr bytesPerFrame, int segments) {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        segmentCount = segments < MAX_SEGMENTS ? segments : MAX_SEGMENTS;
+        segmentSize = (bytesPerFrame + alignment - 1) / alignment * alignment;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, segmentSize * segmentCount, NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        current = segmentCount - 1;
+    }
+
+    // Advances to the next segment and maps it for writing
+    void beginFrame() {
+        current = (current + 1) % segmentCount;
+        if (fences[current]) {
+            glClientWaitSync(fences[current], GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+            glDeleteSync(fences[current]);
+            fences[current] = 0;
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        mapped = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, current * segmentSize, segmentSize,
+                                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        writeOffset = 0;
+    }
+
+    // Copies a block into the current segment and returns its absolute buffer offset
+    GLintptr write(const void* data, GLsizeiptr size) {
+        GLintptr offset = writeOffset;
+        if (mapped && offset + size <= segmentSize) {
+            memcpy(mapped + offset, data, size);
+        }
+        writeOffset = (offset + size + alignment - 1) / alignment * alignment;
+        return current * segmentSize + offset;
+    }
+
+    // Unmaps the segment; must run before any draw that reads it
+    void endWrites() {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        mapped = nullptr;
+    }
+
+    // Marks the end of the GPU work that reads the current segment
+    void endFrame() {
+        fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void bind(GLuint binding, GLintptr offset, GLsizeiptr size) const {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+    }
+
+    void destroy() {
+        for (int i = 0; i < MAX_SEGMENTS; i++) {
+            if (fences[i]) glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef FRAME_PACER_HPP
+#define FRAME_PACER_HPP
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <thread>
+
+// Frame pacing around glfwSwapBuffers: swap interval, an optional frame-rate cap and a bound on how
+// many frames the GPU may still have queued. The cap sleeps for most of the wait and spins the
+// rest, since a plain sleep overshoots by the scheduler's granularity. Bounding the queue to one
+// frame and sampling input right after the wait keeps input-to-photon latency to about a frame.
+#define FRAME_PACER_MAX_QUEUED 3
+#define FRAME_PACER_SPIN_SECONDS 0.002 // Tail of the wait spent spinning instead of sleeping
+
+enum VsyncMode {
+    VSYNC_OFF,
+    VSYNC_ON,
+    VSYNC_ADAPTIVE // Tears instead of waiting a whole interval when a frame is late
+};
+
+class FramePacer {
+private:
+    GLsync fences[FRAME_PACER_MAX_QUEUED] = {};
+    int nextFence = 0;
+    double nextFrameTime = 0.0;
+
+public:
+    // Needs the context current. Adaptive falls back to regular vsync without the swap-tear
+    // extension; returns the interval actually set.
+    int setVsync(VsyncMode mode) {
+        int interval = mode == VSYNC_OFF ? 0 : 1;
+        if (mode == VSYNC_ADAPTIVE && isAdaptiveVsyncSupported()) interval = -1;
+        glfwSwapInterval(interval);
+        return interval;
+    }
+
+    static bool isAdaptiveVsyncSupported() {
+        return glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+    }
+
+    // Waits until the next frame is due at targetFps; 0 turns the cap off
+    void limit(double targetFps) {
+        double now = glfwGetTime();
+        if (targetFps <= 0.0) {
+            nextFrameTime = now;
+            return;
+        }
+        double period = 1.0 / targetFps;
+        // Late by more than a frame (or just enabled): start over instead of rushing to catch up
+        if (nextFrameTime < now - period || nextFrameTime > now + period) nextFrameTime = now;
+        double sleepSeconds = nextFrameTime - now - FRAME_PACER_SPIN_SECONDS;
+        if (sleepSeconds > 0.0) std::this_thread::sleep_for(std::chrono::duration<double>(sleepSeconds));
+        while (glfwGetTime() < nextFrameTime) {
+            std::this_thread::yield();
+        }
+        nextFrameTime += period;
+    }
+
+    // Blocks until fewer than maxQueued earlier frames are unfinished on the GPU, so counting the
+    // frame about to be built at most maxQueued are in flight; 1 waits for the GPU to go idle
+    void waitQueued(int maxQueued) {
+        if (maxQueued < 1) maxQueued = 1;
+        if (maxQueued > FRAME_PACER_MAX_QUEUED) maxQueued = FRAME_PACER_MAX_QUEUED;
+        for (int age = FRAME_PACER_MAX_QUEUED; age >= maxQueued; age--) {
+            // Fence of the frame submitted age frames ago
+            GLsync& fence = fences[(nextFence + FRAME_PACER_MAX_QUEUED - age) % FRAME_PACER_MAX_QUEUED];
+            if (!fence) continue;
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(100000000)) == GL_TIMEOUT_EXPIRED) {}
+            glDeleteSync(fence);
+            fence = 0;
+        }
+    }
+
+    // After glfwSwapBuffers: marks the end of this frame's GPU work
+    void endFrame() {
+        GLsync& fence = fences[nextFence];
+        if (fence) glDeleteSync(fence);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        nextFence = (nextFence + 1) % FRAME_PACER_MAX_QUEUED;
+    }
+
+    void destroy() {
+        for (GLsync& fence : fences) {
+            if (fence) glDeleteSync(fence);
+            fence = 0;
+        }
+    }
+};
+
+#endif
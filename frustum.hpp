@@ -0,0 +1,36 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+// Six inward-facing planes (xyz = unit normal, w = distance) extracted from a view-projection
+// matrix: left, right, bottom, top, near, far
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+inline Frustum frustumFromMatrix(const glm::mat4& viewProjection) {
+    Frustum frustum;
+    glm::vec4 rows[4];
+    for (int r = 0; r < 4; r++) {
+        rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+    }
+    for (int i = 0; i < 3; i++) {
+        frustum.planes[i * 2] = rows[3] + rows[i];
+        frustum.planes[i * 2 + 1] = rows[3] - rows[i];
+    }
+    for (auto& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+// Conservative: true unless the sphere lies entirely outside one plane
+inline bool frustumIntersectsSphere(const Frustum& frustum, const glm::vec3& center, float radius) {
+    for (const auto& plane : frustum.planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+    }
+    return true;
+}
+
+#endif
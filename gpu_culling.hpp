@@ -0,0 +1,254 @@
+#ifndef GPU_CULLING_HPP
+#define GPU_CULLING_HPP
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "depth_pyramid.hpp"
+#include "frustum.hpp"
+#include "shader_variants.hpp"
+
+// GPU-driven culling for GL 4.3+ (cull.glsl). Instances are uploaded once per scene change; each
+// frame three compute passes do frustum culling, screen-space-error LOD and impostor selection
+// with hysteresis and cross-fade state, compact the survivors into per-(mesh, LOD, fading) lists
+// of instance references and write DrawElementsIndirect arguments for every list. The vertex
+// shader (GPU_DRIVEN) reads the reference through an instanced attribute, so baseInstance picks
+// the list, and fetches the instance from a texture buffer.
+//
+// With occlusion on, every list exists twice. cull() fills the early lists with instances that
+// passed the occlusion test last frame; once they are drawn and a DepthPyramid is built from their
+// depth, cullOccluded() re-tests everything in view and fills the late lists with the instances
+// that became visible.
+
+#define GPU_CULL_GROUP_SIZE 64
+#define GPU_REFERENCE_LOCATION 13
+#define INSTANCE_DATA_TEXELS 7 // model (4 columns), lightmap rect, material, (object id bits, 0, intensity, 0)
+
+// std430 mirrors of the structs in cull.glsl
+struct CullInstance {
+    glm::vec4 positionScale;
+    uint32_t group;
+    uint32_t pad[3];
+};
+
+struct CullGroup {
+    glm::vec4 errors;         // Per-LOD error in mesh units, w = bounding radius
+    uint32_t indexCounts[4];  // Per-LOD index count, [3] = impostor quad indices or 0
+};
+
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+struct CullParams {
+    Frustum frustum;
+    glm::vec3 cameraPosition;
+    float pixelScale;
+    float lodThreshold;   // pixelError * qualityBias
+    float lodHysteresis;
+    float impostorPixels; // impostorPixels * qualityBias, 0 = never
+    float fadeStep;       // Cross-fade progress per frame, 0 = off
+    bool occlusion;       // Two-phase occlusion culling; cullOccluded() must follow the early draws
+};
+
+enum CullPhase { CULL_PHASE_EARLY, CULL_PHASE_LATE, CULL_PHASE_COUNT };
+
+class GpuCuller {
+private:
+    enum { PASS_CLASSIFY, PASS_OCCLUSION, PASS_OFFSETS, PASS_SCATTER, PASS_COUNT };
+    GLuint programs[PASS_COUNT] = { 0, 0, 0, 0 };
+    GLuint instanceBuffer = 0, groupBuffer = 0, stateBuffer = 0, countBuffer = 0;
+    GLuint commandBuffer = 0, referenceBuffer = 0, instanceDataBuffer = 0, instanceDataTexture = 0;
+    uint32_t instanceCount = 0;
+    uint32_t listCount = 0;
+    int tiers = 0; // LODs + impostor
+    bool lateListsValid = false;
+
+    void setUniforms(GLuint program, const CullParams& params, int phase) const {
+        glUniform1ui(glGetUniformLocation(program, "instanceCount"), instanceCount);
+        glUniform1ui(glGetUniformLocation(program, "listCount"), listCount);
+        glUniform1ui(glGetUniformLocation(program, "phase"), phase);
+        glUniform1i(glGetUniformLocation(program, "occlusion"), params.occlusion ? 1 : 0);
+        glUniform4fv(glGetUniformLocation(program, "frustumPlanes"), 6, &params.frustum.planes[0].x);
+        glUniform3fv(glGetUniformLocation(program, "cameraPosition"), 1, &params.cameraPosition.x);
+        glUniform1f(glGetUniformLocation(program, "pixelScale"), params.pixelScale);
+        glUniform1f(glGetUniformLocation(program, "lodThreshold"), params.lodThreshold);
+        glUniform1f(glGetUniformLocation(program, "lodHysteresis"), params.lodHysteresis);
+        glUniform1f(glGetUniformLocation(program, "impostorPixels"), params.impostorPixels);
+        glUniform1f(glGetUniformLocation(program, "fadeStep"), params.fadeStep);
+    }
+
+    void bindBuffers() const {
+        GLuint bindings[] = { instanceBuffer, groupBuffer, stateBuffer, countBuffer, commandBuffer, referenceBuffer };
+        for (GLuint i = 0; i < 6; i++) {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, bindings[i]);
+        }
+    }
+
+    // Per-instance pass, then offsets and scatter for one phase's lists
+    void runPhase(GLuint classifyProgram, const CullParams& params, int phase) const {
+        GLuint workGroups = (instanceCount + GPU_CULL_GROUP_SIZE - 1) / GPU_CULL_GROUP_SIZE;
+        GLuint passes[] = { classifyProgram, programs[PASS_OFFSETS], programs[PASS_SCATTER] };
+        for (GLuint program : passes) {
+            glUseProgram(program);
+            setUniforms(program, params, phase);
+            if (program == programs[PASS_OFFSETS]) glDispatchCompute(1, 1, 1);
+            else if (workGroups) glDispatchCompute(workGroups, 1, 1);
+            glMemoryBarrier(program == programs[PASS_SCATTER] ? GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT : GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+        glUseProgram(0);
+    }
+
+public:
+    static bool isSupported() {
+        return GLEW_VERSION_4_3;
+    }
+
+    // source: cull.glsl with #include already expanded. lodCount must be at most 3 (vec4 packing).
+    bool init(const std::string& source, int lodCount) {
+        if (!isSupported() || lodCount > 3) return false;
+        tiers = lodCount + 1;
+        const char* passes[PASS_COUNT] = { "CULL_CLASSIFY", "CULL_OCCLUSION", "CULL_OFFSETS", "CULL_SCATTER" };
+        for (int pass = 0; pass < PASS_COUNT; pass++) {
+            std::string defines = "#define NUM_LODS " + std::to_string(lodCount) + "\n#define " + passes[pass] + "\n";
+            programs[pass] = createComputeProgram(injectDefines(source, defines));
+            if (!programs[pass]) {
+                destroy();
+                return false;
+            }
+        }
+        glUseProgram(programs[PASS_OCCLUSION]);
+        glUniform1i(glGetUniformLocation(programs[PASS_OCCLUSION], "depthPyramid"), DEPTH_PYRAMID_TEXTURE_UNIT);
+        glUseProgram(0);
+        GLuint* buffers[] = { &instanceBuffer, &groupBuffer, &stateBuffer, &countBuffer, &commandBuffer, &referenceBuffer, &instanceDataBuffer };
+        for (GLuint* buffer : buffers) {
+            glGenBuffers(1, buffer);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, *buffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glGenTextures(1, &instanceDataTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, instanceDataTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instanceDataBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        return true;
+    }
+
+    bool isReady() const {
+        return programs[PASS_CLASSIFY] != 0;
+    }
+
+    // One group per mesh; lists are allocated for every (phase, group, tier, fading) combination
+    void setGroups(const std::vector<CullGroup>& groups) {
+        listCount = (uint32_t)groups.size() * tiers * 2 * CULL_PHASE_COUNT;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, groupBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, groups.size() * sizeof(CullGroup), groups.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, listCount * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, listCount * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // Only on layout changes. LOD state survives while the instance count stays the same.
+    void setInstances(const std::vector<CullInstance>& instances, const std::vector<glm::vec4>& instanceData) {
+        bool resized = instances.size() != instanceCount;
+        instanceCount = (uint32_t)instances.size();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(CullInstance), instances.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceDataBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, instanceData.size() * sizeof(glm::vec4), instanceData.data(), GL_DYNAMIC_DRAW);
+        if (resized) {
+            // Нет уровня, нет перехода
+            std::vector<GLuint> states(instanceCount, 0x00FFFFFFu);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, stateBuffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, states.size() * sizeof(GLuint), states.data(), GL_DYNAMIC_DRAW);
+            // Экземпляр в переходе попадает в два списка
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, referenceBuffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, (size_t)instanceCount * 2 * sizeof(GLuint) * 2, nullptr, GL_DYNAMIC_DRAW);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // Rewrites instances [first, first + count) in place, e.g. after a transform edit
+    void updateInstances(size_t first, size_t count, const CullInstance* instances, const glm::vec4* instanceData) {
+        if (!count || first + count > instanceCount) return;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, first * sizeof(CullInstance), count * sizeof(CullInstance), instances);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceDataBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, first * INSTANCE_DATA_TEXELS * sizeof(glm::vec4), count * INSTANCE_DATA_TEXELS * sizeof(glm::vec4), instanceData);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // Frustum, LOD and early lists. Without occlusion the early lists hold everything in view.
+    void cull(const CullParams& params) {
+        lateListsValid = false;
+        if (!listCount) return;
+        bindBuffers();
+        GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        runPhase(programs[PASS_CLASSIFY], params, CULL_PHASE_EARLY);
+    }
+
+    // Late lists: tests every instance in view against the pyramid built from the early draws and
+    // records the result for next frame's early lists. viewProjection must be the one used to cull.
+    void cullOccluded(const CullParams& params, const DepthPyramid& pyramid, const glm::mat4& viewProjection) {
+        if (!listCount || !pyramid.getTexture()) return;
+        bindBuffers();
+        glActiveTexture(GL_TEXTURE0 + DEPTH_PYRAMID_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, pyramid.getTexture());
+        glActiveTexture(GL_TEXTURE0);
+        glUseProgram(programs[PASS_OCCLUSION]);
+        glUniformMatrix4fv(glGetUniformLocation(programs[PASS_OCCLUSION], "viewProjection"), 1, GL_FALSE, &viewProjection[0][0]);
+        runPhase(programs[PASS_OCCLUSION], params, CULL_PHASE_LATE);
+        lateListsValid = true;
+    }
+    // Adds the instanced reference attribute to a mesh VAO; the buffer name stays valid across resizes
+    void bindReferences(GLuint vao) const {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, referenceBuffer);
+        glVertexAttribIPointer(GPU_REFERENCE_LOCATION, 2, GL_UNSIGNED_INT, 2 * sizeof(GLuint), (void*)0);
+        glEnableVertexAttribArray(GPU_REFERENCE_LOCATION);
+        glVertexAttribDivisor(GPU_REFERENCE_LOCATION, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    // Draws one list with the VAO and program already bound. Late lists are empty until cullOccluded().
+    void drawList(int group, int tier, bool fading, int phase) const {
+        if (phase == CULL_PHASE_LATE && !lateListsValid) return;
+        size_t list = (size_t)phase * (listCount / CULL_PHASE_COUNT) + ((size_t)group * tiers + tier) * 2 + (fading ? 1 : 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(list * sizeof(DrawElementsIndirectCommand)));
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    GLuint getInstanceDataTexture() const {
+        return instanceDataTexture;
+    }
+
+    void destroy() {
+        for (GLuint& program : programs) {
+            if (program) glDeleteProgram(program);
+            program = 0;
+        }
+        GLuint buffers[] = { instanceBuffer, groupBuffer, stateBuffer, countBuffer, commandBuffer, referenceBuffer, instanceDataBuffer };
+        for (GLuint buffer : buffers) {
+            if (buffer) glDeleteBuffers(1, &buffer);
+        }
+        instanceBuffer = groupBuffer = stateBuffer = countBuffer = commandBuffer = referenceBuffer = instanceDataBuffer = 0;
+        if (instanceDataTexture) glDeleteTextures(1, &instanceDataTexture);
+        instanceDataTexture = 0;
+        instanceCount = listCount = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef IMAGE_LOADER_HPP
+#define IMAGE_LOADER_HPP
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Uncompressed RGBA8 image, rows bottom to top: the order glTexImage takes them in, which the
+// mesh UVs were authored against (BMP stores rows the same way)
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+// Decodes an uncompressed 24 or 32-bit BMP into RGBA8. Does not touch GL, safe on any thread.
+inline bool decodeBMP(const char* filename, Image& image) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        printf("Failed to open texture file: %s\n", filename);
+        return false;
+    }
+
+    unsigned char header[54];
+    if (fread(header, 1, 54, file) != 54 || header[0] != 'B' || header[1] != 'M') {
+        printf("Not a BMP file: %s\n", filename);
+        fclose(file);
+        return false;
+    }
+
+    uint32_t dataOffset;
+    int32_t width, height;
+    uint16_t bitsPerPixel;
+    uint32_t compression;
+    memcpy(&dataOffset, &header[10], 4);
+    memcpy(&width, &header[18], 4);
+    memcpy(&height, &header[22], 4);
+    memcpy(&bitsPerPixel, &header[28], 2);
+    memcpy(&compression, &header[30], 4);
+    // BI_RGB or BI_BITFIELDS with the usual BGRA masks
+    if ((bitsPerPixel != 24 && bitsPerPixel != 32) || (compression != 0 && compression != 3) || width <= 0 || height == 0) {
+        printf("Unsupported BMP format (%d bpp, compression %u): %s\n", bitsPerPixel, compression, filename);
+        fclose(file);
+        return false;
+    }
+
+    // Positive height means rows are stored bottom-up, as Image wants them
+    bool bottomUp = height > 0;
+    if (height < 0) height = -height;
+    int bytesPerPixel = bitsPerPixel / 8;
+    size_t stride = ((size_t)width * bytesPerPixel + 3) & ~(size_t)3;
+    std::vector<unsigned char> data(stride * height);
+    if (fseek(file, dataOffset, SEEK_SET) != 0 || fread(data.data(), 1, data.size(), file) != data.size()) {
+        printf("Truncated BMP file: %s\n", filename);
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height * 4);
+    for (int y = 0; y < height; y++) {
+        const unsigned char* src = &data[stride * (bottomUp ? y : height - 1 - y)];
+        unsigned char* dst = &image.pixels[(size_t)y * width * 4];
+        for (int x = 0; x < width; x++) {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+            dst[3] = bytesPerPixel == 4 ? src[3] : 255;
+            src += bytesPerPixel;
+            dst += 4;
+        }
+    }
+    return true;
+}
+
+// Bilinear resample to an exact size (texture array layers must all match)
+inline void resizeImage(const Image& src, int width, int height, Image& dst) {
+    dst.width = width;
+    dst.height = height;
+    dst.pixels.resize((size_t)width * height * 4);
+    for (int y = 0; y < height; y++) {
+        float fy = (y + 0.5f) * src.height / height - 0.5f;
+        int y0 = fy < 0.0f ? 0 : (int)fy;
+        int y1 = y0 + 1 < src.height ? y0 + 1 : src.height - 1;
+        float ty = fy - y0 < 0.0f ? 0.0f : fy - y0;
+        for (int x = 0; x < width; x++) {
+            float fx = (x + 0.5f) * src.width / width - 0.5f;
+            int x0 = fx < 0.0f ? 0 : (int)fx;
+            int x1 = x0 + 1 < src.width ? x0 + 1 : src.width - 1;
+            float tx = fx - x0 < 0.0f ? 0.0f : fx - x0;
+            for (int c = 0; c < 4; c++) {
+                float top = src.pixels[((size_t)y0 * src.width + x0) * 4 + c] * (1.0f - tx) + src.pixels[((size_t)y0 * src.width + x1) * 4 + c] * tx;
+                float bottom = src.pixels[((size_t)y1 * src.width + x0) * 4 + c] * (1.0f - tx) + src.pixels[((size_t)y1 * src.width + x1) * 4 + c] * tx;
+                dst.pixels[((size_t)y * width + x) * 4 + c] = (unsigned char)(top * (1.0f - ty) + bottom * ty + 0.5f);
+            }
+        }
+    }
+}
+
+// Box-filtered mip chain down to 1x1; mips[0] is the source image. Replaces glGenerateMipmap,
+// which would otherwise run on the GL thread.
+inline void buildMipChain(const Image& base, std::vector<Image>& mips) {
+    mips.clear();
+    mips.push_back(base);
+    while (mips.back().width > 1 || mips.back().height > 1) {
+        const Image& src = mips.back();
+        Image dst;
+        dst.width = src.width > 1 ? src.width / 2 : 1;
+        dst.height = src.height > 1 ? src.height / 2 : 1;
+        dst.pixels.resize((size_t)dst.width * dst.height * 4);
+        for (int y = 0; y < dst.height; y++) {
+            int y0 = y * 2 < src.height ? y * 2 : src.height - 1;
+            int y1 = y * 2 + 1 < src.height ? y * 2 + 1 : y0;
+            for (int x = 0; x < dst.width; x++) {
+                int x0 = x * 2 < src.width ? x * 2 : src.width - 1;
+                int x1 = x * 2 + 1 < src.width ? x * 2 + 1 : x0;
+                for (int c = 0; c < 4; c++) {
+                    int sum = src.pixels[((size_t)y0 * src.width + x0) * 4 + c] + src.pixels[((size_t)y0 * src.width + x1) * 4 + c]
+                            + src.pixels[((size_t)y1 * src.width + x0) * 4 + c] + src.pixels[((size_t)y1 * src.width + x1) * 4 + c];
+                    dst.pixels[((size_t)y * dst.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+        mips.push_back(std::move(dst));
+    }
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef IMPOSTORS_HPP
+#define IMPOSTORS_HPP
+
+#include <math.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Octahedral impostors: each mesh is rendered orthographically from IMPOSTOR_GRID x IMPOSTOR_GRID
+// directions spread over the whole sphere by the octahedral map, one frame per atlas tile. Far
+// instances draw a single quad showing the frame nearest to their view direction. The atlas stores
+// mesh UVs and object-space normals rather than colour, so per-instance materials and the current
+// lighting still apply.
+#define IMPOSTOR_GRID 8
+#define IMPOSTOR_FRAME_SIZE 64
+#define IMPOSTOR_ATLAS_SIZE (IMPOSTOR_GRID * IMPOSTOR_FRAME_SIZE)
+
+// Octahedral map: [-1,1]^2 -> unit direction. Must match impostorDirection() in vertex.glsl.
+inline glm::vec3 octahedralDirection(float x, float y) {
+    glm::vec3 d(x, y, 1.0f - fabsf(x) - fabsf(y));
+    if (d.z < 0.0f) {
+        float ox = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float oy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        d.x = ox;
+        d.y = oy;
+    }
+    return glm::normalize(d);
+}
+
+// Object-space direction from the mesh centre towards the viewer of one atlas frame
+inline glm::vec3 impostorFrameDirection(int frameX, int frameY) {
+    return octahedralDirection((frameX + 0.5f) / IMPOSTOR_GRID * 2.0f - 1.0f, (frameY + 0.5f) / IMPOSTOR_GRID * 2.0f - 1.0f);
+}
+
+// Orthographic view-projection that fits a sphere of the given radius, looking at the origin from
+// direction. The billboard basis in vertex.glsl uses the same up vector choice.
+inline glm::mat4 impostorFrameViewProjection(const glm::vec3& direction, float radius) {
+    glm::vec3 up = fabsf(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 view = glm::lookAt(direction * (radius * 2.0f), glm::vec3(0.0f), up);
+    glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, radius * 0.5f, radius * 3.5f);
+    return projection * view;
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef INPUT_QUEUE_HPP
+#define INPUT_QUEUE_HPP
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+// Window input gathered by the GLFW callbacks and drained once per frame by the frame loop.
+// Keys and mouse buttons go through a single-producer/single-consumer ring in order; cursor motion
+// never enters the ring, only the latest position is kept, so a high polling rate mouse costs the
+// frame nothing extra.
+#define INPUT_QUEUE_CAPACITY 256 // Power of two; discrete events per frame are far fewer
+#define INPUT_KEY_COUNT 512      // Covers GLFW_KEY_LAST
+
+enum InputEventType : uint8_t {
+    INPUT_KEY,
+    INPUT_MOUSE_BUTTON
+};
+
+struct InputEvent {
+    InputEventType type;
+    uint8_t action; // GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+    uint16_t mods;
+    int32_t code;   // Key or mouse button
+    float x, y;     // Cursor when the event arrived, so a click lands where it happened
+};
+
+class InputQueue {
+private:
+    InputEvent events[INPUT_QUEUE_CAPACITY];
+    std::atomic<uint32_t> head{0}; // Next write, owned by the producer
+    std::atomic<uint32_t> tail{0}; // Next read, owned by the consumer
+    std::atomic<uint64_t> cursor{0}; // Latest position, two floats in one word so it never tears
+    std::atomic<bool> cursorKnown{false};
+    std::atomic<uint32_t> dropped{0};
+
+public:
+    // Producer side. Returns false (and counts the event) when the ring is full.
+    bool push(const InputEvent& event) {
+        uint32_t write = head.load(std::memory_order_relaxed);
+        if (write - tail.load(std::memory_order_acquire) == INPUT_QUEUE_CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        events[write & (INPUT_QUEUE_CAPACITY - 1)] = event;
+        head.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    void setCursor(double x, double y) {
+        float position[2] = { (float)x, (float)y };
+        uint64_t bits;
+        memcpy(&bits, position, sizeof(bits));
+        cursor.store(bits, std::memory_order_release);
+        cursorKnown.store(true, std::memory_order_release);
+    }
+
+    // Consumer side
+    bool pop(InputEvent& event) {
+        uint32_t read = tail.load(std::memory_order_relaxed);
+        if (read == head.load(std::memory_order_acquire)) return false;
+        event = events[read & (INPUT_QUEUE_CAPACITY - 1)];
+        tail.store(read + 1, std::memory_order_release);
+        return true;
+    }
+
+    // False until the first motion
+    bool getCursor(float& x, float& y) const {
+        if (!cursorKnown.load(std::memory_order_acquire)) return false;
+        uint64_t bits = cursor.load(std::memory_order_acquire);
+        float position[2];
+        memcpy(position, &bits, sizeof(bits));
+        x = position[0];
+        y = position[1];
+        return true;
+    }
+
+    // Events lost to a full ring since the last call
+    uint32_t takeDropped() {
+        return dropped.exchange(0, std::memory_order_relaxed);
+    }
+};
+
+// Held keys as a bitmap, updated from the drained events
+class KeyBitmap {
+private:
+    uint64_t words[INPUT_KEY_COUNT / 64] = {};
+
+public:
+    void set(int key, bool down) {
+        if (key < 0 || key >= INPUT_KEY_COUNT) return;
+        uint64_t bit = 1ull << (key & 63);
+        if (down) words[key >> 6] |= bit;
+        else words[key >> 6] &= ~bit;
+    }
+
+    bool isDown(int key) const {
+        if (key < 0 || key >= INPUT_KEY_COUNT) return false;
+        return (words[key >> 6] >> (key & 63)) & 1u;
+    }
+
+    void clear() {
+        memset(words, 0, sizeof(words));
+    }
+};
+
+#endif
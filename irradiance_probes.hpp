@@ -0,0 +1,202 @@
+#ifndef IRRADIANCE_PROBES_HPP
+#define IRRADIANCE_PROBES_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <cfloat>
+#include "scene.hpp"
+#include "lightmap_baker.hpp"
+
+struct ProbeSettings {
+    float spacing = 1.0f;       // World units between neighbouring probes
+    float margin = 1.0f;        // Extra space around the cube bounds
+    int maxProbesPerAxis = 32;
+    int samplesPerProbe = 256;
+    int probesPerFrame = 8;     // Incremental update budget
+};
+
+// Regular grid of L1 spherical-harmonic irradiance probes.
+// Coefficients are stored premultiplied by the cosine-lobe convolution and 1/pi, so the
+// shader evaluates the lighting factor for normal n as c0 + c1 * n.x + c2 * n.y + c3 * n.z.
+class IrradianceProbeGrid {
+private:
+    ProbeSettings settings;
+    BakeSettings bakeSettings;
+    glm::vec3 origin;
+    glm::ivec3 counts;
+    std::vector<glm::vec4> channels[3]; // Per colour channel: (c0, cx, cy, cz) for every probe
+    std::unique_ptr<LightmapBaker> baker;
+    unsigned bakerSceneVersion;                          // Scene version the current baker was built from
+    std::future<std::unique_ptr<LightmapBaker>> nextBaker; // Built on a worker from a newer snapshot
+    int cursor;
+    std::vector<int> dirtyProbes;
+
+    glm::vec3 probePosition(int index) const {
+        int x = index % counts.x;
+        int y = (index / counts.x) % counts.y;
+        int z = index / (counts.x * counts.y);
+        return origin + glm::vec3((float)x, (float)y, (float)z) * settings.spacing;
+    }
+
+    // Projects incoming radiance onto L1 SH with a Fibonacci sphere rotated per probe
+    void bakeProbe(int index) {
+        BakeRandom rng((uint64_t)bakeSettings.seed * 0x100000001ull + (uint64_t)index);
+        glm::vec3 sh[4] = { glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f) };
+        const int n = settings.samplesPerProbe;
+        const float goldenAngle = 2.39996323f;
+        float rotation = rng.next() * 6.28318531f;
+        Ray ray;
+        ray.origin = probePosition(index);
+        for (int i = 0; i < n; i++) {
+            float z = 1.0f - (2.0f * i + 1.0f) / n;
+            float r = std::sqrt(glm::max(0.0f, 1.0f - z * z));
+            float phi = goldenAngle * i + rotation;
+            ray.dir = glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+            glm::vec3 L = baker->radiance(ray, rng);
+            sh[0] += L * 0.282095f;
+            sh[1] += L * (0.488603f * ray.dir.x);
+            sh[2] += L * (0.488603f * ray.dir.y);
+            sh[3] += L * (0.488603f * ray.dir.z);
+        }
+        // Monte Carlo weight 4pi/n, then irradiance convolution (pi, 2pi/3) and 1/pi
+        float weight = 4.0f * 3.14159265f / n;
+        glm::vec3 c0 = sh[0] * (weight * 0.282095f);
+        glm::vec3 c1 = sh[1] * (weight * 0.488603f * (2.0f / 3.0f));
+        glm::vec3 c2 = sh[2] * (weight * 0.488603f * (2.0f / 3.0f));
+        glm::vec3 c3 = sh[3] * (weight * 0.488603f * (2.0f / 3.0f));
+        for (int c = 0; c < 3; c++) {
+            channels[c][index] = glm::vec4(c0[c], c1[c], c2[c], c3[c]);
+        }
+    }
+
+    // Swaps in the baker built on a worker once it is ready and starts the next build when the
+    // scene changed since the current one was taken. The render thread only copies the scene.
+    void refreshBaker(const Scene& scene) {
+        if (nextBaker.valid()) {
+            if (nextBaker.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+            baker = nextBaker.get();
+        }
+        if (scene.getVersion() == bakerSceneVersion) return;
+        bakerSceneVersion = scene.getVersion();
+        nextBaker = std::async(std::launch::async, [bake = bakeSettings, snapshot = scene]() {
+            return std::unique_ptr<LightmapBaker>(new LightmapBaker(snapshot, bake));
+        });
+    }
+
+public:
+    IrradianceProbeGrid() : origin(0.0f), counts(0, 0, 0), bakerSceneVersion(0), cursor(0) {}
+
+    // Fits the grid around all cubes and allocates (unbaked) probes. Builds the ray-tracing BVH
+    // over every cube, so large scenes should configure and bake on a worker thread.
+    void configure(const Scene& scene, const ProbeSettings& probeSettings, const BakeSettings& bake) {
+        settings = probeSettings;
+        bakeSettings = bake;
+        glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+        for (const auto& obj : scene.getObjects()) {
+            if (!obj.isVisible || obj.type != CUBE) continue;
+            boundsMin = glm::min(boundsMin, obj.position - glm::vec3(obj.scale));
+            boundsMax = glm::max(boundsMax, obj.position + glm::vec3(obj.scale));
+        }
+        if (boundsMin.x > boundsMax.x) {
+            boundsMin = glm::vec3(-1.0f);
+            boundsMax = glm::vec3(1.0f);
+        }
+        boundsMin -= glm::vec3(settings.margin);
+        boundsMax += glm::vec3(settings.margin);
+        glm::vec3 extent = boundsMax - boundsMin;
+        settings.spacing = glm::max(settings.spacing, glm::max(extent.x, glm::max(extent.y, extent.z)) / (settings.maxProbesPerAxis - 1));
+        for (int a = 0; a < 3; a++) {
+            counts[a] = (int)std::ceil(extent[a] / settings.spacing) + 1;
+        }
+        origin = boundsMin;
+        for (int c = 0; c < 3; c++) {
+            channels[c].assign(getProbeCount(), glm::vec4(0.0f));
+        }
+        baker.reset(new LightmapBaker(scene, bakeSettings));
+        bakerSceneVersion = scene.getVersion();
+        cursor = 0;
+        dirtyProbes.clear();
+    }
+
+    // Bakes every probe, spread over all cores. progress counts probes as tiles; once cancel
+    // is raised the remaining probes stay black.
+    void bakeAll(BakeProgress* progress = nullptr) {
+        std::atomic<int> next(0);
+        int total = getProbeCount();
+        if (progress) progress->totalTiles = total;
+        auto worker = [&]() {
+            for (int i = next.fetch_add(1); i < total; i = next.fetch_add(1)) {
+                if (progress && progress->cancel.load(std::memory_order_relaxed)) break;
+                bakeProbe(i);
+                if (progress) progress->completedTiles.fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+        int threadCount = bakeSettings.threadCount > 0 ? bakeSettings.threadCount : (int)std::thread::hardware_concurrency();
+        std::vector<std::thread> threads;
+        for (int i = 1; i < threadCount; i++) threads.emplace_back(worker);
+        worker();
+        for (auto& t : threads) t.join();
+        dirtyProbes.clear();
+        cursor = 0;
+    }
+
+    // Re-bakes up to probesPerFrame probes round-robin. A sweep picks up the newest baker
+    // finished in the background, so edits show up within a sweep or two of the rebuild.
+    void updateIncremental(const Scene& scene) {
+        int total = getProbeCount();
+        if (total == 0) return;
+        for (int i = 0; i < settings.probesPerFrame; i++) {
+            if (cursor == 0) refreshBaker(scene);
+            bakeProbe(cursor);
+            dirtyProbes.push_back(cursor);
+            cursor = (cursor + 1) % total;
+        }
+    }
+
+    // True while a background baker build is running; replacing the grid then would wait for it
+    bool isRefreshingBaker() const {
+        return nextBaker.valid() && nextBaker.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    }
+
+    // Probes changed by updateIncremental() since the last call
+    std::vector<int> takeDirtyProbes() {
+        std::vector<int> result;
+        result.swap(dirtyProbes);
+        return result;
+    }
+
+    glm::ivec3 probeCoord(int index) const {
+        return glm::ivec3(index % counts.x, (index / counts.x) % counts.y, index / (counts.x * counts.y));
+    }
+
+    int getProbeCount() const {
+        return counts.x * counts.y * counts.z;
+    }
+
+    glm::ivec3 getCounts() const {
+        return counts;
+    }
+
+    glm::vec3 getOrigin() const {
+        return origin;
+    }
+
+    float getSpacing() const {
+        return settings.spacing;
+    }
+
+    const std::vector<glm::vec4>& getChannel(int c) const {
+        return channels[c];
+    }
+
+    ProbeSettings& getSettings() {
+        return settings;
+    }
+};
+
+#endif
@@ -0,0 +1,288 @@
+#ifndef LIGHTMAP_BAKER_HPP
+#define LIGHTMAP_BAKER_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include "scene.hpp"
+#include "bvh.hpp"
+
+struct BakeSettings {
+    int texelsPerFace = 8;     // Each cube face gets a texelsPerFace x texelsPerFace tile
+    int samplesPerTexel = 64;
+    int maxBounces = 2;
+    glm::vec3 albedo = glm::vec3(0.7f); // Surface reflectance used for indirect bounces
+    uint32_t seed = 1;
+    int threadCount = 0;       // 0 = hardware_concurrency
+    int maxAtlasSize = 0;      // Atlas width/height limit, e.g. GL_MAX_TEXTURE_SIZE; 0 = none
+};
+
+// Lighting factor per texel, multiplied by the diffuse texture at runtime.
+// Each baked cube owns a strip of 6 face tiles; rects hold (u0, v0, texelsPerFace, 1) in atlas UV space.
+struct BakedLightmap {
+    int width = 0;
+    int height = 0;
+    std::vector<glm::vec3> texels;
+    std::unordered_map<int, glm::vec4> rects;
+};
+
+// Shared with the thread that started a bake: it can raise cancel at any time and read
+// completedTiles / totalTiles to show progress. Reset it before starting the next bake.
+struct BakeProgress {
+    std::atomic<bool> cancel{false};
+    std::atomic<int> completedTiles{0};
+    std::atomic<int> totalTiles{0};
+
+    void reset() {
+        cancel = false;
+        completedTiles = 0;
+        totalTiles = 0;
+    }
+};
+
+// Deterministic per-texel random stream so results do not depend on thread scheduling
+class BakeRandom {
+private:
+    uint64_t state;
+
+public:
+    explicit BakeRandom(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ull + 0x632BE59BD9B4E019ull) {}
+
+    float next() {
+        state += 0x9E3779B97F4A7C15ull;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z ^= z >> 31;
+        return (float)(z >> 40) / (float)(1ull << 24);
+    }
+};
+
+// Face f: axis f / 2, sign + for even f. Tangent axes are the next two axes in order.
+// fragment.glsl uses the same mapping to look the tile up from the object-space position.
+inline glm::vec3 cubeFacePoint(int face, float u, float v) {
+    int axis = face / 2;
+    glm::vec3 p(0.0f);
+    p[axis] = (face % 2 == 0) ? 0.5f : -0.5f;
+    p[(axis + 1) % 3] = u - 0.5f;
+    p[(axis + 2) % 3] = v - 0.5f;
+    return p;
+}
+
+class LightmapBaker {
+private:
+    struct BakeLight {
+        ObjectType type;
+        glm::vec3 position;
+        glm::vec3 direction;
+        glm::vec3 radiance;
+    };
+
+    BakeSettings settings;
+    BVH bvh;
+    std::vector<BakeLight> lights;
+    glm::vec3 environment;
+
+    static glm::vec3 orthogonal(const glm::vec3& n) {
+        return glm::abs(n.x) > 0.9f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    }
+
+    static glm::vec3 cosineSample(const glm::vec3& n, float r1, float r2) {
+        glm::vec3 t = glm::normalize(glm::cross(orthogonal(n), n));
+        glm::vec3 b = glm::cross(n, t);
+        float phi = 2.0f * 3.14159265f * r1;
+        float r = std::sqrt(r2);
+        return glm::normalize(t * (r * std::cos(phi)) + b * (r * std::sin(phi)) + n * std::sqrt(1.0f - r2));
+    }
+
+    glm::vec3 directLighting(const glm::vec3& p, const glm::vec3& n) const {
+        glm::vec3 result(0.0f);
+        for (const auto& light : lights) {
+            Ray shadow;
+            shadow.origin = p + n * 1e-3f;
+            float maxDist;
+            if (light.type == POINT_LIGHT) {
+                glm::vec3 toLight = light.position - shadow.origin;
+                maxDist = glm::length(toLight);
+                if (maxDist < 1e-4f) continue;
+                shadow.dir = toLight / maxDist;
+            } else {
+                shadow.dir = -light.direction;
+                maxDist = FLT_MAX;
+            }
+            float nDotL = glm::dot(n, shadow.dir);
+            if (nDotL <= 0.0f) continue;
+            if (!bvh.occluded(shadow, maxDist)) {
+                result += light.radiance * nDotL;
+            }
+        }
+        return result;
+    }
+
+public:
+    LightmapBaker(const Scene& scene, const BakeSettings& bakeSettings) : settings(bakeSettings), environment(0.0f) {
+        std::vector<OrientedBox> boxes;
+        bool hasAmbient = false;
+        for (const auto& obj : scene.getObjects()) {
+            if (!obj.isVisible) continue;
+            if (obj.type == CUBE) {
+                boxes.push_back(cubeOrientedBox(obj));
+            } else if (obj.type == AMBIENT_LIGHT) {
+                environment += obj.lightColor * obj.lightIntensity;
+                hasAmbient = true;
+            } else {
+                BakeLight light;
+                light.type = obj.type;
+                light.position = obj.position;
+                light.direction = glm::normalize(obj.lightDirection);
+                light.radiance = obj.lightColor * obj.lightIntensity;
+                lights.push_back(light);
+            }
+        }
+        // Same fallback ambient as the dynamic path in main()
+        if (!hasAmbient) environment = glm::vec3(0.2f);
+        bvh.build(boxes);
+    }
+
+    // Lighting factor arriving at p with normal n: direct light plus cosine-sampled bounces
+    glm::vec3 shade(const glm::vec3& p, const glm::vec3& n, BakeRandom& rng) const {
+        glm::vec3 result = directLighting(p, n);
+        glm::vec3 throughput(1.0f);
+        glm::vec3 origin = p;
+        glm::vec3 normal = n;
+        for (int bounce = 0; bounce <= settings.maxBounces; bounce++) {
+            Ray ray;
+            ray.origin = origin + normal * 1e-3f;
+            ray.dir = cosineSample(normal, rng.next(), rng.next());
+            BVHHit hit;
+            if (!bvh.intersect(ray, FLT_MAX, hit)) {
+                result += throughput * environment;
+                break;
+            }
+            if (bounce == settings.maxBounces) break;
+            origin = ray.origin + ray.dir * hit.t;
+            normal = hit.normal;
+            throughput *= settings.albedo;
+            result += throughput * directLighting(origin, normal);
+        }
+        return result;
+    }
+
+    // Radiance seen along a ray: sky on a miss, diffusely reflected light at the first hit
+    glm::vec3 radiance(const Ray& ray, BakeRandom& rng) const {
+        BVHHit hit;
+        if (!bvh.intersect(ray, FLT_MAX, hit)) return environment;
+        glm::vec3 p = ray.origin + ray.dir * hit.t;
+        return settings.albedo * shade(p, hit.normal, rng);
+    }
+
+    const BVH& getBVH() const {
+        return bvh;
+    }
+
+    // Tile size and strips per row for count cubes within maxSize x maxSize (0 = no limit). The
+    // square-ish layout is kept while it fits; otherwise rows are capped at the limit and the tile
+    // shrinks until every cube fits. Returns how many cubes fit (all of them unless even 1-texel
+    // tiles overflow).
+    static size_t atlasLayout(size_t count, int requestedTile, int maxSize, int& tile, int& columns) {
+        tile = requestedTile > 0 ? requestedTile : 1;
+        columns = (int)std::ceil(std::sqrt((double)count));
+        if (maxSize <= 0) return count;
+        for (; tile >= 1; tile--) {
+            int maxColumns = maxSize / (6 * tile);
+            int maxRows = maxSize / tile;
+            if (maxColumns < 1) continue;
+            int fitColumns = columns < maxColumns ? columns : maxColumns;
+            if ((size_t)fitColumns * maxRows >= count) {
+                columns = fitColumns;
+                return count;
+            }
+        }
+        tile = 1;
+        columns = maxSize / 6;
+        return (size_t)columns * maxSize;
+    }
+
+    // Bakes all cubes. Work is split into (cube, face) tiles pulled from a shared counter.
+    // Once progress->cancel is raised the workers stop after their current tile and the
+    // partially baked atlas is returned.
+    BakedLightmap bake(const Scene& scene, BakeProgress* progress = nullptr) const {
+        std::vector<const SceneObject*> cubes;
+        for (const auto& obj : scene.getObjects()) {
+            if (obj.isVisible && obj.type == CUBE && obj.meshId == 0) cubes.push_back(&obj); // Imported meshes have no atlas layout
+        }
+
+        BakedLightmap lightmap;
+        if (cubes.empty()) return lightmap;
+        int tile, columns;
+        size_t fitting = atlasLayout(cubes.size(), settings.texelsPerFace, settings.maxAtlasSize, tile, columns);
+        if (tile != settings.texelsPerFace) {
+            printf("Lightmap atlas limited to %d px: %d texels per face instead of %d\n", settings.maxAtlasSize, tile, settings.texelsPerFace);
+        }
+        if (fitting < cubes.size()) {
+            printf("Lightmap atlas full: %zu of %zu cubes stay unbaked\n", cubes.size() - fitting, cubes.size());
+            cubes.resize(fitting);
+        }
+        int rows = ((int)cubes.size() + columns - 1) / columns;
+        lightmap.width = columns * 6 * tile;
+        lightmap.height = rows * tile;
+        lightmap.texels.assign((size_t)lightmap.width * lightmap.height, glm::vec3(0.0f));
+        for (size_t c = 0; c < cubes.size(); c++) {
+            int x0 = (int)(c % columns) * 6 * tile;
+            int y0 = (int)(c / columns) * tile;
+            lightmap.rects[cubes[c]->id] = glm::vec4((float)x0 / lightmap.width, (float)y0 / lightmap.height, (float)tile, 1.0f);
+        }
+
+        int totalTiles = (int)cubes.size() * 6;
+        std::atomic<int> nextTile(0);
+        if (progress) progress->totalTiles = totalTiles;
+        auto worker = [&]() {
+            for (;;) {
+                if (progress && progress->cancel.load(std::memory_order_relaxed)) break;
+                int tileIndex = nextTile.fetch_add(1);
+                if (tileIndex >= totalTiles) break;
+                int c = tileIndex / 6;
+                int face = tileIndex % 6;
+                const SceneObject& obj = *cubes[c];
+                OrientedBox box = cubeOrientedBox(obj);
+                glm::vec3 localNormal(0.0f);
+                localNormal[face / 2] = (face % 2 == 0) ? 1.0f : -1.0f;
+                glm::vec3 normal = box.axes[0] * localNormal.x + box.axes[1] * localNormal.y + box.axes[2] * localNormal.z;
+                int x0 = (int)(c % columns) * 6 * tile + face * tile;
+                int y0 = (int)(c / columns) * tile;
+                for (int ty = 0; ty < tile; ty++) {
+                    for (int tx = 0; tx < tile; tx++) {
+                        uint64_t texelSeed = ((uint64_t)settings.seed << 48) ^ ((uint64_t)(uint32_t)obj.id << 16) ^ (uint64_t)((face * tile + ty) * tile + tx);
+                        BakeRandom rng(texelSeed);
+                        glm::vec3 sum(0.0f);
+                        for (int s = 0; s < settings.samplesPerTexel; s++) {
+                            // Texel centres map to u = 0 and u = 1 at the tile edges so bilinear filtering stays inside the tile
+                            float u = tile > 1 ? (tx + rng.next() - 0.5f) / (tile - 1) : 0.5f;
+                            float v = tile > 1 ? (ty + rng.next() - 0.5f) / (tile - 1) : 0.5f;
+                            glm::vec3 local = cubeFacePoint(face, glm::clamp(u, 0.0f, 1.0f), glm::clamp(v, 0.0f, 1.0f));
+                            glm::vec3 p = box.center + (box.axes[0] * local.x + box.axes[1] * local.y + box.axes[2] * local.z) * obj.scale;
+                            sum += shade(p, normal, rng);
+                        }
+                        lightmap.texels[(size_t)(y0 + ty) * lightmap.width + x0 + tx] = sum / (float)settings.samplesPerTexel;
+                    }
+                }
+                if (progress) progress->completedTiles.fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+
+        int threadCount = settings.threadCount > 0 ? settings.threadCount : (int)std::thread::hardware_concurrency();
+        if (threadCount < 1) threadCount = 1;
+        std::vector<std::thread> threads;
+        for (int i = 1; i < threadCount; i++) threads.emplace_back(worker);
+        worker();
+        for (auto& t : threads) t.join();
+        return lightmap;
+    }
+};
+
+#endif
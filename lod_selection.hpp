@@ -0,0 +1,45 @@
+#ifndef LOD_SELECTION_HPP
+#define LOD_SELECTION_HPP
+
+#include <math.h>
+
+// Screen-space error LOD selection: a level is acceptable while its geometric error, projected at
+// the bounding sphere's nearest point, stays under pixelError * qualityBias pixels. The coarsest
+// acceptable level wins. Hysteresis widens the band around the current level so an object sitting
+// on a boundary does not flip every frame.
+struct LODSettings {
+    float pixelError = 1.0f;  // Allowed projected error in pixels
+    float qualityBias = 1.0f; // Global multiplier on pixelError: > 1 coarser, < 1 finer
+    float hysteresis = 0.1f;  // Fraction of the threshold a level must clear to switch
+    float impostorPixels = 32.0f; // Bounding sphere diameter below which an impostor is drawn, 0 = never
+};
+
+// Pixels covered by one world unit at distance one
+inline float lodPixelScale(float fovYRadians, int viewportHeight) {
+    return viewportHeight / (2.0f * tanf(fovYRadians * 0.5f));
+}
+
+// errors: world-space error of each level, ascending. current: level used last frame, or -1.
+inline int selectLOD(const float* errors, int levelCount, float distance, float pixelScale, const LODSettings& settings, int current) {
+    // Camera inside or touching the sphere: full detail
+    if (distance <= 1e-4f) return 0;
+    float threshold = settings.pixelError * settings.qualityBias;
+    float pixelsPerError = pixelScale / distance;
+    int selected = 0;
+    for (int level = 1; level < levelCount; level++) {
+        // Going coarser has to clear the lower band, staying may use the upper one
+        float limit = threshold;
+        if (current >= 0) limit *= level <= current ? 1.0f + settings.hysteresis : 1.0f - settings.hysteresis;
+        if (errors[level] * pixelsPerError <= limit) selected = level;
+    }
+    return selected;
+}
+
+// Impostor tier beyond the last LOD, chosen by projected bounding-sphere diameter in pixels
+inline bool selectImpostor(float diameterPixels, const LODSettings& settings, bool current) {
+    float limit = settings.impostorPixels * settings.qualityBias;
+    limit *= current ? 1.0f + settings.hysteresis : 1.0f - settings.hysteresis;
+    return diameterPixels < limit;
+}
+
+#endif
@@ -7,13 +7,34 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <stddef.h>
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <future>
 #include <imgui.h>
 #include "ui/imgui-1.91.9b/backends/imgui_impl_glfw.h"
 #include "ui/imgui-1.91.9b/backends/imgui_impl_opengl3.h"
 #include "scene.hpp"
+#include "lightmap_baker.hpp"
+#include "irradiance_probes.hpp"
+#include "frame_constants.hpp"
+#include "shader_variants.hpp"
+#include "file_watcher.hpp"
+#include "texture_streamer.hpp"
+#include "asset_archive.hpp"
+#include "materials.hpp"
+#include "mesh_import.hpp"
+#include "mesh_simplify.hpp"
+#include "lod_selection.hpp"
+#include "impostors.hpp"
+#include "gpu_culling.hpp"
+#include "picking.hpp"
+#include "object_id_buffer.hpp"
+#include "selection_set.hpp"
+#include "input_queue.hpp"
+#include "fixed_timestep.hpp"
+#include "frame_pacer.hpp"
 
 // Global variables for camera
 float camPosX = 0.0f, camPosY = 2.0f, camPosZ = 5.0f;
@@ -27,26 +48,84 @@ bool cameraDirty = true;
 
 // Global variables for VBO, VAO, and EBO
 #define NUM_LODS 3
-GLuint VAOs[NUM_LODS], VBOs[NUM_LODS], EBOs[NUM_LODS], instanceVBO;
-unsigned int indexCounts[NUM_LODS];
-GLuint shaderProgram;
-GLuint matrixUBO;
-
-// Uniform locations cache
-struct {
-    GLint isOutline;
-    GLint outlineWidth;
-    GLint material_diffuse;
-    GLint material_specular;
-    GLint material_shininess;
-    GLint light_position;
-    GLint light_color;
-    GLint light_ambientStrength;
-    GLint light_direction;
-    GLint light_type;
-    GLint viewPos;
-    GLint time;
-} uniforms;
+GLuint instanceVBO;
+
+// Атрибуты экземпляра на пути через CPU, вперемешку: один буфер на кадр, пачки по (меш или свет, LOD, fade)
+struct InstanceAttributes {
+    glm::mat4 model;
+    glm::vec4 lightmapRect;
+    glm::vec4 material;
+    float selected; // 1 — выделен, 0.5 — под курсором
+    float isLight;
+    float intensity;
+    float fade;
+    int objectId;
+};
+struct InstanceBatch {
+    size_t first = 0;
+    size_t count = 0;
+    size_t incoming = 0; // В пачке fade сначала идут уровни, к которым идёт переход
+};
+std::vector<InstanceAttributes> frameInstances;
+std::vector<InstanceBatch> instanceBatches;
+
+// Инстансируемая геометрия: куб — меш 0, импортированные модели добавляются следом
+// Упрощённые уровни делят VBO базового уровня, у каждого свой EBO и VAO
+struct MeshLOD {
+    GLuint VAO, VBO, EBO;
+    unsigned int indexCount;
+    float error; // геометрическая ошибка уровня в единицах меша
+};
+
+struct Mesh {
+    std::string name;
+    MeshLOD lods[NUM_LODS];
+    float radius = 0.0f; // ограничивающая сфера вокруг начала координат меша
+    // Атлас импостора (impostors.hpp): UV меша и нормали, 0 = не запечён
+    GLuint impostorSurface = 0, impostorNormal = 0;
+    // Ограничивающий бокс в координатах меша, для выбора мышью
+    glm::vec3 boundsMin = glm::vec3(-0.5f), boundsMax = glm::vec3(0.5f);
+};
+
+std::vector<Mesh> meshes;
+GLuint impostorVAO, impostorVBO, impostorEBO; // Квадрат импостора, общий для всех мешей
+char importMeshPath[256] = "";
+
+// Результат импорта с рабочего потока: блоб из архива (view) или разобранный файл (data)
+struct PreparedMesh {
+    std::string path;
+    bool ok = false;
+    bool cooked = false;
+    MeshView view;
+    MeshData data;
+};
+std::future<PreparedMesh> pendingMeshImport;
+double meshImportStartTime = 0.0;
+ShaderLibrary shaders;
+ProgramBinaryCache programCache;
+FileWatcher shaderWatcher;
+bool hotReloadShaders = true;
+
+// Cooked assets (nexyl-cook); loose files are used for anything the archive does not contain
+#define ASSET_ARCHIVE_PATH "nexyl.pak"
+AssetArchive assetArchive;
+
+// Textures are decoded on worker threads and streamed in under a per-frame byte budget
+#define TEXTURE_UPLOAD_BYTES_PER_FRAME (4 * 1024 * 1024)
+TextureStreamer textureStreamer;
+MaterialLibrary materials;
+
+// Per-frame and per-pass constants live in a ring-buffered UBO
+#define UNIFORM_RING_FRAMES 3
+enum RenderPass {
+    PASS_BASE,
+    PASS_OUTLINE,
+    PASS_COUNT
+};
+UniformRing uniformRing;
+GLintptr passConstantOffsets[PASS_COUNT];
+
+bool depthPrepass = false;
 
 // Gizmo VAO/VBO for different light types
 GLuint gizmoVAO, gizmoVBO, gizmoEBO;
@@ -61,153 +140,229 @@ float globalTime = 0.0f;
 
 // Scene and object management
 Scene scene;
-int selectedObjectId = -1;
+SelectionSet selection; // Активный объект — selection.getActive()
 bool isRotating = false, isScaling = false, isTranslating = false;
 bool isDragging = false;
 float lastX = 0.0f, lastY = 0.0f;
 bool sceneDirty = true;
 
-// Forward declaration
-int selectLOD(float distance);
-
-// Read shader file
-std::string readShaderFile(const char* filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        printf("Failed to open shader file: %s\n", filename);
-        return "";
-    }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+// Baked lighting
+BakeSettings bakeSettings;
+BakedLightmap bakedLightmap;
+GLuint lightmapTexture = 0;
+bool useBakedLighting = false;
+double lastBakeSeconds = 0.0;
+// Запекание идёт в фоне над копией сцены, результат забирается в кадре (pollLightingBake)
+std::future<BakedLightmap> pendingBake;
+BakeProgress bakeProgress;
+double bakeStartTime = 0.0;
+
+// Irradiance probe volume
+IrradianceProbeGrid probeGrid;
+ProbeSettings probeSettings;
+// Полное запекание проб тоже идёт в фоне: новая сетка подменяет probeGrid в pollProbeBake
+std::future<IrradianceProbeGrid> pendingProbeBake;
+BakeProgress probeBakeProgress;
+double probeBakeStartTime = 0.0;
+GLuint probeTextures[3] = { 0, 0, 0 };
+bool useProbes = false;
+bool updateProbesIncrementally = false;
+
+// LOD по экранной ошибке; состояние по индексу объекта сцены, сдвигается вместе с удалением
+#define CAMERA_FOV_DEGREES 45.0f
+LODSettings lodSettings;
+std::vector<int> objectLODs;
+
+// Плавная смена LOD: на время перехода объект рисуется в обоих уровнях с дополняющими масками
+bool lodCrossFade = true;
+float lodFadeSeconds = 0.3f;
+std::vector<int> objectFadeLODs; // уровень, из которого идёт переход, -1 = нет перехода
+std::vector<float> objectFades;  // прогресс перехода 0..1
+int fadingObjectCount = 0;
+int impostorObjectCount = 0;
+
+// Отсечение и LOD на GPU (GL 4.3+); кубы загружаются заново только при изменении сцены.
+// Без 4.3 остаётся путь через CPU (updateObjectLODs + packFrameInstances).
+GpuCuller gpuCuller;
+DepthPyramid depthPyramid;
+bool useGpuCulling = true;
+bool useOcclusionCulling = true;
+bool gpuInstancesDirty = true;
+unsigned gpuSceneLayoutVersion = 0;
+// Копия загруженных экземпляров для правок на месте; gpuInstanceOffsets[i] — экземпляр объекта i
+#define GPU_UPLOAD_GAP 4096 // Промежуток (в экземплярах), до которого отрезки загрузки склеиваются
+std::vector<CullInstance> gpuInstances;
+std::vector<glm::vec4> gpuInstanceData;
+std::vector<uint32_t> gpuInstanceOffsets;
+size_t gpuGroupCount = 0;
+std::vector<size_t> gpuGroupInstances; // кубов на меш, пустые группы не рисуются
+// Биты выделения для GPU_DRIVEN (буфер текстуры на блоке 9), заливаются заново при изменении
+#define SELECTION_BITS_TEXTURE_UNIT 9
+GLuint selectionBitsBuffer = 0, selectionBitsTexture = 0;
+unsigned selectionBitsVersion = 0;
+bool selectionBitsValid = false;
+
+// Выбор мышью лучом: BVH по кубам перестраивается при первом клике после изменения состава сцены,
+// сдвинутые кубы только подгоняют границы
+#define LIGHT_PICK_PIXELS 16.0f
+BVH pickBVH;
+std::vector<int> pickLights;
+unsigned pickIndexLayoutVersion = 0;
+bool pickIndexValid = false;
+std::vector<int> pickBoxOfObject; // Индекс коробки в BVH по индексу объекта, -1 — нет
+std::vector<size_t> pickMovedObjects; // Сдвинутые с прошлого обновления индекса
+
+// Выбор по буферу id (точный до пикселя) и подсветка под курсором; чтение асинхронное
+ObjectIdBuffer objectIdBuffer;
+bool useIdPicking = false;
+bool hoverHighlight = false;
+int hoveredObjectId = -1;
+bool pendingIdClick = false;
+double pendingIdClickX = 0.0, pendingIdClickY = 0.0;
+bool pendingIdClickAdditive = false;
+
+// Рамка выделения: нажатие на сцене без режима трансформации, рамкой считается после сдвига
+#define MARQUEE_MIN_PIXELS 4.0
+bool marqueePressed = false;
+bool marqueeActive = false;
+double marqueeStartX = 0.0, marqueeStartY = 0.0;
+double marqueeEndX = 0.0, marqueeEndY = 0.0;
+
+// Правка трансформаций выделения: гизмо и панель копят дельту, сцена меняется раз в кадр
+TransformDelta pendingSelectionDelta;
+
+// Initialize the constants ring: one frame block plus one block per pass in every segment
+void initUniformRing() {
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    GLsizeiptr frameBytes = (sizeof(FrameConstants) + alignment - 1) / alignment * alignment
+                          + PASS_COUNT * ((sizeof(PassConstants) + alignment - 1) / alignment * alignment);
+    uniformRing.init(frameBytes, UNIFORM_RING_FRAMES);
 }
 
-// Load BMP texture
-GLuint loadTexture(const char* filename) {
-    FILE* file = fopen(filename, "rb");
-    if (!file) {
-        printf("Failed to open texture file: %s\n", filename);
-        return 0;
-    }
-
-    unsigned char header[54];
-    if (fread(header, 1, 54, file) != 54) {
-        fclose(file);
-        return 0;
-    }
-
-    int width = *(int*)&header[18];
-    int height = *(int*)&header[22];
-    int imageSize = *(int*)&header[34];
-
-    unsigned char* data = new unsigned char[imageSize];
-    if (fread(data, 1, imageSize, file) != (size_t)imageSize) {
-        delete[] data;
-        fclose(file);
-        return 0;
+// Write this frame's constants into the ring and bind the frame block
+void uploadFrameConstants(const FrameConstants& frame) {
+    uniformRing.beginFrame();
+    GLintptr frameOffset = uniformRing.write(&frame, sizeof(FrameConstants));
+    for (int pass = 0; pass < PASS_COUNT; pass++) {
+        PassConstants constants = {};
+        constants.isOutline = (pass == PASS_OUTLINE) ? 1 : 0;
+        constants.outlineWidth = 0.2f;
+        passConstantOffsets[pass] = uniformRing.write(&constants, sizeof(PassConstants));
     }
-    fclose(file);
-
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    uniformRing.endWrites();
+    uniformRing.bind(FRAME_CONSTANTS_BINDING, frameOffset, sizeof(FrameConstants));
+}
 
-    delete[] data;
-    return textureID;
+void bindPass(RenderPass pass) {
+    uniformRing.bind(PASS_CONSTANTS_BINDING, passConstantOffsets[pass], sizeof(PassConstants));
 }
 
-// Create shader program
-GLuint createShaderProgram(const char* vertexFile, const char* fragmentFile) {
-    std::string vertexShaderCode = readShaderFile(vertexFile);
-    std::string fragmentShaderCode = readShaderFile(fragmentFile);
+// Index buffer and VAO over an uploaded vertex buffer in the engine layout (position, texcoord, normal)
+MeshLOD uploadMeshLevel(GLuint vbo, const unsigned int* indices, size_t indexCount, float error) {
+    MeshLOD lod;
+    lod.VBO = vbo;
+    lod.indexCount = (unsigned int)indexCount;
+    lod.error = error;
 
-    if (vertexShaderCode.empty() || fragmentShaderCode.empty()) {
-        printf("Error reading shader files\n");
-        return 0;
-    }
+    glGenVertexArrays(1, &lod.VAO);
+    glBindVertexArray(lod.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, lod.VBO);
 
-    const char* vertexShaderSource = vertexShaderCode.c_str();
-    const char* fragmentShaderSource = fragmentShaderCode.c_str();
+    glGenBuffers(1, &lod.EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lod.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
 
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
+    glEnableVertexAttribArray(2);
 
-    GLint success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        printf("Vertex shader compilation error: %s\n", infoLog);
-        glDeleteShader(vertexShader);
-        return 0;
-    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    if (gpuCuller.isReady()) gpuCuller.bindReferences(lod.VAO);
+    return lod;
+}
 
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
+// Uploads one LOD with its own vertex buffer
+MeshLOD uploadMeshLOD(const void* vertices, size_t vertexBytes, const unsigned int* indices, size_t indexCount, float error = 0.0f) {
+    GLuint vbo;
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW);
+    return uploadMeshLevel(vbo, indices, indexCount, error);
+}
 
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        printf("Fragment shader compilation error: %s\n", infoLog);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        return 0;
+// Renders LOD 0 into the octahedral impostor atlas (impostors.hpp). Frames hold mesh UVs and
+// object-space normals, so instances keep their own material and lighting as quads.
+void bakeImpostor(Mesh& mesh) {
+    const ShaderVariant& variant = shaders.get(SHADER_IMPOSTOR_BAKE);
+    if (!variant.program || mesh.radius <= 0.0f) return;
+
+    // UV при повторе текстуры выходят за [0, 1], поэтому плавающая точка; без фильтрации,
+    // чтобы не смешивать соседние кадры и фон за силуэтом
+    GLuint textures[2];
+    GLenum formats[2] = { GL_RGBA16F, GL_RGBA8 };
+    GLenum types[2] = { GL_FLOAT, GL_UNSIGNED_BYTE };
+    glGenTextures(2, textures);
+    for (int c = 0; c < 2; c++) {
+        glBindTexture(GL_TEXTURE_2D, textures[c]);
+        glTexImage2D(GL_TEXTURE_2D, 0, formats[c], IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE, 0, GL_RGBA, types[c], nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLuint depth, fbo;
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE);
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[0], 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, textures[1], 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) {
+        GLint viewport[4];
+        GLfloat clearColor[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
+        glUseProgram(variant.program);
+        glBindVertexArray(mesh.lods[0].VAO);
+        for (int y = 0; y < IMPOSTOR_GRID; y++) {
+            for (int x = 0; x < IMPOSTOR_GRID; x++) {
+                glViewport(x * IMPOSTOR_FRAME_SIZE, y * IMPOSTOR_FRAME_SIZE, IMPOSTOR_FRAME_SIZE, IMPOSTOR_FRAME_SIZE);
+                glm::mat4 frame = impostorFrameViewProjection(impostorFrameDirection(x, y), mesh.radius);
+                glUniformMatrix4fv(variant.uniforms.impostorViewProjection, 1, GL_FALSE, glm::value_ptr(frame));
+                glDrawElements(GL_TRIANGLES, mesh.lods[0].indexCount, GL_UNSIGNED_INT, 0);
+            }
+        }
+        glBindVertexArray(0);
 
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        printf("Shader program linking error: %s\n", infoLog);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        glDeleteProgram(shaderProgram);
-        return 0;
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+        mesh.impostorSurface = textures[0];
+        mesh.impostorNormal = textures[1];
+    } else {
+        printf("Impostor framebuffer incomplete for %s\n", mesh.name.c_str());
+        glDeleteTextures(2, textures);
     }
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    uniforms.isOutline = glGetUniformLocation(shaderProgram, "isOutline");
-    uniforms.outlineWidth = glGetUniformLocation(shaderProgram, "outlineWidth");
-    uniforms.material_diffuse = glGetUniformLocation(shaderProgram, "material_diffuse");
-    uniforms.material_specular = glGetUniformLocation(shaderProgram, "material_specular");
-    uniforms.material_shininess = glGetUniformLocation(shaderProgram, "material_shininess");
-    uniforms.light_position = glGetUniformLocation(shaderProgram, "light_position");
-    uniforms.light_color = glGetUniformLocation(shaderProgram, "light_color");
-    uniforms.light_ambientStrength = glGetUniformLocation(shaderProgram, "light_ambientStrength");
-    uniforms.light_direction = glGetUniformLocation(shaderProgram, "light_direction");
-    uniforms.light_type = glGetUniformLocation(shaderProgram, "light_type");
-    uniforms.viewPos = glGetUniformLocation(shaderProgram, "viewPos");
-    uniforms.time = glGetUniformLocation(shaderProgram, "time");
-
-    return shaderProgram;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &depth);
 }
 
-// Initialize matrix UBO
-void initMatrixUBO() {
-    glGenBuffers(1, &matrixUBO);
-    glBindBuffer(GL_UNIFORM_BUFFER, matrixUBO);
-    glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, matrixUBO);
-}
-
-// Initialize cube VBO and VAO for LOD
+// Initialize cube VBO and VAO for LOD (mesh 0)
 void initCubeVBO(int lod) {
     float vertices_high[] = {
         -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,  0.0f,  0.0f,  1.0f,
@@ -306,28 +461,123 @@ void initCubeVBO(int lod) {
     size_t vertexSizes[] = { sizeof(vertices_high), sizeof(vertices_medium), sizeof(vertices_low) };
     size_t indexSizes[] = { sizeof(indices_high), sizeof(indices_medium), sizeof(indices_low) };
 
-    indexCounts[lod] = indexSizes[lod] / sizeof(unsigned int);
+    // Геометрия уровней куба совпадает, ошибки условные: куб масштаба 1 при 600 px и 45° переключается
+    // на 5 и 15 единицах от центра (ошибка * 724 px + радиус 0.87)
+    float errors[] = { 0.0f, 0.0057f, 0.0195f };
 
-    glGenVertexArrays(1, &VAOs[lod]);
-    glBindVertexArray(VAOs[lod]);
+    if (meshes.empty()) meshes.push_back(Mesh{ "Cube", {}, 0.87f });
+    meshes[0].lods[lod] = uploadMeshLOD(vertices[lod], vertexSizes[lod], indices[lod], indexSizes[lod] / sizeof(unsigned int), errors[lod]);
+}
 
-    glGenBuffers(1, &VBOs[lod]);
-    glBindBuffer(GL_ARRAY_BUFFER, VBOs[lod]);
-    glBufferData(GL_ARRAY_BUFFER, vertexSizes[lod], vertices[lod], GL_STATIC_DRAW);
+// CPU side of a mesh import, safe on a worker thread: the cooked blob from the archive (already
+// optimized and simplified), or the OBJ/glTF file imported and simplified here
+bool prepareMesh(const std::string& path, PreparedMesh& prepared) {
+    prepared.path = path;
+    AssetSlice slice;
+    if (assetArchive.isOpen() && assetArchive.find(path, slice) && slice.type == ASSET_MESH) {
+        if (readMeshBlob(slice.data, slice.size, prepared.view)) {
+            prepared.cooked = true;
+            return true;
+        }
+        printf("Corrupt cooked mesh %s, importing the loose file\n", path.c_str());
+    }
+    double start = glfwGetTime();
+    if (!importMesh(path.c_str(), prepared.data)) return false;
+    printf("Imported %s: %zu vertices, %zu triangles in %.3f s\n", path.c_str(), prepared.data.vertices.size(), prepared.data.indices.size() / 3, glfwGetTime() - start);
+    start = glfwGetTime();
+    generateMeshLODs(prepared.data, NUM_LODS - 1);
+    printf("Simplified %s: %zu LODs in %.3f s\n", path.c_str(), prepared.data.lods.size(), glfwGetTime() - start);
+    return true;
+}
 
-    glGenBuffers(1, &EBOs[lod]);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOs[lod]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSizes[lod], indices[lod], GL_STATIC_DRAW);
+// GL side: uploads a prepared mesh as a new instancable mesh and bakes its impostor; returns the
+// mesh id
+int uploadMesh(const PreparedMesh& prepared) {
+    MeshView view = prepared.view;
+    const uint32_t* levelIndices[NUM_LODS - 1];
+    MeshBlobLevel levels[NUM_LODS - 1];
+    int levelCount = 0;
+    if (prepared.cooked) {
+        // Грузим прямо из отображённого архива
+        for (; levelCount < NUM_LODS - 1 && levelCount < (int)view.levelCount; levelCount++) {
+            levelIndices[levelCount] = view.levelIndices(levelCount);
+            levels[levelCount] = view.levels[levelCount];
+        }
+    } else {
+        const MeshData& data = prepared.data;
+        view.vertices = data.vertices.data();
+        view.indices = data.indices.data();
+        view.vertexCount = (uint32_t)data.vertices.size();
+        view.indexCount = (uint32_t)data.indices.size();
+        for (; levelCount < NUM_LODS - 1 && levelCount < (int)data.lods.size(); levelCount++) {
+            levelIndices[levelCount] = data.lods[levelCount].indices.data();
+            levels[levelCount] = MeshBlobLevel{ (uint32_t)data.lods[levelCount].indices.size(), data.lods[levelCount].error };
+        }
+    }
+    const std::string& path = prepared.path;
+    Mesh mesh;
+    mesh.boundsMin = glm::vec3(FLT_MAX);
+    mesh.boundsMax = glm::vec3(-FLT_MAX);
+    for (uint32_t i = 0; i < view.vertexCount; i++) {
+        const float* p = view.vertices[i].position;
+        mesh.radius = fmaxf(mesh.radius, sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]));
+        mesh.boundsMin = glm::min(mesh.boundsMin, glm::vec3(p[0], p[1], p[2]));
+        mesh.boundsMax = glm::max(mesh.boundsMax, glm::vec3(p[0], p[1], p[2]));
+    }
+    size_t slash = path.find_last_of("/\\");
+    mesh.name = slash == std::string::npos ? path : path.substr(slash + 1);
+    mesh.lods[0] = uploadMeshLOD(view.vertices, (size_t)view.vertexCount * sizeof(MeshVertex), view.indices, view.indexCount);
+    for (int i = 1; i < NUM_LODS; i++) {
+        // Если уровней меньше, последний повторяется
+        if (i > levelCount) {
+            mesh.lods[i] = mesh.lods[i - 1];
+            continue;
+        }
+        mesh.lods[i] = uploadMeshLevel(mesh.lods[0].VBO, levelIndices[i - 1], levels[i - 1].indexCount, levels[i - 1].error);
+    }
+    bakeImpostor(mesh);
+    meshes.push_back(mesh);
+    return (int)meshes.size() - 1;
+}
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+// Mesh import on a background thread (a couple of million triangles take about a second to
+// import and longer to simplify); pollMeshImport uploads the result and places an instance
+void startMeshImport(const std::string& path) {
+    if (pendingMeshImport.valid()) return;
+    meshImportStartTime = glfwGetTime();
+    pendingMeshImport = std::async(std::launch::async, [path]() {
+        PreparedMesh prepared;
+        prepared.ok = prepareMesh(path, prepared);
+        return prepared;
+    });
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+void pollMeshImport() {
+    if (!pendingMeshImport.valid() || pendingMeshImport.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+    PreparedMesh prepared = pendingMeshImport.get();
+    if (!prepared.ok) return;
+    int meshId = uploadMesh(prepared);
+    scene.addObject(meshes[meshId].name + "_" + std::to_string(scene.getObjects().size() + 1), glm::vec3(0.0f), glm::vec2(0.0f), 1.0f, meshId);
+    sceneDirty = true;
+}
+
+void destroyMeshes() {
+    for (auto& mesh : meshes) {
+        for (int i = 0; i < NUM_LODS; i++) {
+            // Слоты LOD могут делить одну геометрию
+            bool shared = false;
+            for (int j = 0; j < i; j++) {
+                if (mesh.lods[j].VAO == mesh.lods[i].VAO) shared = true;
+            }
+            if (shared) continue;
+            glDeleteVertexArrays(1, &mesh.lods[i].VAO);
+            glDeleteBuffers(1, &mesh.lods[i].EBO);
+            if (i == 0 || mesh.lods[i].VBO != mesh.lods[0].VBO) glDeleteBuffers(1, &mesh.lods[i].VBO);
+        }
+        glDeleteTextures(1, &mesh.impostorSurface);
+        glDeleteTextures(1, &mesh.impostorNormal);
+    }
+    meshes.clear();
 }
 
 // Initialize instance VBO
@@ -338,85 +588,111 @@ void initInstanceVBO() {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-// Update instance VBO
-void updateInstanceVBO(int lod, bool renderLights = false) {
-    std::vector<glm::mat4> modelMatrices;
-    std::vector<float> selections;
-    std::vector<float> isLightSources;
-    std::vector<float> lightIntensities;
-    glm::vec3 camPos(camPosX, camPosY, camPosZ);
+// Initialize the impostor quad; corners in [-1, 1], the vertex shader orients and sizes it
+void initImpostorQuad() {
+    float vertices[] = {
+        -1.0f, -1.0f, 0.0f,
+         1.0f, -1.0f, 0.0f,
+         1.0f,  1.0f, 0.0f,
+        -1.0f,  1.0f, 0.0f
+    };
+    unsigned int indices[] = { 0, 1, 2,   2, 3, 0 };
 
-    for (const auto& obj : scene.getObjects()) {
-        if (!obj.isVisible) continue;
-        if (renderLights && (obj.type != POINT_LIGHT && obj.type != DIRECTIONAL_LIGHT && obj.type != AMBIENT_LIGHT)) continue;
-        if (!renderLights && obj.type != CUBE) continue;
-        float distance = glm::length(obj.position - camPos);
-        int selectedLOD = selectLOD(distance);
-        if (selectedLOD != lod) continue;
-
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, obj.position);
-
-        // Визуальные отличия источников света
-        if (obj.type == CUBE || obj.type == POINT_LIGHT || obj.type == DIRECTIONAL_LIGHT || obj.type == AMBIENT_LIGHT) {
-            model = glm::rotate(model, glm::radians(obj.rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-            model = glm::rotate(model, glm::radians(obj.rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-            float scale = obj.scale;
-            if (obj.type == POINT_LIGHT) {
-                scale = 0.15f; // Точечный свет - маленький куб
-            } else if (obj.type == DIRECTIONAL_LIGHT) {
-                scale = 0.2f; // Направленный свет - стрелка
-                glm::vec3 dir = glm::normalize(obj.lightDirection);
-                glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-                if (glm::abs(glm::dot(dir, up)) > 0.99f) up = glm::vec3(0.0f, 0.0f, 1.0f);
-                glm::vec3 right = glm::normalize(glm::cross(up, dir));
-                up = glm::cross(dir, right);
-                glm::mat4 rotation = glm::mat4(
-                    glm::vec4(right, 0.0f),
-                    glm::vec4(up, 0.0f),
-                    glm::vec4(dir, 0.0f),
-                    glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
-                );
-                model = model * rotation;
-            } else if (obj.type == AMBIENT_LIGHT) {
-                // Пульсация для окружающего света при выделении
-                scale = (selectedObjectId == obj.id) ? 0.2f + 0.05f * sin(globalTime * 2.0f) : 0.2f;
-            }
-            model = glm::scale(model, glm::vec3(scale));
-        }
-        modelMatrices.push_back(model);
-        selections.push_back(obj.id == selectedObjectId ? 1.0f : 0.0f);
-        isLightSources.push_back((obj.type == POINT_LIGHT || obj.type == DIRECTIONAL_LIGHT || obj.type == AMBIENT_LIGHT) ? 1.0f : 0.0f);
-        lightIntensities.push_back(obj.lightIntensity);
-    }
-
-    if (!modelMatrices.empty()) {
-        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-        glBufferData(GL_ARRAY_BUFFER, modelMatrices.size() * (sizeof(glm::mat4) + 3 * sizeof(float)), nullptr, GL_DYNAMIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, modelMatrices.size() * sizeof(glm::mat4), modelMatrices.data());
-        glBufferSubData(GL_ARRAY_BUFFER, modelMatrices.size() * sizeof(glm::mat4), selections.size() * sizeof(float), selections.data());
-        glBufferSubData(GL_ARRAY_BUFFER, modelMatrices.size() * (sizeof(glm::mat4) + sizeof(float)), isLightSources.size() * sizeof(float), isLightSources.data());
-        glBufferSubData(GL_ARRAY_BUFFER, modelMatrices.size() * (sizeof(glm::mat4) + 2 * sizeof(float)), lightIntensities.size() * sizeof(float), lightIntensities.data());
-
-        glBindVertexArray(VAOs[lod]);
-        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-        for (int i = 0; i < 4; i++) {
-            glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(i * sizeof(glm::vec4)));
-            glEnableVertexAttribArray(3 + i);
-            glVertexAttribDivisor(3 + i, 1);
+    glGenVertexArrays(1, &impostorVAO);
+    glBindVertexArray(impostorVAO);
+
+    glGenBuffers(1, &impostorVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, impostorVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    glGenBuffers(1, &impostorEBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, impostorEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    if (gpuCuller.isReady()) gpuCuller.bindReferences(impostorVAO);
+}
+
+// Model matrix of a CPU-path instance; light sources get their marker shape and size
+glm::mat4 instanceModelMatrix(const SceneObject& obj) {
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, obj.position);
+
+    // Визуальные отличия источников света
+    if (obj.type == CUBE || obj.type == POINT_LIGHT || obj.type == DIRECTIONAL_LIGHT || obj.type == AMBIENT_LIGHT) {
+        model = glm::rotate(model, glm::radians(obj.rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+        model = glm::rotate(model, glm::radians(obj.rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+        float scale = obj.scale;
+        if (obj.type == POINT_LIGHT) {
+            scale = 0.15f; // Точечный свет - маленький куб
+        } else if (obj.type == DIRECTIONAL_LIGHT) {
+            scale = 0.2f; // Направленный свет - стрелка
+            glm::vec3 dir = glm::normalize(obj.lightDirection);
+            glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+            if (glm::abs(glm::dot(dir, up)) > 0.99f) up = glm::vec3(0.0f, 0.0f, 1.0f);
+            glm::vec3 right = glm::normalize(glm::cross(up, dir));
+            up = glm::cross(dir, right);
+            glm::mat4 rotation = glm::mat4(
+                glm::vec4(right, 0.0f),
+                glm::vec4(up, 0.0f),
+                glm::vec4(dir, 0.0f),
+                glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
+            );
+            model = model * rotation;
+        } else if (obj.type == AMBIENT_LIGHT) {
+            // Пульсация для окружающего света при выделении
+            scale = selection.contains(obj.id) ? 0.2f + 0.05f * sin(globalTime * 2.0f) : 0.2f;
         }
-        glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(modelMatrices.size() * sizeof(glm::mat4)));
-        glEnableVertexAttribArray(7);
-        glVertexAttribDivisor(7, 1);
-        glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(modelMatrices.size() * (sizeof(glm::mat4) + sizeof(float))));
-        glEnableVertexAttribArray(8);
-        glVertexAttribDivisor(8, 1);
-        glVertexAttribPointer(9, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(modelMatrices.size() * (sizeof(glm::mat4) + 2 * sizeof(float))));
-        glEnableVertexAttribArray(9);
-        glVertexAttribDivisor(9, 1);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        model = glm::scale(model, glm::vec3(scale));
     }
+    return model;
+}
+
+// Light sources are batch group 0, mesh meshId is group meshId + 1
+int instanceBatchIndex(int meshId, bool lights, int lod, bool fading) {
+    int group = lights ? 0 : meshId + 1;
+    return (group * (NUM_LODS + 1) + lod) * 2 + (fading ? 1 : 0);
+}
+
+// Points the instance attributes of vao at one batch of this frame's instance buffer; returns
+// the instance count. incomingOnly leaves out the outgoing levels of cross-fading objects.
+size_t bindInstanceBatch(GLuint vao, int meshId, bool lights, int lod, bool fading, bool incomingOnly = false) {
+    size_t index = (size_t)instanceBatchIndex(meshId, lights, lod, fading);
+    // Меш, добавленный после упаковки, рисуется со следующего кадра
+    if (index >= instanceBatches.size()) return 0;
+    const InstanceBatch& batch = instanceBatches[index];
+    if (!(incomingOnly ? batch.incoming : batch.count)) return 0;
+    const GLsizei stride = sizeof(InstanceAttributes);
+    const size_t base = batch.first * sizeof(InstanceAttributes);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (int i = 0; i < 4; i++) {
+        glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(InstanceAttributes, model) + i * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(3 + i);
+        glVertexAttribDivisor(3 + i, 1);
+    }
+    struct { GLuint location; GLint size; size_t offset; } floats[] = {
+        { 7, 1, offsetof(InstanceAttributes, selected) },
+        { 8, 1, offsetof(InstanceAttributes, isLight) },
+        { 9, 1, offsetof(InstanceAttributes, intensity) },
+        { 10, 4, offsetof(InstanceAttributes, lightmapRect) },
+        { 11, 4, offsetof(InstanceAttributes, material) },
+        { 12, 1, offsetof(InstanceAttributes, fade) },
+    };
+    for (const auto& attribute : floats) {
+        glVertexAttribPointer(attribute.location, attribute.size, GL_FLOAT, GL_FALSE, stride, (void*)(base + attribute.offset));
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribDivisor(attribute.location, 1);
+    }
+    glVertexAttribIPointer(14, 1, GL_INT, stride, (void*)(base + offsetof(InstanceAttributes, objectId)));
+    glEnableVertexAttribArray(14);
+    glVertexAttribDivisor(14, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return incomingOnly ? batch.incoming : batch.count;
 }
 
 // Initialize gizmo VBO/VAO (for directional light and cube gizmos)
@@ -465,8 +741,6 @@ void initGizmoVBO() {
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float))); // Цвет
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(7 * sizeof(float))); // GizmoType
-    glEnableVertexAttribArray(3);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
@@ -534,18 +808,505 @@ void initSphereVBO() {
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)(3 * sizeof(float))); // Цвет
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)(6 * sizeof(float))); // GizmoType
-    glEnableVertexAttribArray(3);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 }
 
-// Select LOD based on distance
-int selectLOD(float distance) {
-    if (distance < 5.0f) return 0;
-    if (distance < 15.0f) return 1;
-    return 2;
+bool gpuCullingActive() {
+    return useGpuCulling && gpuCuller.isReady();
+}
+
+// Packs every CPU-path instance of the frame into batches by (mesh or lights, level, fading) and
+// uploads them in one go; all passes then draw from the same data. A cross-fading object goes into
+// the fading batch of both its levels, with the incoming one at fade and the outgoing one at
+// fade - 1; the incoming ones come first in a batch.
+void packFrameInstances() {
+    const auto& objects = scene.getObjects();
+    bool gpuCubes = gpuCullingActive();
+    instanceBatches.assign((meshes.size() + 1) * (NUM_LODS + 1) * 2, InstanceBatch());
+
+    auto forEachInstance = [&](auto visit) {
+        for (size_t i = 0; i < objects.size(); i++) {
+            const auto& obj = objects[i];
+            if (!obj.isVisible || objectLODs[i] < 0) continue;
+            bool isLight = obj.type == POINT_LIGHT || obj.type == DIRECTIONAL_LIGHT || obj.type == AMBIENT_LIGHT;
+            if (!isLight && (obj.type != CUBE || gpuCubes)) continue;
+            if (objectFadeLODs[i] < 0) {
+                visit(i, instanceBatchIndex(obj.meshId, isLight, objectLODs[i], false), 1.0f);
+            } else {
+                visit(i, instanceBatchIndex(obj.meshId, isLight, objectLODs[i], true), objectFades[i]);
+                visit(i, instanceBatchIndex(obj.meshId, isLight, objectFadeLODs[i], true), objectFades[i] - 1.0f);
+            }
+        }
+    };
+
+    forEachInstance([&](size_t, int batchIndex, float fade) {
+        InstanceBatch& batch = instanceBatches[batchIndex];
+        batch.count++;
+        if (fade >= 0.0f) batch.incoming++;
+    });
+    // Курсоры заполнения: входящие с начала пачки, уходящие после них
+    std::vector<size_t> cursors(instanceBatches.size() * 2);
+    size_t total = 0;
+    for (size_t b = 0; b < instanceBatches.size(); b++) {
+        InstanceBatch& batch = instanceBatches[b];
+        batch.first = total;
+        cursors[b * 2] = total;
+        cursors[b * 2 + 1] = total + batch.incoming;
+        total += batch.count;
+    }
+    frameInstances.resize(total);
+    forEachInstance([&](size_t i, int batchIndex, float fade) {
+        const auto& obj = objects[i];
+        InstanceAttributes& instance = frameInstances[cursors[batchIndex * 2 + (fade < 0.0f ? 1 : 0)]++];
+        instance.model = instanceModelMatrix(obj);
+        instance.lightmapRect = glm::vec4(0.0f);
+        if (useBakedLighting && obj.type == CUBE && obj.meshId == 0) {
+            auto it = bakedLightmap.rects.find(obj.id);
+            if (it != bakedLightmap.rects.end()) instance.lightmapRect = it->second;
+        }
+        instance.material = materials.instanceData(obj.materialId, obj.tint);
+        instance.selected = selection.contains(obj.id) ? 1.0f : (obj.id == hoveredObjectId ? 0.5f : 0.0f);
+        instance.isLight = obj.type == CUBE ? 0.0f : 1.0f;
+        instance.intensity = obj.lightIntensity;
+        instance.fade = fade;
+        instance.objectId = obj.id;
+    });
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, frameInstances.size() * sizeof(InstanceAttributes), frameInstances.empty() ? nullptr : frameInstances.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool gpuOcclusionActive() {
+    return gpuCullingActive() && useOcclusionCulling && depthPyramid.isReady();
+}
+
+// Cubes are rotated by X then Y and uniformly scaled, as in instanceModelMatrix
+glm::mat4 cubeModelMatrix(const SceneObject& obj) {
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), obj.position);
+    model = glm::rotate(model, glm::radians(obj.rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(obj.rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+    return glm::scale(model, glm::vec3(obj.scale));
+}
+
+// Re-uploads groups and cube instances when the scene or meshes changed, then runs the culling
+// passes. With an unchanged scene the CPU cost is independent of the instance count.
+CullParams makeCullParams(const glm::mat4& viewProjection, float deltaTime) {
+    CullParams params;
+    params.frustum = frustumFromMatrix(viewProjection);
+    params.cameraPosition = glm::vec3(camPosX, camPosY, camPosZ);
+    params.pixelScale = lodPixelScale(glm::radians(CAMERA_FOV_DEGREES), windowHeight);
+    params.lodThreshold = lodSettings.pixelError * lodSettings.qualityBias;
+    params.lodHysteresis = lodSettings.hysteresis;
+    params.impostorPixels = lodSettings.impostorPixels * lodSettings.qualityBias;
+    params.fadeStep = lodCrossFade ? deltaTime / lodFadeSeconds : 0.0f;
+    params.occlusion = gpuOcclusionActive();
+    return params;
+}
+
+bool isGpuInstance(const SceneObject& obj) {
+    return obj.isVisible && obj.type == CUBE;
+}
+
+// INSTANCE_DATA_TEXELS vec4 go to data
+void packGpuInstance(const SceneObject& obj, CullInstance& instance, glm::vec4* data) {
+    instance = {};
+    instance.positionScale = glm::vec4(obj.position, obj.scale);
+    instance.group = obj.meshId;
+
+    glm::mat4 model = cubeModelMatrix(obj);
+    for (int c = 0; c < 4; c++) {
+        data[c] = model[c];
+    }
+    glm::vec4 lightmapRect(0.0f);
+    if (useBakedLighting && obj.meshId == 0) {
+        auto it = bakedLightmap.rects.find(obj.id);
+        if (it != bakedLightmap.rects.end()) lightmapRect = it->second;
+    }
+    data[4] = lightmapRect;
+    data[5] = materials.instanceData(obj.materialId, obj.tint);
+    float idBits;
+    memcpy(&idBits, &obj.id, sizeof(float));
+    data[6] = glm::vec4(idBits, 0.0f, obj.lightIntensity, 0.0f);
+}
+
+// movedObjects: this frame's Scene::takeMovedObjects
+void updateGpuCulling(const glm::mat4& viewProjection, float deltaTime, const std::vector<size_t>& movedObjects) {
+    if (!gpuCullingActive()) {
+        // Сдвиги не дошли до копий на GPU: при включении перезалить всё
+        if (!movedObjects.empty()) gpuInstancesDirty = true;
+        return;
+    }
+    if (gpuGroupCount != meshes.size()) {
+        std::vector<CullGroup> groups(meshes.size());
+        for (size_t m = 0; m < meshes.size(); m++) {
+            for (int lod = 0; lod < NUM_LODS; lod++) {
+                groups[m].errors[lod] = meshes[m].lods[lod].error;
+                groups[m].indexCounts[lod] = meshes[m].lods[lod].indexCount;
+            }
+            groups[m].errors.w = meshes[m].radius;
+            groups[m].indexCounts[3] = meshes[m].impostorSurface ? 6 : 0;
+        }
+        gpuCuller.setGroups(groups);
+        gpuGroupCount = meshes.size();
+        gpuInstancesDirty = true;
+    }
+    const auto& objects = scene.getObjects();
+    if (gpuInstancesDirty || gpuSceneLayoutVersion != scene.getLayoutVersion()) {
+        gpuGroupInstances.assign(meshes.size(), 0);
+        gpuInstanceOffsets.assign(objects.size() + 1, 0);
+        uint32_t count = 0;
+        for (size_t i = 0; i < objects.size(); i++) {
+            gpuInstanceOffsets[i] = count;
+            if (isGpuInstance(objects[i])) count++;
+        }
+        gpuInstanceOffsets[objects.size()] = count;
+        gpuInstances.resize(count);
+        gpuInstanceData.resize((size_t)count * INSTANCE_DATA_TEXELS);
+        for (size_t i = 0; i < objects.size(); i++) {
+            if (!isGpuInstance(objects[i])) continue;
+            uint32_t k = gpuInstanceOffsets[i];
+            packGpuInstance(objects[i], gpuInstances[k], &gpuInstanceData[(size_t)k * INSTANCE_DATA_TEXELS]);
+            gpuGroupInstances[objects[i].meshId]++;
+        }
+        gpuCuller.setInstances(gpuInstances, gpuInstanceData);
+        gpuSceneLayoutVersion = scene.getLayoutVersion();
+        gpuInstancesDirty = false;
+    } else if (!movedObjects.empty()) {
+        // Сдвинутые перепаковываются в копии и заливаются отрезками; короткие промежутки
+        // заливаются вместе с ними, чтобы рассеянное выделение не стоило вызова на объект
+        size_t runFirst = 0, runEnd = 0;
+        for (size_t i : movedObjects) {
+            if (i >= objects.size() || !isGpuInstance(objects[i])) continue;
+            uint32_t k = gpuInstanceOffsets[i];
+            packGpuInstance(objects[i], gpuInstances[k], &gpuInstanceData[(size_t)k * INSTANCE_DATA_TEXELS]);
+            if (runEnd != runFirst && k - runEnd > GPU_UPLOAD_GAP) {
+                gpuCuller.updateInstances(runFirst, runEnd - runFirst, &gpuInstances[runFirst], &gpuInstanceData[runFirst * INSTANCE_DATA_TEXELS]);
+                runFirst = runEnd = 0;
+            }
+            if (runEnd == runFirst) runFirst = k;
+            runEnd = (size_t)k + 1;
+        }
+        if (runEnd != runFirst) {
+            gpuCuller.updateInstances(runFirst, runEnd - runFirst, &gpuInstances[runFirst], &gpuInstanceData[runFirst * INSTANCE_DATA_TEXELS]);
+        }
+    }
+
+    gpuCuller.cull(makeCullParams(viewProjection, deltaTime));
+}
+
+// The words go up as is; an empty selection still gets one zero word so texelFetch stays in range
+void updateSelectionBits() {
+    if (!gpuCullingActive()) return;
+    if (!selectionBitsBuffer) {
+        glGenBuffers(1, &selectionBitsBuffer);
+        glGenTextures(1, &selectionBitsTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, selectionBitsTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, selectionBitsBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    if (!selectionBitsValid || selectionBitsVersion != selection.getVersion()) {
+        // Биты на все id сцены: объект без слова в буфере читался бы за его пределами
+        size_t wordCount = std::max(selection.getWords().size(), (size_t)(scene.getNextId() >> 5) + 1);
+        std::vector<uint32_t> words(wordCount, 0u);
+        std::copy(selection.getWords().begin(), selection.getWords().end(), words.begin());
+        glBindBuffer(GL_TEXTURE_BUFFER, selectionBitsBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, words.size() * sizeof(uint32_t), words.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        selectionBitsVersion = selection.getVersion();
+        selectionBitsValid = true;
+    }
+}
+
+// Cubes go into the BVH as oriented mesh bounds; the few lights are kept aside and tested as spheres
+void updatePickIndex() {
+    const auto& objects = scene.getObjects();
+    if (pickIndexValid && pickIndexLayoutVersion == scene.getLayoutVersion()) {
+        // Сдвиги прошлых кадров и ещё не забранные в этом
+        auto refitMoved = [&](const std::vector<size_t>& moved) {
+            for (size_t i : moved) {
+                if (i >= objects.size() || pickBoxOfObject[i] < 0) continue;
+                const Mesh& mesh = meshes[objects[i].meshId];
+                pickBVH.updateBox(pickBoxOfObject[i], meshOrientedBox(objects[i], mesh.boundsMin, mesh.boundsMax));
+            }
+        };
+        refitMoved(pickMovedObjects);
+        refitMoved(scene.getPendingMovedObjects());
+        pickBVH.refit();
+        pickMovedObjects.clear();
+        return;
+    }
+    std::vector<OrientedBox> boxes;
+    std::vector<size_t> boxObjects;
+    pickLights.clear();
+    for (size_t i = 0; i < objects.size(); i++) {
+        const auto& obj = objects[i];
+        if (!obj.isVisible) continue;
+        if (obj.type == CUBE) {
+            const Mesh& mesh = meshes[obj.meshId];
+            boxes.push_back(meshOrientedBox(obj, mesh.boundsMin, mesh.boundsMax));
+            boxObjects.push_back(i);
+        } else {
+            pickLights.push_back(obj.id);
+        }
+    }
+    // Порядок коробок после построения — по id обратно к индексам объектов
+    std::vector<size_t> objectOfId(scene.getNextId(), 0);
+    for (size_t b = 0; b < boxes.size(); b++) {
+        objectOfId[boxes[b].objectId] = boxObjects[b];
+    }
+    pickBVH.build(boxes);
+    pickBoxOfObject.assign(objects.size(), -1);
+    const auto& built = pickBVH.getBoxes();
+    for (size_t b = 0; b < built.size(); b++) {
+        pickBoxOfObject[objectOfId[built[b].objectId]] = (int)b;
+    }
+    pickMovedObjects.clear();
+    pickIndexLayoutVersion = scene.getLayoutVersion();
+    pickIndexValid = true;
+}
+
+// Nearest object under a window position, or -1
+int pickObject(double x, double y, int width, int height, const glm::mat4& viewProjection) {
+    updatePickIndex();
+    Ray ray = screenRay(x, y, width, height, viewProjection);
+    int pickedId = -1;
+    BVHHit hit;
+    hit.t = FLT_MAX;
+    if (pickBVH.intersect(ray, FLT_MAX, hit)) {
+        pickedId = pickBVH.getBoxes()[hit.box].objectId;
+    }
+    // Прокси света мелкие: сфера выбора не меньше LIGHT_PICK_PIXELS на экране
+    float pixelScale = lodPixelScale(glm::radians(CAMERA_FOV_DEGREES), height);
+    for (int id : pickLights) {
+        const SceneObject* light = scene.findObject(id);
+        float radius = fmaxf(0.25f, 0.5f * LIGHT_PICK_PIXELS * glm::distance(ray.origin, light->position) / pixelScale);
+        float t;
+        if (intersectSphere(ray, light->position, radius, hit.t, t)) {
+            hit.t = t;
+            pickedId = id;
+        }
+    }
+    return pickedId;
+}
+
+// additive (Shift): toggles the picked object and keeps the rest, a miss changes nothing
+void selectPickedObject(int objectId, bool additive) {
+    if (additive) {
+        if (objectId != -1) selection.toggle(objectId);
+    } else {
+        selection.set(objectId);
+    }
+    if (selection.empty()) {
+        isRotating = isScaling = isTranslating = false;
+    }
+    sceneDirty = true;
+}
+
+// Every visible object whose bounds reach into the window rectangle: cubes through the pick BVH,
+// lights by position
+void selectMarquee(double x0, double y0, double x1, double y1, int width, int height, const glm::mat4& viewProjection, bool additive) {
+    updatePickIndex();
+    Frustum frustum = marqueeFrustum(x0, y0, x1, y1, width, height, viewProjection);
+    int previousActive = selection.getActive();
+    if (!additive) selection.clear();
+    const auto& boxes = pickBVH.getBoxes();
+    pickBVH.queryFrustum(frustum, [&](int box) {
+        selection.add(boxes[box].objectId, false);
+    });
+    for (int id : pickLights) {
+        if (frustumIntersectsSphere(frustum, scene.findObject(id)->position, 0.0f)) selection.add(id, false);
+    }
+    // Активный остаётся прежним, если он ещё выделен, иначе — наименьший id
+    selection.setActive(selection.contains(previousActive) ? previousActive : selection.first());
+    if (selection.empty()) {
+        isRotating = isScaling = isTranslating = false;
+    }
+    sceneDirty = true;
+}
+
+// Material and/or tint of every selected cube (materialId -1 or tint nullptr keep the object's own)
+void updateSelectedMaterials(int materialId, const glm::vec3* tint) {
+    selection.forEach([&](int id) {
+        const SceneObject* obj = scene.findObject(id);
+        if (!obj || obj->type != CUBE) return;
+        scene.updateObjectMaterial(id, materialId >= 0 ? materialId : obj->materialId, tint ? *tint : obj->tint);
+    });
+}
+
+// One pass over the selection for everything the gizmo and panel accumulated since the last frame
+void applySelectionTransform() {
+    if (pendingSelectionDelta.empty()) return;
+    scene.transformObjects(selection, pendingSelectionDelta);
+    pendingSelectionDelta = TransformDelta();
+}
+
+// Scene::removeObjectsIf keeps the order of the survivors; removed is indexed like the objects before
+template <typename T>
+void compactByMask(std::vector<T>& values, const std::vector<char>& removed) {
+    size_t kept = 0;
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i < removed.size() && removed[i]) continue;
+        values[kept++] = values[i];
+    }
+    values.resize(kept);
+}
+
+void compactObjectLODState(const std::vector<char>& removed) {
+    compactByMask(objectLODs, removed);
+    compactByMask(objectFadeLODs, removed);
+    compactByMask(objectFades, removed);
+}
+
+// Select each object's LOD once per frame from the projected error of its mesh levels and
+// advance cross-fades
+void updateObjectLODs(float deltaTime) {
+    const auto& objects = scene.getObjects();
+    objectLODs.resize(objects.size(), -1);
+    objectFadeLODs.resize(objects.size(), -1);
+    objectFades.resize(objects.size(), 1.0f);
+    fadingObjectCount = 0;
+    impostorObjectCount = 0;
+    glm::vec3 camPos(camPosX, camPosY, camPosZ);
+    float pixelScale = lodPixelScale(glm::radians(CAMERA_FOV_DEGREES), windowHeight);
+    bool gpuCubes = gpuCullingActive();
+    for (size_t i = 0; i < objects.size(); i++) {
+        const auto& obj = objects[i];
+        if (gpuCubes && obj.type == CUBE) continue;
+        const Mesh& mesh = meshes[obj.meshId];
+        float errors[NUM_LODS];
+        for (int lod = 0; lod < NUM_LODS; lod++) {
+            errors[lod] = mesh.lods[lod].error * obj.scale;
+        }
+        // Ближайшая точка ограничивающей сферы
+        float centerDistance = glm::length(obj.position - camPos);
+        float distance = centerDistance - mesh.radius * obj.scale;
+        int previous = objectLODs[i];
+        objectLODs[i] = selectLOD(errors, NUM_LODS, distance, pixelScale, lodSettings, previous);
+        // Дальше последнего LOD — импостор; источники света остаются кубами
+        if (obj.type == CUBE && mesh.impostorSurface && lodSettings.impostorPixels > 0.0f && centerDistance > mesh.radius * obj.scale) {
+            float diameter = 2.0f * mesh.radius * obj.scale * pixelScale / centerDistance;
+            if (selectImpostor(diameter, lodSettings, previous == NUM_LODS)) objectLODs[i] = NUM_LODS;
+        }
+
+        if (!lodCrossFade) {
+            objectFadeLODs[i] = -1;
+        } else if (previous >= 0 && objectLODs[i] != previous) {
+            // Новый переход во время старого начинается от уровня, к которому шли
+            objectFadeLODs[i] = previous;
+            objectFades[i] = 0.0f;
+        } else if (objectFadeLODs[i] >= 0) {
+            objectFades[i] += deltaTime / lodFadeSeconds;
+            if (objectFades[i] >= 1.0f) objectFadeLODs[i] = -1;
+        }
+        if (objectFadeLODs[i] >= 0) fadingObjectCount++;
+        if (objectLODs[i] == NUM_LODS || objectFadeLODs[i] == NUM_LODS) impostorObjectCount++;
+    }
+}
+
+// Path-trace static lighting for all cubes on a background thread; the atlas is uploaded by
+// pollLightingBake once it is done
+void startLightingBake() {
+    if (pendingBake.valid()) return;
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    BakeSettings settings = bakeSettings;
+    settings.maxAtlasSize = maxTextureSize;
+    bakeStartTime = glfwGetTime();
+    bakeProgress.reset();
+    pendingBake = std::async(std::launch::async, [settings, snapshot = scene, progress = &bakeProgress]() {
+        LightmapBaker baker(snapshot, settings);
+        return baker.bake(snapshot, progress);
+    });
+}
+
+void pollLightingBake() {
+    if (!pendingBake.valid() || pendingBake.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+    bakedLightmap = pendingBake.get();
+    gpuInstancesDirty = true;
+    useBakedLighting = true;
+    sceneDirty = true;
+    lastBakeSeconds = glfwGetTime() - bakeStartTime;
+
+    if (!lightmapTexture) glGenTextures(1, &lightmapTexture);
+    glBindTexture(GL_TEXTURE_2D, lightmapTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, glm::max(bakedLightmap.width, 1), glm::max(bakedLightmap.height, 1), 0, GL_RGB, GL_FLOAT,
+                 bakedLightmap.texels.empty() ? nullptr : bakedLightmap.texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    printf("Baked lightmap %dx%d in %.2f s\n", bakedLightmap.width, bakedLightmap.height, lastBakeSeconds);
+}
+
+// Останавливает фоновые задачи до разрушения GL-контекста: иначе выход блокируется в деструкторе future
+void finishBackgroundWork() {
+    if (pendingBake.valid()) {
+        bakeProgress.cancel = true;
+        pendingBake.wait();
+    }
+    if (pendingProbeBake.valid()) {
+        probeBakeProgress.cancel = true;
+        pendingProbeBake.wait();
+    }
+    if (pendingMeshImport.valid()) pendingMeshImport.wait();
+}
+
+// Upload the whole probe grid as three RGBA16F volumes (one per colour channel)
+void uploadProbeTextures() {
+    glm::ivec3 counts = probeGrid.getCounts();
+    for (int c = 0; c < 3; c++) {
+        if (!probeTextures[c]) glGenTextures(1, &probeTextures[c]);
+        glBindTexture(GL_TEXTURE_3D, probeTextures[c]);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, counts.x, counts.y, counts.z, 0, GL_RGBA, GL_FLOAT, probeGrid.getChannel(c).data());
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+// Fit and bake a fresh probe grid over a scene snapshot on a background thread
+void startProbeBake() {
+    if (pendingProbeBake.valid()) return;
+    probeBakeStartTime = glfwGetTime();
+    probeBakeProgress.reset();
+    pendingProbeBake = std::async(std::launch::async, [probes = probeSettings, bake = bakeSettings, snapshot = scene, progress = &probeBakeProgress]() {
+        IrradianceProbeGrid grid;
+        grid.configure(snapshot, probes, bake);
+        grid.bakeAll(progress);
+        return grid;
+    });
+}
+
+void pollProbeBake() {
+    if (!pendingProbeBake.valid() || pendingProbeBake.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+    // Старая сетка может ещё строить baker для инкрементального обновления; не ждём его в кадре
+    if (probeGrid.isRefreshingBaker()) return;
+    probeGrid = pendingProbeBake.get();
+    uploadProbeTextures();
+    useProbes = true;
+    glm::ivec3 counts = probeGrid.getCounts();
+    printf("Baked %dx%dx%d probes in %.2f s\n", counts.x, counts.y, counts.z, glfwGetTime() - probeBakeStartTime);
+}
+
+// Re-bake a few probes and upload only the texels that changed
+void updateProbes() {
+    probeGrid.updateIncremental(scene);
+    std::vector<int> dirty = probeGrid.takeDirtyProbes();
+    for (int c = 0; c < 3; c++) {
+        glBindTexture(GL_TEXTURE_3D, probeTextures[c]);
+        for (int index : dirty) {
+            glm::ivec3 p = probeGrid.probeCoord(index);
+            glTexSubImage3D(GL_TEXTURE_3D, 0, p.x, p.y, p.z, 1, 1, 1, GL_RGBA, GL_FLOAT, &probeGrid.getChannel(c)[index]);
+        }
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
 }
 
 // Framebuffer size callback
@@ -553,27 +1314,59 @@ void framebufferSizeCallback(GLFWwindow* /*window*/, int width, int height) {
     glViewport(0, 0, width, height);
     windowWidth = width;
     windowHeight = height;
-    projection = glm::perspective(glm::radians(45.0f), (float)width / height, 0.1f, 100.0f);
-    glBindBuffer(GL_UNIFORM_BUFFER, matrixUBO);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(projection));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    projection = glm::perspective(glm::radians(CAMERA_FOV_DEGREES), (float)width / height, 0.1f, 100.0f);
 }
 
-// Global deltaTime for keyCallback
+// Frame time, for render-side animation such as LOD fades; movement runs on simulationClock
 float globalDeltaTime = 0.016f;
 
-// Key callback
-void keyCallback(GLFWwindow* window, int key, int /*scancode*/, int action, int mods) {
+// Темп кадров: вертикальная синхронизация, ограничение FPS, режим низкой задержки
+#define LOW_LATENCY_QUEUED_FRAMES 1
+FramePacer framePacer;
+int vsyncMode = VSYNC_ON;
+int appliedVsyncMode = -1;
+int appliedSwapInterval = 1;
+int frameRateLimit = 0; // 0 — без ограничения
+bool lowLatencyMode = false;
+
+void applyVsyncMode() {
+    if (vsyncMode == appliedVsyncMode) return;
+    appliedSwapInterval = framePacer.setVsync((VsyncMode)vsyncMode);
+    appliedVsyncMode = vsyncMode;
+}
+
+// Симуляция с фиксированным шагом: камера двигается по тикам, рисуется между двумя последними
+#define SIMULATION_TICKS_PER_SECOND 60
+FixedTimestep simulationClock(SIMULATION_TICKS_PER_SECOND);
+int simulationRate = SIMULATION_TICKS_PER_SECOND;
+bool interpolateCamera = true;
+glm::vec3 cameraPosition(camPosX, camPosY, camPosZ);
+glm::vec3 previousCameraPosition = cameraPosition;
+
+// Ввод: колбэки GLFW только кладут события в очередь, кадр разбирает её один раз (processInput)
+InputQueue inputQueue;
+KeyBitmap keysDown;
+KeyBitmap mouseButtonsDown;
+bool cursorApplied = false;
+float appliedCursorX = 0.0f, appliedCursorY = 0.0f;
+
+void handleKey(GLFWwindow* window, int key, int action, int mods) {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, GLFW_TRUE);
         return;
     }
-    if (action == GLFW_PRESS && key == GLFW_KEY_DELETE && selectedObjectId != -1) {
-        if (scene.removeObject(selectedObjectId)) {
-            selectedObjectId = -1;
-            isRotating = isScaling = isTranslating = false;
-            sceneDirty = true;
+    if (action == GLFW_PRESS && key == GLFW_KEY_DELETE && !selection.empty()) {
+        // Одним проходом: удаление по одному сдвигало бы массив на каждый объект
+        const auto& objects = scene.getObjects();
+        std::vector<char> removed(objects.size());
+        for (size_t i = 0; i < objects.size(); i++) {
+            removed[i] = selection.contains(objects[i].id);
         }
+        scene.removeObjectsIf([](const SceneObject& obj) { return selection.contains(obj.id); });
+        compactObjectLODState(removed);
+        selection.clear();
+        isRotating = isScaling = isTranslating = false;
+        sceneDirty = true;
         return;
     }
 
@@ -584,69 +1377,37 @@ void keyCallback(GLFWwindow* window, int key, int /*scancode*/, int action, int
         else if (key == GLFW_KEY_T) isTranslating = true;
         sceneDirty = true;
     }
-
-    float deltaTime = globalDeltaTime;
-    glm::vec3 right = glm::normalize(glm::cross(cameraFront, glm::vec3(0.0f, 1.0f, 0.0f)));
-
-    if (action == GLFW_PRESS || action == GLFW_REPEAT) {
-        if (key == GLFW_KEY_W) {
-            camPosX += camSpeed * deltaTime * cameraFront.x;
-            camPosY += camSpeed * deltaTime * cameraFront.y;
-            camPosZ += camSpeed * deltaTime * cameraFront.z;
-        }
-        else if (key == GLFW_KEY_S) {
-            camPosX -= camSpeed * deltaTime * cameraFront.x;
-            camPosY -= camSpeed * deltaTime * cameraFront.y;
-            camPosZ -= camSpeed * deltaTime * cameraFront.z;
-        }
-        else if (key == GLFW_KEY_A) {
-            camPosX -= camSpeed * deltaTime * right.x;
-            camPosZ -= camSpeed * deltaTime * right.z;
-        }
-        else if (key == GLFW_KEY_D) {
-            camPosX += camSpeed * deltaTime * right.x;
-            camPosZ += camSpeed * deltaTime * right.z;
-        }
-        else if (key == GLFW_KEY_SPACE) {
-            camPosY += camSpeed * deltaTime;
-        }
-        else if (key == GLFW_KEY_LEFT_CONTROL) {
-            camPosY -= camSpeed * deltaTime;
-        }
-        cameraDirty = true;
-        sceneDirty = true;
-    }
 }
 
-// Mouse move callback
-void mouseMoveCallback(GLFWwindow* window, double xpos, double ypos) {
-    if (isDragging && selectedObjectId != -1) {
+void handleCursorMotion(GLFWwindow* window, double xpos, double ypos) {
+    if (marqueePressed) {
+        marqueeEndX = xpos;
+        marqueeEndY = ypos;
+        if (fabs(xpos - marqueeStartX) > MARQUEE_MIN_PIXELS || fabs(ypos - marqueeStartY) > MARQUEE_MIN_PIXELS) marqueeActive = true;
+    }
+    if (isDragging && selection.getActive() != -1) {
         int width, height;
         glfwGetWindowSize(window, &width, &height);
         float x = (xpos / width) * 2 - 1;
         float y = -((ypos / height) * 2 - 1);
 
-        SceneObject* obj = scene.getObject(selectedObjectId);
-        if (obj) {
-            if (isRotating && obj->type == CUBE) {
-                obj->rotation.x += (y - lastY) * 180.0f;
-                obj->rotation.y += (x - lastX) * 180.0f;
-            }
-            else if (isScaling && obj->type == CUBE) {
-                obj->scale += (y - lastY) * 2.0f;
-                if (obj->scale < 0.1f) obj->scale = 0.1f;
-                if (obj->scale > 2.0f) obj->scale = 2.0f;
-            }
-            else if (isTranslating) {
-                obj->position.x += (x - lastX);
-                obj->position.y += (y - lastY);
-            }
-            sceneDirty = true;
+        // Только копим: сцена меняется одним проходом по выделению в начале кадра
+        if (isRotating) {
+            pendingSelectionDelta.rotation.x += (y - lastY) * 180.0f;
+            pendingSelectionDelta.rotation.y += (x - lastX) * 180.0f;
         }
+        else if (isScaling) {
+            pendingSelectionDelta.scale += (y - lastY) * 2.0f;
+        }
+        else if (isTranslating) {
+            pendingSelectionDelta.translation.x += (x - lastX);
+            pendingSelectionDelta.translation.y += (y - lastY);
+        }
+        sceneDirty = true;
         lastX = x;
         lastY = y;
     }
-    else if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
+    else if (mouseButtonsDown.isDown(GLFW_MOUSE_BUTTON_RIGHT)) {
         if (firstMouse) {
             lastMouseX = xpos;
             lastMouseY = ypos;
@@ -675,58 +1436,130 @@ void mouseMoveCallback(GLFWwindow* window, double xpos, double ypos) {
     }
 }
 
-// Mouse button callback
-void mouseButtonCallback(GLFWwindow* window, int button, int action, int /*mods*/) {
+// xpos, ypos: cursor when the button changed
+void handleMouseButton(GLFWwindow* window, int button, int action, int mods, double xpos, double ypos) {
     if (button == GLFW_MOUSE_BUTTON_LEFT) {
         if (action == GLFW_PRESS) {
             bool isOverImGui = ImGui::GetIO().WantCaptureMouse;
 
             isDragging = true;
-            double xpos, ypos;
-            glfwGetCursorPos(window, &xpos, &ypos);
             int width, height;
             glfwGetWindowSize(window, &width, &height);
             lastX = (xpos / width) * 2 - 1;
             lastY = -((ypos / height) * 2 - 1);
 
+            // Выбор — при отпускании: клик или рамка
             if (!isOverImGui && !isRotating && !isScaling && !isTranslating) {
-                float minDist = FLT_MAX;
-                int closestObjectId = -1;
-
-                for (const auto& obj : scene.getObjects()) {
-                    if (!obj.isVisible) continue;
-                    glm::vec3 screenPos = glm::project(
-                        obj.position,
-                        glm::lookAt(glm::vec3(camPosX, camPosY, camPosZ),
-                            glm::vec3(camPosX, camPosY, camPosZ) + cameraFront,
-                            glm::vec3(0.0f, 1.0f, 0.0f)),
-                        projection,
-                        glm::vec4(0, 0, width, height)
-                    );
-                    float dist = glm::distance(glm::vec2(screenPos), glm::vec2(xpos, height - ypos));
-                    float clickRadius = 30.0f; // Базовый радиус клика
-                    if (obj.type == POINT_LIGHT || obj.type == DIRECTIONAL_LIGHT || obj.type == AMBIENT_LIGHT) {
-                        clickRadius = 50.0f; // Увеличенный радиус для источников света
-                    }
-                    if (dist < clickRadius && dist < minDist) {
-                        minDist = dist;
-                        closestObjectId = obj.id;
-                    }
-                }
-
-                selectedObjectId = closestObjectId;
-                if (selectedObjectId == -1) {
-                    isRotating = isScaling = isTranslating = false;
-                }
-                sceneDirty = true;
+                marqueePressed = true;
+                marqueeActive = false;
+                marqueeStartX = marqueeEndX = xpos;
+                marqueeStartY = marqueeEndY = ypos;
             }
         }
         else if (action == GLFW_RELEASE) {
             isDragging = false;
+            if (!marqueePressed) return;
+            marqueePressed = false;
+
+            int width, height;
+            glfwGetWindowSize(window, &width, &height);
+            bool additive = (mods & GLFW_MOD_SHIFT) != 0;
+            glm::mat4 view = glm::lookAt(glm::vec3(camPosX, camPosY, camPosZ),
+                glm::vec3(camPosX, camPosY, camPosZ) + cameraFront,
+                glm::vec3(0.0f, 1.0f, 0.0f));
+            if (marqueeActive) {
+                marqueeActive = false;
+                selectMarquee(marqueeStartX, marqueeStartY, xpos, ypos, width, height, projection * view, additive);
+            } else if (useIdPicking && objectIdBuffer.isReady()) {
+                // Ответ придёт через кадр-два из буфера id
+                pendingIdClick = true;
+                pendingIdClickAdditive = additive;
+                pendingIdClickX = xpos * windowWidth / width;
+                pendingIdClickY = ypos * windowHeight / height;
+            } else {
+                selectPickedObject(pickObject(xpos, ypos, width, height, projection * view), additive);
+            }
         }
     }
 }
 
+// One simulation tick: held movement keys are polled, so speed no longer follows key repeat
+void simulateTick(float step) {
+    previousCameraPosition = cameraPosition;
+    glm::vec3 right = glm::normalize(glm::cross(cameraFront, glm::vec3(0.0f, 1.0f, 0.0f)));
+    glm::vec3 move(0.0f);
+    if (keysDown.isDown(GLFW_KEY_W)) move += cameraFront;
+    if (keysDown.isDown(GLFW_KEY_S)) move -= cameraFront;
+    if (keysDown.isDown(GLFW_KEY_A)) move -= glm::vec3(right.x, 0.0f, right.z);
+    if (keysDown.isDown(GLFW_KEY_D)) move += glm::vec3(right.x, 0.0f, right.z);
+    if (keysDown.isDown(GLFW_KEY_SPACE)) move.y += 1.0f;
+    if (keysDown.isDown(GLFW_KEY_LEFT_CONTROL)) move.y -= 1.0f;
+    cameraPosition += move * (camSpeed * step);
+}
+
+// Rendered camera between the last two ticks
+void updateRenderCamera(float alpha) {
+    glm::vec3 position = interpolateCamera ? glm::mix(previousCameraPosition, cameraPosition, alpha) : cameraPosition;
+    if (position == glm::vec3(camPosX, camPosY, camPosZ)) return;
+    camPosX = position.x;
+    camPosY = position.y;
+    camPosZ = position.z;
+    sceneDirty = true;
+}
+
+// Motion runs at most once per discrete event plus once at the end, however many moves arrived
+void applyCursor(GLFWwindow* window, float x, float y) {
+    if (cursorApplied && x == appliedCursorX && y == appliedCursorY) return;
+    cursorApplied = true;
+    appliedCursorX = x;
+    appliedCursorY = y;
+    handleCursorMotion(window, x, y);
+}
+
+void processInput(GLFWwindow* window) {
+    InputEvent event;
+    while (inputQueue.pop(event)) {
+        applyCursor(window, event.x, event.y);
+        bool down = event.action != GLFW_RELEASE;
+        if (event.type == INPUT_KEY) {
+            keysDown.set(event.code, down);
+            handleKey(window, event.code, event.action, event.mods);
+        } else {
+            mouseButtonsDown.set(event.code, down);
+            handleMouseButton(window, event.code, event.action, event.mods, event.x, event.y);
+        }
+    }
+    float x, y;
+    if (inputQueue.getCursor(x, y)) applyCursor(window, x, y);
+    if (uint32_t dropped = inputQueue.takeDropped()) printf("Input queue full, %u events dropped\n", dropped);
+}
+
+void queueInputEvent(GLFWwindow* window, InputEventType type, int code, int action, int mods) {
+    double xpos, ypos;
+    glfwGetCursorPos(window, &xpos, &ypos);
+    InputEvent event;
+    event.type = type;
+    event.action = (uint8_t)action;
+    event.mods = (uint16_t)mods;
+    event.code = code;
+    event.x = (float)xpos;
+    event.y = (float)ypos;
+    inputQueue.push(event);
+}
+
+void keyCallback(GLFWwindow* window, int key, int /*scancode*/, int action, int mods) {
+    if (key == GLFW_KEY_UNKNOWN) return;
+    queueInputEvent(window, INPUT_KEY, key, action, mods);
+}
+
+void mouseMoveCallback(GLFWwindow* /*window*/, double xpos, double ypos) {
+    inputQueue.setCursor(xpos, ypos);
+}
+
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+    queueInputEvent(window, INPUT_MOUSE_BUTTON, button, action, mods);
+}
+
 // Draw ImGui panel
 void drawImGui() {
     ImGui_ImplOpenGL3_NewFrame();
@@ -739,31 +1572,53 @@ void drawImGui() {
     ImGui::Begin("Scene Hierarchy", nullptr, window_flags);
 
     ImGui::Text("Scene Objects:");
+    ImGui::Text("Selected: %zu (Shift adds, drag for a box)", selection.size());
     ImGui::Separator();
 
     for (const auto& obj : scene.getObjects()) {
         std::string label = obj.name + " (ID: " + std::to_string(obj.id) + ")";
-        if (ImGui::Selectable(label.c_str(), selectedObjectId == obj.id)) {
-            selectedObjectId = obj.id;
+        if (ImGui::Selectable(label.c_str(), selection.contains(obj.id))) {
+            if (ImGui::GetIO().KeyShift) selection.toggle(obj.id);
+            else selection.set(obj.id);
             isRotating = isScaling = isTranslating = false;
             sceneDirty = true;
         }
-        if (selectedObjectId == obj.id) {
+        if (selection.getActive() == obj.id) {
             ImGui::Text("Properties:");
+            if (selection.size() > 1) ImGui::Text("Edits apply to all %zu selected", selection.size());
+            // Значения активного объекта; изменение уходит дельтой на всё выделение
             float pos[3] = { obj.position.x, obj.position.y, obj.position.z };
             if (ImGui::DragFloat3("Position", pos, 0.1f)) {
-                scene.updateObjectPosition(obj.id, glm::vec3(pos[0], pos[1], pos[2]));
+                pendingSelectionDelta.translation += glm::vec3(pos[0], pos[1], pos[2]) - obj.position;
                 sceneDirty = true;
             }
             if (obj.type == CUBE) {
                 float rot[2] = { obj.rotation.x, obj.rotation.y };
                 if (ImGui::DragFloat2("Rotation", rot, 1.0f)) {
-                    scene.updateObjectRotation(obj.id, glm::vec2(rot[0], rot[1]));
+                    pendingSelectionDelta.rotation += glm::vec2(rot[0], rot[1]) - obj.rotation;
                     sceneDirty = true;
                 }
                 float scale = obj.scale;
                 if (ImGui::DragFloat("Scale", &scale, 0.01f, 0.1f, 2.0f)) {
-                    scene.updateObjectScale(obj.id, scale);
+                    pendingSelectionDelta.scale += scale - obj.scale;
+                    sceneDirty = true;
+                }
+                const auto& materialList = materials.getMaterials();
+                int materialId = obj.materialId;
+                const char* materialName = materialId >= 0 && materialId < (int)materialList.size() ? materialList[materialId].name.c_str() : "?";
+                if (ImGui::BeginCombo("Material", materialName)) {
+                    for (int m = 0; m < (int)materialList.size(); m++) {
+                        if (ImGui::Selectable(materialList[m].name.c_str(), m == materialId)) {
+                            updateSelectedMaterials(m, nullptr);
+                            sceneDirty = true;
+                        }
+                    }
+                    ImGui::EndCombo();
+                }
+                float tint[3] = { obj.tint.x, obj.tint.y, obj.tint.z };
+                if (ImGui::ColorEdit3("Tint", tint)) {
+                    glm::vec3 newTint(tint[0], tint[1], tint[2]);
+                    updateSelectedMaterials(-1, &newTint);
                     sceneDirty = true;
                 }
             }
@@ -839,74 +1694,135 @@ void drawImGui() {
         ImGui::EndPopup();
     }
 
+    ImGui::Separator();
+    ImGui::Checkbox("Depth prepass", &depthPrepass);
+    // Стадии из архива уже препроцессированы: следить не за чем, правки идут через nexyl-cook
+    bool watchableShaders = !shaders.getDependencies().empty();
+    ImGui::BeginDisabled(!watchableShaders);
+    ImGui::Checkbox("Hot reload shaders", &hotReloadShaders);
+    ImGui::EndDisabled();
+    if (!watchableShaders) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("(cooked shaders: re-run nexyl-cook)");
+    }
+    ImGui::Checkbox("Pixel-exact picking (ID buffer)", &useIdPicking);
+    ImGui::Checkbox("Highlight under cursor", &hoverHighlight);
+    if (ImGui::SliderInt("Simulation rate (Hz)", &simulationRate, 10, 240)) {
+        simulationClock.setRate(simulationRate);
+    }
+    ImGui::Checkbox("Interpolate camera", &interpolateCamera);
+    const char* vsyncModes[] = { "Off", "On", "Adaptive" };
+    ImGui::Combo("VSync", &vsyncMode, vsyncModes, 3);
+    if (vsyncMode == VSYNC_ADAPTIVE && appliedSwapInterval != -1) {
+        ImGui::Text("Adaptive vsync unsupported, using On");
+    }
+    ImGui::SliderInt("Frame cap (FPS, 0 = off)", &frameRateLimit, 0, 360);
+    ImGui::Checkbox("Low-latency mode", &lowLatencyMode);
+    ImGui::SliderFloat("LOD pixel error", &lodSettings.pixelError, 0.25f, 8.0f);
+    ImGui::SliderFloat("LOD quality bias", &lodSettings.qualityBias, 0.25f, 4.0f);
+    ImGui::SliderFloat("LOD hysteresis", &lodSettings.hysteresis, 0.0f, 0.5f);
+    ImGui::SliderFloat("Impostor size (px)", &lodSettings.impostorPixels, 0.0f, 256.0f, "%.0f");
+    if (gpuCuller.isReady()) {
+        if (ImGui::Checkbox("GPU culling", &useGpuCulling)) gpuInstancesDirty = true;
+        if (depthPyramid.isReady()) {
+            ImGui::Checkbox("Occlusion culling", &useOcclusionCulling);
+        }
+    } else {
+        ImGui::Text("GPU culling needs GL 4.3 (CPU path)");
+    }
+    ImGui::Checkbox("LOD cross-fade", &lodCrossFade);
+    if (lodCrossFade) {
+        ImGui::SliderFloat("LOD fade time", &lodFadeSeconds, 0.05f, 1.0f, "%.2f s");
+    }
+    if (shaders.getPendingCount() > 0) {
+        ImGui::Text("Compiling shaders: %d", shaders.getPendingCount());
+    }
+    if (textureStreamer.getPendingCount() > 0) {
+        ImGui::Text("Loading textures: %d", textureStreamer.getPendingCount());
+    }
+
+    ImGui::Separator();
+    ImGui::InputText("Mesh file", importMeshPath, sizeof(importMeshPath));
+    if (pendingMeshImport.valid()) {
+        ImGui::Text("Importing... %.1f s", glfwGetTime() - meshImportStartTime);
+    } else if (ImGui::Button("Import Mesh (OBJ/glTF)")) {
+        startMeshImport(importMeshPath);
+    }
+
+    ImGui::Separator();
+    ImGui::Text("Baked Lighting:");
+    ImGui::SliderInt("Texels per face", &bakeSettings.texelsPerFace, 2, 32);
+    ImGui::SliderInt("Samples per texel", &bakeSettings.samplesPerTexel, 1, 1024);
+    ImGui::SliderInt("Bounces", &bakeSettings.maxBounces, 0, 8);
+    if (pendingBake.valid()) {
+        ImGui::Text("Baking... %d / %d tiles, %.1f s", bakeProgress.completedTiles.load(), bakeProgress.totalTiles.load(), glfwGetTime() - bakeStartTime);
+    } else if (ImGui::Button("Bake Lighting")) {
+        startLightingBake();
+    }
+    if (lightmapTexture && !pendingBake.valid()) {
+        ImGui::SameLine();
+        ImGui::Text("%.2f s", lastBakeSeconds);
+        if (ImGui::Checkbox("Use Baked Lighting", &useBakedLighting)) {
+            sceneDirty = true;
+            gpuInstancesDirty = true;
+        }
+    }
+
+    ImGui::Separator();
+    ImGui::Text("Irradiance Probes:");
+    ImGui::DragFloat("Probe spacing", &probeSettings.spacing, 0.05f, 0.25f, 8.0f);
+    ImGui::SliderInt("Samples per probe", &probeSettings.samplesPerProbe, 16, 4096);
+    if (pendingProbeBake.valid()) {
+        ImGui::Text("Baking probes... %d / %d, %.1f s", probeBakeProgress.completedTiles.load(), probeBakeProgress.totalTiles.load(), glfwGetTime() - probeBakeStartTime);
+    } else if (ImGui::Button("Bake Probes")) {
+        startProbeBake();
+    }
+    if (probeTextures[0]) {
+        ImGui::Checkbox("Use Probes", &useProbes);
+        ImGui::Checkbox("Update probes incrementally", &updateProbesIncrementally);
+        if (updateProbesIncrementally) {
+            ImGui::SliderInt("Probes per frame", &probeGrid.getSettings().probesPerFrame, 1, 64);
+        }
+    }
+
     ImGui::End();
+
+    if (marqueeActive) {
+        // Координаты курсора GLFW и ImGui совпадают (окно, не буфер кадра)
+        ImVec2 from((float)fmin(marqueeStartX, marqueeEndX), (float)fmin(marqueeStartY, marqueeEndY));
+        ImVec2 to((float)fmax(marqueeStartX, marqueeEndX), (float)fmax(marqueeStartY, marqueeEndY));
+        ImDrawList* drawList = ImGui::GetForegroundDrawList();
+        drawList->AddRectFilled(from, to, IM_COL32(80, 140, 255, 40));
+        drawList->AddRect(from, to, IM_COL32(80, 140, 255, 200));
+    }
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
 // Draw objects
-void drawObjects(int lod, bool isOutlinePass, bool renderLights = false) {
-    glUniform1i(uniforms.isOutline, isOutlinePass ? 1 : 0);
-    glUniform1f(uniforms.outlineWidth, 0.2f);
-    glUniform1f(uniforms.time, globalTime);
-    updateInstanceVBO(lod, renderLights);
-    glBindVertexArray(VAOs[lod]);
-    std::vector<glm::mat4> modelMatrices;
-    glm::vec3 camPos(camPosX, camPosY, camPosZ);
-    for (const auto& obj : scene.getObjects()) {
-        if (!obj.isVisible) continue;
-        if (renderLights && (obj.type != POINT_LIGHT && obj.type != DIRECTIONAL_LIGHT && obj.type != AMBIENT_LIGHT)) continue;
-        if (!renderLights && obj.type != CUBE) continue;
-        float distance = glm::length(obj.position - camPos);
-        if (selectLOD(distance) == lod) {
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, obj.position);
-            if (obj.type == CUBE || obj.type == POINT_LIGHT || obj.type == DIRECTIONAL_LIGHT || obj.type == AMBIENT_LIGHT) {
-                model = glm::rotate(model, glm::radians(obj.rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-                model = glm::rotate(model, glm::radians(obj.rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-                float scale = obj.scale;
-                if (obj.type == POINT_LIGHT) {
-                    scale = 0.15f;
-                } else if (obj.type == DIRECTIONAL_LIGHT) {
-                    scale = 0.2f;
-                    glm::vec3 dir = glm::normalize(obj.lightDirection);
-                    glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-                    if (glm::abs(glm::dot(dir, up)) > 0.99f) up = glm::vec3(0.0f, 0.0f, 1.0f);
-                    glm::vec3 right = glm::normalize(glm::cross(up, dir));
-                    up = glm::cross(dir, right);
-                    glm::mat4 rotation = glm::mat4(
-                        glm::vec4(right, 0.0f),
-                        glm::vec4(up, 0.0f),
-                        glm::vec4(dir, 0.0f),
-                        glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
-                    );
-                    model = model * rotation;
-                } else if (obj.type == AMBIENT_LIGHT) {
-                    scale = (selectedObjectId == obj.id) ? 0.2f + 0.05f * sin(globalTime * 2.0f) : 0.2f;
-                }
-                model = glm::scale(model, glm::vec3(scale));
-            }
-            modelMatrices.push_back(model);
-        }
-    }
-    if (!modelMatrices.empty()) {
-        glDrawElementsInstanced(GL_TRIANGLES, indexCounts[lod], GL_UNSIGNED_INT, 0, modelMatrices.size());
+// Pass constants (outline flag etc.) must already be bound with bindPass()
+void drawObjects(int lod, bool renderLights = false, bool fading = false, bool incomingOnly = false) {
+    // Один инстанс-вызов на меш; источники света рисуются кубом
+    for (int meshId = 0; meshId < (int)meshes.size(); meshId++) {
+        if (renderLights && meshId > 0) break;
+        const MeshLOD& mesh = meshes[meshId].lods[lod];
+        size_t instanceCount = bindInstanceBatch(mesh.VAO, meshId, renderLights, lod, fading, incomingOnly);
+        if (instanceCount == 0) continue;
+        glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0, instanceCount);
     }
     glBindVertexArray(0);
 }
 
-// Draw gizmo (for cube and directional light)
-void drawGizmo(const glm::vec3& position, ObjectType type) {
+// Draw gizmo (for cube and directional light) with the gizmo shader variant bound
+void drawGizmo(const ShaderVariant& variant, const glm::vec3& position, ObjectType type) {
     printf("Drawing gizmo for object at position (%.2f, %.2f, %.2f), type: %d\n", 
            position.x, position.y, position.z, type);
 
-    glUniform1i(uniforms.isOutline, 0);
-    glUniform1f(uniforms.time, globalTime);
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::translate(model, position);
 
     if (type == DIRECTIONAL_LIGHT) {
-        SceneObject* obj = scene.getObject(selectedObjectId);
+        const SceneObject* obj = scene.findObject(selection.getActive());
         if (obj) {
             glm::vec3 dir = glm::normalize(obj->lightDirection);
             glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
@@ -925,16 +1841,7 @@ void drawGizmo(const glm::vec3& position, ObjectType type) {
     } else {
         model = glm::scale(model, glm::vec3(0.5f));
     }
-
-    // Обновляем матрицу вида в UBO
-    glm::mat4 view = glm::lookAt(
-        glm::vec3(camPosX, camPosY, camPosZ),
-        glm::vec3(camPosX, camPosY, camPosZ) + cameraFront,
-        glm::vec3(0.0f, 1.0f, 0.0f)
-    );
-    glBindBuffer(GL_UNIFORM_BUFFER, matrixUBO);
-    glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(view));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glUniformMatrix4fv(variant.uniforms.gizmoModel, 1, GL_FALSE, glm::value_ptr(model));
 
     glBindVertexArray(gizmoVAO);
     if (type == DIRECTIONAL_LIGHT) {
@@ -945,32 +1852,221 @@ void drawGizmo(const glm::vec3& position, ObjectType type) {
     glBindVertexArray(0);
 }
 
-// Draw sphere (for point light radius)
-void drawSphere(const glm::vec3& position, float radius) {
+// Draw sphere (for point light radius) with the gizmo shader variant bound
+void drawSphere(const ShaderVariant& variant, const glm::vec3& position, float radius) {
     printf("Drawing sphere for point light at position (%.2f, %.2f, %.2f), radius: %.2f\n", 
            position.x, position.y, position.z, radius);
 
-    glUniform1i(uniforms.isOutline, 0);
-    glUniform1f(uniforms.time, globalTime);
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::translate(model, position);
     model = glm::scale(model, glm::vec3(radius));
-
-    // Обновляем матрицу вида в UBO
-    glm::mat4 view = glm::lookAt(
-        glm::vec3(camPosX, camPosY, camPosZ),
-        glm::vec3(camPosX, camPosY, camPosZ) + cameraFront,
-        glm::vec3(0.0f, 1.0f, 0.0f)
-    );
-    glBindBuffer(GL_UNIFORM_BUFFER, matrixUBO);
-    glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(view));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glUniformMatrix4fv(variant.uniforms.gizmoModel, 1, GL_FALSE, glm::value_ptr(model));
 
     glBindVertexArray(sphereVAO);
     glDrawElements(GL_LINES, sphereIndexCount, GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
 }
 
+// Binds the variant if it has finished compiling, else the fallback (built synchronously if needed).
+// Returns nullptr when neither is usable; the caller skips its draws for this frame.
+const ShaderVariant* useShaderVariant(unsigned features, unsigned fallback = 0) {
+    const ShaderVariant* variant = shaders.tryGet(features);
+    if ((!variant || !variant->program) && fallback) variant = &shaders.get(fallback);
+    if (!variant || !variant->program) return nullptr;
+    glUseProgram(variant->program);
+    return variant;
+}
+
+// Feature mask of the lit cube variant for the current frame
+unsigned litShaderFeatures(int lightType) {
+    unsigned features = SHADER_LIT;
+    if (lightType == 0) features |= SHADER_LIGHT_POINT;
+    else if (lightType == 1) features |= SHADER_LIGHT_DIRECTIONAL;
+    if (useBakedLighting && lightmapTexture) features |= SHADER_LIGHTMAP;
+    if (useProbes && probeTextures[0]) features |= SHADER_PROBES;
+    return features;
+}
+
+// Impostor tier: one quad per instance with the variant's IMPOSTOR twin bound
+void drawImpostors(const ShaderVariant& variant, bool fading, bool incomingOnly = false) {
+    for (int meshId = 0; meshId < (int)meshes.size(); meshId++) {
+        const Mesh& mesh = meshes[meshId];
+        if (!mesh.impostorSurface) continue;
+        size_t instanceCount = bindInstanceBatch(impostorVAO, meshId, false, NUM_LODS, fading, incomingOnly);
+        if (instanceCount == 0) continue;
+        glActiveTexture(GL_TEXTURE5);
+        glBindTexture(GL_TEXTURE_2D, mesh.impostorSurface);
+        glActiveTexture(GL_TEXTURE6);
+        glBindTexture(GL_TEXTURE_2D, mesh.impostorNormal);
+        glUniform1f(variant.uniforms.impostorRadius, mesh.radius);
+        glBindVertexArray(impostorVAO);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, instanceCount);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(0);
+}
+
+// Variant for cross-fading instances. The LOD_FADE one is only requested, never waited for; until
+// it is built they are drawn with the plain variant (or its fallback), incoming level only.
+const ShaderVariant* useFadeVariant(unsigned features, unsigned fallback = 0) {
+    if (const ShaderVariant* variant = useShaderVariant(features | SHADER_LOD_FADE)) return variant;
+    return useShaderVariant(features, fallback);
+}
+
+// GPU path: one indirect draw per (mesh, level) list written by cull.glsl, settled lists first,
+// then the cross-fading ones, each tier with the matching GPU_DRIVEN variant. phase: a CullPhase,
+// or -1 for both.
+bool drawGpuLists(unsigned features, unsigned fallback, int phase = -1) {
+    int firstPhase = phase < 0 ? CULL_PHASE_EARLY : phase;
+    int lastPhase = phase < 0 ? CULL_PHASE_LATE : phase;
+    bool drawn = false;
+    for (int fading = 0; fading < (lodCrossFade ? 2 : 1); fading++) {
+        unsigned meshFeatures = features | SHADER_GPU_DRIVEN;
+        unsigned meshFallback = fallback ? fallback | SHADER_GPU_DRIVEN : 0;
+        // Без LOD_FADE вершинный шейдер отбрасывает уходящий уровень, как bindInstanceBatch(incomingOnly) на CPU
+        if (const ShaderVariant* variant = fading ? useFadeVariant(meshFeatures, meshFallback) : useShaderVariant(meshFeatures, meshFallback)) {
+            drawn = true;
+            glUniform1i(variant->uniforms.hoveredObjectId, hoveredObjectId);
+            for (int meshId = 0; meshId < (int)meshes.size(); meshId++) {
+                if (!gpuGroupInstances[meshId]) continue;
+                for (int lod = 0; lod < NUM_LODS; lod++) {
+                    glBindVertexArray(meshes[meshId].lods[lod].VAO);
+                    for (int p = firstPhase; p <= lastPhase; p++) {
+                        gpuCuller.drawList(meshId, lod, fading != 0, p);
+                    }
+                }
+            }
+        }
+        unsigned impostorFeatures = (meshFeatures & ~SHADER_LIGHTMAP) | SHADER_IMPOSTOR;
+        if (const ShaderVariant* variant = fading ? useFadeVariant(impostorFeatures) : useShaderVariant(impostorFeatures)) {
+            glUniform1i(variant->uniforms.hoveredObjectId, hoveredObjectId);
+            glBindVertexArray(impostorVAO);
+            for (int meshId = 0; meshId < (int)meshes.size(); meshId++) {
+                const Mesh& mesh = meshes[meshId];
+                if (!gpuGroupInstances[meshId] || !mesh.impostorSurface) continue;
+                glActiveTexture(GL_TEXTURE5);
+                glBindTexture(GL_TEXTURE_2D, mesh.impostorSurface);
+                glActiveTexture(GL_TEXTURE6);
+                glBindTexture(GL_TEXTURE_2D, mesh.impostorNormal);
+                glUniform1f(variant->uniforms.impostorRadius, mesh.radius);
+                for (int p = firstPhase; p <= lastPhase; p++) {
+                    gpuCuller.drawList(meshId, NUM_LODS, fading != 0, p);
+                }
+            }
+            glActiveTexture(GL_TEXTURE0);
+        }
+    }
+    glBindVertexArray(0);
+    return drawn;
+}
+
+// Draws every LOD with one variant, then the instances mid cross-fade with its LOD_FADE twin
+// (kept separate so settled instances keep early depth testing), then impostors. Returns false
+// if nothing was bound.
+bool drawAllLODs(unsigned features, unsigned fallback, bool renderLights) {
+    if (!renderLights && gpuCullingActive()) return drawGpuLists(features, fallback);
+    if (!useShaderVariant(features, fallback)) return false;
+    for (int i = 0; i < NUM_LODS; i++) {
+        drawObjects(i, renderLights);
+    }
+    // Без варианта LOD_FADE рисуется только уровень, к которому идёт переход, без дизеринга
+    const ShaderVariant* fadeVariant = fadingObjectCount > 0 ? useFadeVariant(features, fallback) : nullptr;
+    if (fadeVariant) {
+        bool dithered = (fadeVariant->features & SHADER_LOD_FADE) != 0;
+        for (int i = 0; i < NUM_LODS; i++) {
+            drawObjects(i, renderLights, true, !dithered);
+        }
+    }
+    if (!renderLights && impostorObjectCount > 0) {
+        unsigned impostorFeatures = (features & ~SHADER_LIGHTMAP) | SHADER_IMPOSTOR;
+        if (const ShaderVariant* variant = useShaderVariant(impostorFeatures)) {
+            drawImpostors(*variant, false);
+        }
+        if (fadingObjectCount > 0) {
+            if (const ShaderVariant* variant = useFadeVariant(impostorFeatures)) {
+                drawImpostors(*variant, true, (variant->features & SHADER_LOD_FADE) == 0);
+            }
+        }
+    }
+    return true;
+}
+
+// Renders the id pass and queues a read under the cursor (or the pending click); results from
+// earlier frames are applied first
+void updateObjectIdPicking(GLFWwindow* window) {
+    ObjectIdResult result;
+    while (objectIdBuffer.poll(result)) {
+        if (result.isClick) selectPickedObject(result.objectId, pendingIdClickAdditive);
+        else hoveredObjectId = result.objectId;
+    }
+    if (!useIdPicking && !hoverHighlight) {
+        hoveredObjectId = -1;
+        pendingIdClick = false;
+        return;
+    }
+    objectIdBuffer.resize(windowWidth, windowHeight);
+    if (!objectIdBuffer.isReady()) return;
+    objectIdBuffer.begin();
+    bindPass(PASS_BASE);
+    drawAllLODs(SHADER_OBJECT_ID, 0, false);
+    drawAllLODs(SHADER_OBJECT_ID, 0, true);
+    objectIdBuffer.end();
+
+    if (pendingIdClick) {
+        if (objectIdBuffer.request((int)pendingIdClickX, windowHeight - 1 - (int)pendingIdClickY, true)) pendingIdClick = false;
+    } else if (hoverHighlight && !ImGui::GetIO().WantCaptureMouse) {
+        double xpos, ypos;
+        glfwGetCursorPos(window, &xpos, &ypos);
+        int width, height;
+        glfwGetWindowSize(window, &width, &height);
+        int x = (int)(xpos * windowWidth / width), y = windowHeight - 1 - (int)(ypos * windowHeight / height);
+        if (x < 0 || y < 0 || x >= windowWidth || y >= windowHeight) hoveredObjectId = -1;
+        else objectIdBuffer.request(x, y, false);
+    } else {
+        hoveredObjectId = -1;
+    }
+}
+
+// Submits every variant the renderer can ask for, so the driver compiles them in parallel at startup
+void requestShaderVariants() {
+    // Варианты для кубов нужны и в GPU_DRIVEN-версии, если отсечение на GPU доступно
+    auto requestInstanced = [](unsigned features) {
+        shaders.request(features);
+        if (gpuCuller.isReady()) shaders.request(features | SHADER_GPU_DRIVEN);
+    };
+    const unsigned lightBits[] = { 0, SHADER_LIGHT_POINT, SHADER_LIGHT_DIRECTIONAL };
+    for (unsigned light : lightBits) {
+        for (unsigned extras = 0; extras < 8; extras++) {
+            unsigned features = SHADER_LIT | light;
+            if (extras & 1) features |= SHADER_LIGHTMAP;
+            if (extras & 2) features |= SHADER_PROBES;
+            if (extras & 4) features |= SHADER_LOD_FADE;
+            requestInstanced(features);
+        }
+    }
+    requestInstanced(SHADER_DEPTH_ONLY);
+    requestInstanced(SHADER_OUTLINE);
+    shaders.request(SHADER_LIGHT_PROXY);
+    shaders.request(SHADER_GIZMO);
+    // Дизеренные двойники для объектов в переходе между LOD
+    requestInstanced(SHADER_DEPTH_ONLY | SHADER_LOD_FADE);
+    requestInstanced(SHADER_OUTLINE | SHADER_LOD_FADE);
+    shaders.request(SHADER_LIGHT_PROXY | SHADER_LOD_FADE);
+    // Импосторы: без лайтмапы, остальное как у мешей
+    for (unsigned light : lightBits) {
+        for (unsigned extras = 0; extras < 4; extras++) {
+            unsigned features = SHADER_LIT | SHADER_IMPOSTOR | light;
+            if (extras & 1) features |= SHADER_PROBES;
+            if (extras & 2) features |= SHADER_LOD_FADE;
+            requestInstanced(features);
+        }
+    }
+    for (unsigned fade : { 0u, (unsigned)SHADER_LOD_FADE }) {
+        requestInstanced(SHADER_DEPTH_ONLY | SHADER_IMPOSTOR | fade);
+        requestInstanced(SHADER_OUTLINE | SHADER_IMPOSTOR | fade);
+    }
+}
+
 // Update camera direction
 void updateCameraFront() {
     if (!cameraDirty) return;
@@ -990,7 +2086,8 @@ int main() {
         return -1;
     }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    // 4.3 ради compute-отсечения, иначе 3.3 с отсечением на CPU
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
@@ -1000,6 +2097,11 @@ int main() {
     windowHeight = mode->height;
 
     GLFWwindow* window = glfwCreateWindow(windowWidth, windowHeight, "GameEngine", NULL, NULL);
+    if (!window) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(windowWidth, windowHeight, "GameEngine", NULL, NULL);
+    }
     if (!window) {
         printf("GLFW window creation failed\n");
         glfwTerminate();
@@ -1030,8 +2132,43 @@ int main() {
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
 
-    shaderProgram = createShaderProgram("vertex.glsl", "fragment.glsl");
-    if (!shaderProgram) {
+    if (assetArchive.open(ASSET_ARCHIVE_PATH)) {
+        printf("Mounted %s (%zu assets)\n", ASSET_ARCHIVE_PATH, assetArchive.getEntryCount());
+        shaders.setArchive(&assetArchive);
+    }
+
+    programCache.init("shader_cache");
+    shaders.setBinaryCache(&programCache);
+
+    // Samplers and material constants are set once per linked variant
+    bool shadersLoaded = shaders.init("vertex.glsl", "fragment.glsl", [](ShaderVariant& variant) {
+        glUniform1i(variant.uniforms.material_diffuse, 0);
+        glUniform3f(variant.uniforms.material_specular, 0.5f, 0.5f, 0.5f);
+        glUniform1f(variant.uniforms.material_shininess, 32.0f);
+        glUniform1i(variant.uniforms.lightmap, 1);
+        for (int c = 0; c < 3; c++) {
+            glUniform1i(variant.uniforms.probeSH[c], 2 + c);
+        }
+        glUniform1i(variant.uniforms.impostorSurface, 5);
+        glUniform1i(variant.uniforms.impostorNormal, 6);
+        glUniform1i(variant.uniforms.impostorGrid, IMPOSTOR_GRID);
+        glUniform1i(variant.uniforms.instanceData, 7);
+        glUniform1i(variant.uniforms.selectionBits, SELECTION_BITS_TEXTURE_UNIT);
+    });
+    if (shadersLoaded) {
+        std::string cullSource;
+        if (GpuCuller::isSupported() && shaders.readSource("cull.glsl", cullSource, nullptr) && gpuCuller.init(cullSource, NUM_LODS)) {
+            printf("GPU culling enabled\n");
+            std::string pyramidSource;
+            if (shaders.readSource("depth_pyramid.glsl", pyramidSource, nullptr) && depthPyramid.init(pyramidSource)) {
+                printf("Occlusion culling enabled\n");
+            }
+        }
+        requestShaderVariants();
+        shaderWatcher.watch(shaders.getDependencies());
+    }
+    // Только базовый вариант нужен сразу, он же запасной для остальных освещённых
+    if (!shadersLoaded || !shaders.get(SHADER_LIT).program) {
         glfwDestroyWindow(window);
         glfwTerminate();
         return -1;
@@ -1040,56 +2177,74 @@ int main() {
     for (int i = 0; i < NUM_LODS; i++) {
         initCubeVBO(i);
     }
+    bakeImpostor(meshes[0]);
     initInstanceVBO();
+    initImpostorQuad();
     initGizmoVBO();
     initSphereVBO();
-    initMatrixUBO();
+    initUniformRing();
 
     // Добавляем один куб в сцену по умолчанию
     scene.addObject("Cube_1", glm::vec3(0.0f, 0.0f, 0.0f), glm::vec2(0.0f), 1.0f);
 
-    projection = glm::perspective(glm::radians(45.0f), (float)windowWidth / windowHeight, 0.1f, 100.0f);
-    glBindBuffer(GL_UNIFORM_BUFFER, matrixUBO);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(projection));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    projection = glm::perspective(glm::radians(CAMERA_FOV_DEGREES), (float)windowWidth / windowHeight, 0.1f, 100.0f);
 
-    GLuint texture = loadTexture("images.bmp");
-    if (!texture) {
-        printf("Failed to load texture\n");
-        glfwDestroyWindow(window);
-        glfwTerminate();
-        return -1;
-    }
+    textureStreamer.init(TEXTURE_UPLOAD_BYTES_PER_FRAME);
+    if (assetArchive.isOpen()) textureStreamer.setArchive(&assetArchive);
+    // Все материалы в одном массиве текстур: куб с любым материалом рисуется тем же инстанс-вызовом
+    materials.addMaterial("Default", "images.bmp", glm::vec3(1.0f));
+    materials.addMaterial("Warm", "images.bmp", glm::vec3(1.0f, 0.75f, 0.55f));
+    materials.addMaterial("Cool", "images.bmp", glm::vec3(0.6f, 0.8f, 1.0f));
+    materials.load(textureStreamer);
 
-    glUseProgram(shaderProgram);
-    glUniform1i(uniforms.material_diffuse, 0);
-    glUniform3f(uniforms.material_specular, 0.5f, 0.5f, 0.5f);
-    glUniform1f(uniforms.material_shininess, 32.0f);
 
     double lastTime = glfwGetTime();
+    std::vector<size_t> movedObjects; // Правки трансформаций за кадр, одним списком для всех потребителей
     while (!glfwWindowShouldClose(window)) {
+        // Правки шейдеров подхватываются без перезапуска; старая программа рисует, пока новая не слинкуется
+        if (hotReloadShaders && shaderWatcher.poll() && shaders.reload()) {
+            shaderWatcher.watch(shaders.getDependencies());
+        }
+        shaders.poll();
+        textureStreamer.update();
+
+        // Ожидание (ограничение FPS, очередь GPU) до опроса ввода: камера строится по самому свежему
+        applyVsyncMode();
+        framePacer.limit(frameRateLimit);
+        if (lowLatencyMode) framePacer.waitQueued(LOW_LATENCY_QUEUED_FRAMES);
+        glfwPollEvents();
+
         double currentTime = glfwGetTime();
         globalDeltaTime = currentTime - lastTime;
         globalTime = currentTime;
         lastTime = currentTime;
 
+        pollLightingBake();
+        pollProbeBake();
+        pollMeshImport();
+        processInput(window);
+        applySelectionTransform();
+        scene.takeMovedObjects(movedObjects);
+        if (pickIndexValid) {
+            pickMovedObjects.insert(pickMovedObjects.end(), movedObjects.begin(), movedObjects.end());
+            // Долгое перетаскивание без кликов не должно копить повторы
+            if (pickMovedObjects.size() > scene.getObjects().size()) {
+                std::sort(pickMovedObjects.begin(), pickMovedObjects.end());
+                pickMovedObjects.erase(std::unique(pickMovedObjects.begin(), pickMovedObjects.end()), pickMovedObjects.end());
+            }
+        }
         updateCameraFront();
+        // Тики по накопленному времени: движение не зависит ни от частоты кадров, ни от автоповтора клавиш
+        int ticks = simulationClock.advance(globalDeltaTime);
+        for (int tick = 0; tick < ticks; tick++) {
+            simulateTick(simulationClock.getStep());
+        }
+        updateRenderCamera(simulationClock.getAlpha());
         glm::mat4 view = glm::lookAt(
             glm::vec3(camPosX, camPosY, camPosZ),
             glm::vec3(camPosX, camPosY, camPosZ) + cameraFront,
             glm::vec3(0.0f, 1.0f, 0.0f)
         );
-        glBindBuffer(GL_UNIFORM_BUFFER, matrixUBO);
-        glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(view));
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glUseProgram(shaderProgram);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glUniform3f(uniforms.viewPos, camPosX, camPosY, camPosZ);
 
         glm::vec3 lightPosition(0.0f, 1.0f, 0.0f);
         glm::vec3 lightColor(1.0f, 1.0f, 1.0f);
@@ -1129,60 +2284,137 @@ int main() {
             lightType = 2;
         }
 
-        glUniform3f(uniforms.light_position, lightPosition.x, lightPosition.y, lightPosition.z);
-        glUniform3f(uniforms.light_color, lightColor.x, lightColor.y, lightColor.z);
-        glUniform1f(uniforms.light_ambientStrength, lightAmbientStrength);
-        glUniform3f(uniforms.light_direction, lightDirection.x, lightDirection.y, lightDirection.z);
-        glUniform1i(uniforms.light_type, lightType);
-
-        for (int i = 0; i < NUM_LODS; i++) {
-            drawObjects(i, false, false);
+        if (useProbes && updateProbesIncrementally) {
+            updateProbes();
         }
 
-        for (int i = 0; i < NUM_LODS; i++) {
-            drawObjects(i, true, false);
+        // Все покадровые константы пишутся в UBO один раз
+        FrameConstants frame;
+        frame.projection = projection;
+        frame.view = view;
+        frame.viewProjection = projection * view;
+        frame.viewPos = glm::vec3(camPosX, camPosY, camPosZ);
+        frame.time = globalTime;
+        frame.lightPosition = lightPosition;
+        frame.lightType = lightType;
+        frame.lightColor = lightColor;
+        frame.lightAmbientStrength = lightAmbientStrength;
+        frame.lightDirection = lightDirection;
+        frame.useProbes = useProbes && probeTextures[0] ? 1 : 0;
+        frame.probeGridOrigin = probeGrid.getOrigin();
+        frame.probeGridSpacing = probeGrid.getSpacing();
+        uploadFrameConstants(frame);
+
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textureStreamer.get(materials.getArrayTexture()));
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, lightmapTexture);
+        for (int c = 0; c < 3; c++) {
+            glActiveTexture(GL_TEXTURE2 + c);
+            glBindTexture(GL_TEXTURE_3D, probeTextures[c]);
         }
+        glActiveTexture(GL_TEXTURE0);
 
-        for (int i = 0; i < NUM_LODS; i++) {
-            drawObjects(i, false, true);
+        // Один выбор LOD на кадр для всех проходов
+        updateObjectLODs(globalDeltaTime);
+        packFrameInstances();
+        updateGpuCulling(projection * view, globalDeltaTime, movedObjects);
+        updateSelectionBits();
+        glActiveTexture(GL_TEXTURE7);
+        glBindTexture(GL_TEXTURE_BUFFER, gpuCuller.getInstanceDataTexture());
+        glActiveTexture(GL_TEXTURE0 + SELECTION_BITS_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, selectionBitsTexture);
+        glActiveTexture(GL_TEXTURE0);
+
+        bindPass(PASS_BASE);
+        if (gpuOcclusionActive()) {
+            // Фаза 1: глубина видимых в прошлом кадре, по ней пирамида; фаза 2: открывшиеся.
+            // Освещённый проход рисует обе фазы поверх готовой глубины.
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            bool drawn = drawGpuLists(SHADER_DEPTH_ONLY, 0, CULL_PHASE_EARLY);
+            depthPyramid.build(windowWidth, windowHeight);
+            gpuCuller.cullOccluded(makeCullParams(projection * view, globalDeltaTime), depthPyramid, projection * view);
+            drawGpuLists(SHADER_DEPTH_ONLY, 0, CULL_PHASE_LATE);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            if (drawn) glDepthFunc(GL_LEQUAL);
+        }
+        else if (depthPrepass) {
+            // Глубина заранее: дорогой освещённый проход затеняет только видимые фрагменты
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            if (drawAllLODs(SHADER_DEPTH_ONLY, 0, false)) {
+                glDepthFunc(GL_LEQUAL);
+            }
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
         }
 
-        for (const auto& obj : scene.getObjects()) {
-            if (obj.id == selectedObjectId) {
-                if (obj.type == CUBE) {
-                    drawGizmo(obj.position, CUBE);
-                }
-                else if (obj.type == POINT_LIGHT) {
-                    drawSphere(obj.position, obj.lightIntensity);
-                }
-                else if (obj.type == DIRECTIONAL_LIGHT) {
-                    drawGizmo(obj.position, DIRECTIONAL_LIGHT);
-                }
+        // Пока нужный вариант компилируется, рисуем базовым освещённым
+        drawAllLODs(litShaderFeatures(lightType), SHADER_LIT, false);
+        glDepthFunc(GL_LESS);
+
+        bindPass(PASS_OUTLINE);
+        drawAllLODs(SHADER_OUTLINE, 0, false);
+
+        bindPass(PASS_BASE);
+        drawAllLODs(SHADER_LIGHT_PROXY, 0, true);
+
+        const ShaderVariant* gizmoVariant = useShaderVariant(SHADER_GIZMO);
+
+        // Гизмо только у активного объекта, остальные выделенные — обводкой
+        const SceneObject* activeObject = scene.findObject(selection.getActive());
+        if (gizmoVariant && activeObject) {
+            const SceneObject& obj = *activeObject;
+            if (obj.type == CUBE) {
+                drawGizmo(*gizmoVariant, obj.position, CUBE);
+            }
+            else if (obj.type == POINT_LIGHT) {
+                drawSphere(*gizmoVariant, obj.position, obj.lightIntensity);
+            }
+            else if (obj.type == DIRECTIONAL_LIGHT) {
+                drawGizmo(*gizmoVariant, obj.position, DIRECTIONAL_LIGHT);
             }
         }
 
+        updateObjectIdPicking(window);
+
         drawImGui();
+        uniformRing.endFrame();
 
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        framePacer.endFrame();
     }
 
+    finishBackgroundWork();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
-    glDeleteVertexArrays(NUM_LODS, VAOs);
-    glDeleteBuffers(NUM_LODS, VBOs);
-    glDeleteBuffers(NUM_LODS, EBOs);
+    destroyMeshes();
     glDeleteBuffers(1, &instanceVBO);
+    glDeleteVertexArrays(1, &impostorVAO);
+    glDeleteBuffers(1, &impostorVBO);
+    glDeleteBuffers(1, &impostorEBO);
+    gpuCuller.destroy();
+    if (selectionBitsBuffer) glDeleteBuffers(1, &selectionBitsBuffer);
+    if (selectionBitsTexture) glDeleteTextures(1, &selectionBitsTexture);
+    depthPyramid.destroy();
+    objectIdBuffer.destroy();
     glDeleteVertexArrays(1, &gizmoVAO);
     glDeleteBuffers(1, &gizmoVBO);
     glDeleteBuffers(1, &gizmoEBO);
     glDeleteVertexArrays(1, &sphereVAO);
     glDeleteBuffers(1, &sphereVBO);
     glDeleteBuffers(1, &sphereEBO);
-    glDeleteProgram(shaderProgram);
-    glDeleteTextures(1, &texture);
+    uniformRing.destroy();
+    framePacer.destroy();
+    shaders.destroy();
+    shaderWatcher.destroy();
+    textureStreamer.destroy();
+    assetArchive.close();
+    if (lightmapTexture) glDeleteTextures(1, &lightmapTexture);
+    glDeleteTextures(3, probeTextures);
 
     glfwDestroyWindow(window);
     glfwTerminate();
@@ -0,0 +1,88 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstdio>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file. mmap where available, so parsers can tokenize straight out
+// of the page cache; on Windows the file is read once into memory instead.
+class MappedFile {
+private:
+    const unsigned char* base = nullptr;
+    size_t fileSize = 0;
+#ifdef _WIN32
+    std::vector<unsigned char> contents;
+#endif
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    // Fails for missing or empty files
+    bool open(const char* path) {
+        close();
+#ifdef _WIN32
+        FILE* file = fopen(path, "rb");
+        if (!file) return false;
+        unsigned char chunk[65536];
+        size_t read;
+        while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            contents.insert(contents.end(), chunk, chunk + read);
+        }
+        fclose(file);
+        if (contents.empty()) return false;
+        base = contents.data();
+        fileSize = contents.size();
+        return true;
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        void* mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) return false;
+        base = (const unsigned char*)mapping;
+        fileSize = (size_t)info.st_size;
+        return true;
+#endif
+    }
+
+    bool isOpen() const {
+        return base != nullptr;
+    }
+
+    const unsigned char* data() const {
+        return base;
+    }
+
+    size_t size() const {
+        return fileSize;
+    }
+
+    void close() {
+#ifdef _WIN32
+        contents.clear();
+#else
+        if (base) munmap((void*)base, fileSize);
+#endif
+        base = nullptr;
+        fileSize = 0;
+    }
+};
+
+#endif
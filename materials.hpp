@@ -0,0 +1,63 @@
+#ifndef MATERIALS_HPP
+#define MATERIALS_HPP
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include "texture_streamer.hpp"
+
+// Layer size of the shared diffuse array; other sizes are resampled when loaded
+#define MATERIAL_LAYER_SIZE 256
+
+struct Material {
+    std::string name;
+    int layer;      // Layer in the diffuse texture array
+    glm::vec3 tint; // Multiplied with the texture and the per-object tint
+};
+
+// All cube materials share one GL_TEXTURE_2D_ARRAY, so the material is just per-instance data
+// (layer + tint) and every LOD still draws in a single instanced call
+class MaterialLibrary {
+private:
+    std::vector<Material> materials;
+    std::vector<std::string> layerFiles;
+    int arrayTexture = -1;
+
+public:
+    // Materials using the same file share its layer. Returns the material id.
+    int addMaterial(const std::string& name, const std::string& texturePath, const glm::vec3& tint) {
+        int layer = -1;
+        for (size_t i = 0; i < layerFiles.size(); i++) {
+            if (layerFiles[i] == texturePath) layer = (int)i;
+        }
+        if (layer < 0) {
+            layer = (int)layerFiles.size();
+            layerFiles.push_back(texturePath);
+        }
+        materials.push_back({ name, layer, tint });
+        return (int)materials.size() - 1;
+    }
+
+    // Queues the texture array; call once after all materials are added
+    void load(TextureStreamer& streamer) {
+        arrayTexture = streamer.loadArray(layerFiles, MATERIAL_LAYER_SIZE, MATERIAL_LAYER_SIZE);
+    }
+
+    // Per-instance material attribute: (layer, tint.rgb). Unknown ids fall back to material 0.
+    glm::vec4 instanceData(int materialId, const glm::vec3& objectTint) const {
+        if (materials.empty()) return glm::vec4(0.0f, objectTint);
+        const Material& material = materials[materialId >= 0 && materialId < (int)materials.size() ? materialId : 0];
+        return glm::vec4((float)material.layer, material.tint * objectTint);
+    }
+
+    const std::vector<Material>& getMaterials() const {
+        return materials;
+    }
+
+    // Streamer id of the diffuse array
+    int getArrayTexture() const {
+        return arrayTexture;
+    }
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef MESH_DATA_HPP
+#define MESH_DATA_HPP
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Engine vertex layout, matches the cube VBOs: position (loc 0), texcoord (loc 1), normal (loc 2)
+struct MeshVertex {
+    float position[3];
+    float texCoord[2];
+    float normal[3];
+};
+
+// Coarser index buffer over the same vertices; error is the geometric deviation from the
+// full mesh in mesh units
+struct MeshLevel {
+    std::vector<uint32_t> indices;
+    float error = 0.0f;
+};
+
+// Indexed triangle list in engine layout, plus optional simplified levels (see mesh_simplify.hpp)
+struct MeshData {
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<MeshLevel> lods;
+};
+
+// Header of a cooked mesh blob. Followed by levelCount MeshBlobLevel records, the vertices,
+// the full-detail indices, then every level's indices in order.
+struct MeshBlobHeader {
+    uint32_t magic;
+    uint32_t vertexStride;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t levelCount;
+};
+
+struct MeshBlobLevel {
+    uint32_t indexCount;
+    float error;
+};
+
+static const uint32_t MESH_BLOB_MAGIC = 0x324D584E; // "NXM2"
+
+// Zero-copy view of a mesh blob, e.g. inside a mapped archive
+struct MeshView {
+    const MeshVertex* vertices = nullptr;
+    const uint32_t* indices = nullptr;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    const MeshBlobLevel* levels = nullptr;
+    uint32_t levelCount = 0;
+
+    const uint32_t* levelIndices(uint32_t level) const {
+        const uint32_t* result = indices + indexCount;
+        for (uint32_t i = 0; i < level; i++) result += levels[i].indexCount;
+        return result;
+    }
+};
+
+inline void writeMeshBlob(const MeshData& mesh, std::vector<unsigned char>& out) {
+    MeshBlobHeader header = { MESH_BLOB_MAGIC, (uint32_t)sizeof(MeshVertex), (uint32_t)mesh.vertices.size(), (uint32_t)mesh.indices.size(), (uint32_t)mesh.lods.size() };
+    const unsigned char* bytes = (const unsigned char*)&header;
+    out.insert(out.end(), bytes, bytes + sizeof(header));
+    for (const auto& lod : mesh.lods) {
+        MeshBlobLevel level = { (uint32_t)lod.indices.size(), lod.error };
+        bytes = (const unsigned char*)&level;
+        out.insert(out.end(), bytes, bytes + sizeof(level));
+    }
+    bytes = (const unsigned char*)mesh.vertices.data();
+    out.insert(out.end(), bytes, bytes + mesh.vertices.size() * sizeof(MeshVertex));
+    bytes = (const unsigned char*)mesh.indices.data();
+    out.insert(out.end(), bytes, bytes + mesh.indices.size() * sizeof(uint32_t));
+    for (const auto& lod : mesh.lods) {
+        bytes = (const unsigned char*)lod.indices.data();
+        out.insert(out.end(), bytes, bytes + lod.indices.size() * sizeof(uint32_t));
+    }
+}
+
+// Validates the whole blob before handing out a view: the level table, every index range and
+// every index against vertexCount, so a corrupt or truncated archive entry cannot make the
+// renderer read out of bounds. The index scan is linear in the blob size.
+inline bool readMeshBlob(const unsigned char* data, size_t size, MeshView& view) {
+    MeshBlobHeader header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != MESH_BLOB_MAGIC || header.vertexStride != sizeof(MeshVertex)) return false;
+    if (header.vertexCount == 0 || header.indexCount == 0 || header.indexCount % 3 != 0) return false;
+    size_t remaining = size - sizeof(header);
+    if (header.levelCount > remaining / sizeof(MeshBlobLevel)) return false;
+    size_t levelBytes = (size_t)header.levelCount * sizeof(MeshBlobLevel);
+    remaining -= levelBytes;
+    const MeshBlobLevel* levels = (const MeshBlobLevel*)(data + sizeof(header));
+    if (header.vertexCount > remaining / sizeof(MeshVertex)) return false;
+    remaining -= (size_t)header.vertexCount * sizeof(MeshVertex);
+    // Counts are checked one at a time against what is left, so the sum cannot overflow
+    size_t indexTotal = header.indexCount;
+    if (indexTotal > remaining / sizeof(uint32_t)) return false;
+    for (uint32_t i = 0; i < header.levelCount; i++) {
+        MeshBlobLevel level;
+        memcpy(&level, &levels[i], sizeof(level));
+        if (level.indexCount % 3 != 0 || !(level.error >= 0.0f)) return false;
+        if (level.indexCount > remaining / sizeof(uint32_t) - indexTotal) return false;
+        indexTotal += level.indexCount;
+    }
+    const unsigned char* indexData = data + sizeof(header) + levelBytes + (size_t)header.vertexCount * sizeof(MeshVertex);
+    uint32_t maxIndex = 0;
+    for (size_t i = 0; i < indexTotal; i++) {
+        uint32_t index;
+        memcpy(&index, indexData + i * sizeof(uint32_t), sizeof(index));
+        if (index > maxIndex) maxIndex = index;
+    }
+    if (maxIndex >= header.vertexCount) return false;
+
+    view.levels = levels;
+    view.levelCount = header.levelCount;
+    view.vertices = (const MeshVertex*)(data + sizeof(header) + levelBytes);
+    view.indices = (const uint32_t*)indexData;
+    view.vertexCount = header.vertexCount;
+    view.indexCount = header.indexCount;
+    return true;
+}
+
+#endif
@@ -0,0 +1,1038 @@
+#ifndef MESH_IMPORT_HPP
+#define MESH_IMPORT_HPP
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include <utility>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include "mapped_file.hpp"
+#include "mesh_data.hpp"
+
+// Streaming importers for Wavefront OBJ and glTF 2.0 (.gltf + .bin, or .glb). Input files are
+// memory-mapped and tokenized in place: no iostreams and no per-line strings. Results are welded
+// and reordered for the post-transform vertex cache and for linear vertex fetch, ready to upload
+// into the same layout as the cube. GL-free, so both the engine and nexyl-cook use it.
+
+// ---- Tokenizer ----
+
+inline void skipSpaces(const char*& p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+}
+
+inline void skipLine(const char*& p, const char* end) {
+    const char* newline = (const char*)memchr(p, '\n', end - p);
+    p = newline ? newline + 1 : end;
+}
+
+// Decimal number with optional sign, fraction and exponent. Exact enough for mesh data and an order
+// of magnitude faster than strtod, which also needs a terminated string we don't have.
+inline bool parseNumber(const char*& p, const char* end, double& value) {
+    static const double POWERS[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    const char* s = p;
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+')) negative = *s++ == '-';
+    uint64_t mantissa = 0;
+    int exponent = 0, digits = 0;
+    for (; s < end && *s >= '0' && *s <= '9'; s++, digits++) {
+        if (mantissa < 100000000000000000ull) mantissa = mantissa * 10 + (*s - '0');
+        else exponent++;
+    }
+    if (s < end && *s == '.') {
+        for (s++; s < end && *s >= '0' && *s <= '9'; s++, digits++) {
+            if (mantissa < 100000000000000000ull) {
+                mantissa = mantissa * 10 + (*s - '0');
+                exponent--;
+            }
+        }
+    }
+    if (digits == 0) return false;
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char* e = s + 1;
+        bool negativeExponent = false;
+        if (e < end && (*e == '-' || *e == '+')) negativeExponent = *e++ == '-';
+        if (e < end && *e >= '0' && *e <= '9') {
+            int explicitExponent = 0;
+            for (; e < end && *e >= '0' && *e <= '9'; e++) {
+                if (explicitExponent < 10000) explicitExponent = explicitExponent * 10 + (*e - '0');
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+            s = e;
+        }
+    }
+    double result = (double)mantissa;
+    if (exponent < 0) result = exponent >= -22 ? result / POWERS[-exponent] : result * pow(10.0, exponent);
+    else if (exponent > 0) result = exponent <= 22 ? result * POWERS[exponent] : result * pow(10.0, exponent);
+    value = negative ? -result : result;
+    p = s;
+    return true;
+}
+
+inline bool parseFloat(const char*& p, const char* end, float& value) {
+    double number;
+    if (!parseNumber(p, end, number)) return false;
+    value = (float)number;
+    return true;
+}
+
+inline bool parseInt(const char*& p, const char* end, int& value) {
+    const char* s = p;
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+')) negative = *s++ == '-';
+    if (s >= end || *s < '0' || *s > '9') return false;
+    int result = 0;
+    for (; s < end && *s >= '0' && *s <= '9'; s++) result = result * 10 + (*s - '0');
+    value = negative ? -result : result;
+    p = s;
+    return true;
+}
+
+// ---- Welding ----
+
+inline uint32_t hashVertexWords(const uint32_t* words, size_t count) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < count; i++) {
+        h = (h ^ words[i]) * 16777619u;
+        h ^= h >> 15;
+    }
+    return h;
+}
+
+// Merges bit-identical vertices and rewrites the indices
+inline void weldVertices(MeshData& mesh) {
+    size_t capacity = 64;
+    while (capacity < mesh.vertices.size() * 2) capacity *= 2;
+    std::vector<uint32_t> table(capacity, UINT32_MAX);
+    std::vector<uint32_t> remap(mesh.vertices.size());
+    std::vector<MeshVertex> unique;
+    unique.reserve(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        uint32_t words[sizeof(MeshVertex) / 4];
+        memcpy(words, &mesh.vertices[i], sizeof(words));
+        size_t slot = hashVertexWords(words, sizeof(words) / 4) & (capacity - 1);
+        while (table[slot] != UINT32_MAX && memcmp(&unique[table[slot]], &mesh.vertices[i], sizeof(MeshVertex)) != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (table[slot] == UINT32_MAX) {
+            table[slot] = (uint32_t)unique.size();
+            unique.push_back(mesh.vertices[i]);
+        }
+        remap[i] = table[slot];
+    }
+    for (auto& index : mesh.indices) index = remap[index];
+    mesh.vertices.swap(unique);
+}
+
+// Area-weighted smooth normals for the vertices that have none (all zero), from the triangles
+// that use them. Sources may give normals for only part of a mesh (OBJ faces without vn, glTF
+// primitives without NORMAL); the vertices that have them are left as they are.
+inline void computeMissingNormals(MeshData& mesh) {
+    std::vector<unsigned char> missing(mesh.vertices.size(), 0);
+    bool anyMissing = false;
+    for (size_t v = 0; v < mesh.vertices.size(); v++) {
+        const float* n = mesh.vertices[v].normal;
+        if (n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f) missing[v] = anyMissing = true;
+    }
+    if (!anyMissing) return;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        uint32_t ia = mesh.indices[i], ib = mesh.indices[i + 1], ic = mesh.indices[i + 2];
+        if (!missing[ia] && !missing[ib] && !missing[ic]) continue;
+        MeshVertex& a = mesh.vertices[ia];
+        MeshVertex& b = mesh.vertices[ib];
+        MeshVertex& c = mesh.vertices[ic];
+        float e1[3] = { b.position[0] - a.position[0], b.position[1] - a.position[1], b.position[2] - a.position[2] };
+        float e2[3] = { c.position[0] - a.position[0], c.position[1] - a.position[1], c.position[2] - a.position[2] };
+        float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        for (int k = 0; k < 3; k++) {
+            if (missing[ia]) a.normal[k] += n[k];
+            if (missing[ib]) b.normal[k] += n[k];
+            if (missing[ic]) c.normal[k] += n[k];
+        }
+    }
+    for (size_t v = 0; v < mesh.vertices.size(); v++) {
+        if (!missing[v]) continue;
+        float* normal = mesh.vertices[v].normal;
+        float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length > 0.0f) {
+            for (int k = 0; k < 3; k++) normal[k] /= length;
+        }
+    }
+}
+
+// ---- Optimization ----
+
+// Tipsify (Sander et al. 2007): reorders triangles so consecutive ones reuse vertices still in a
+// post-transform cache of cacheSize entries. Linear time, which matters at millions of triangles.
+inline void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = 16) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0) return;
+
+    // Vertex -> triangles adjacency as one flat array (counting sort)
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (uint32_t index : indices) offsets[index + 1]++;
+    for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) live[v] = offsets[v + 1] - offsets[v];
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    uint32_t timestamp = (uint32_t)cacheSize + 1;
+    size_t cursor = 0;
+
+    auto skipDeadEnd = [&]() -> int64_t {
+        while (!deadEnd.empty()) {
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) return v;
+        }
+        for (; cursor < vertexCount; cursor++) {
+            if (live[cursor] > 0) return (int64_t)cursor;
+        }
+        return -1;
+    };
+
+    int64_t fan = skipDeadEnd();
+    while (fan >= 0) {
+        candidates.clear();
+        for (uint32_t k = offsets[fan]; k < offsets[fan + 1]; k++) {
+            uint32_t triangle = adjacency[k];
+            if (emitted[triangle]) continue;
+            emitted[triangle] = 1;
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t v = indices[triangle * 3 + corner];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (timestamp - cacheTime[v] > (uint32_t)cacheSize) cacheTime[v] = timestamp++;
+            }
+        }
+        // Next fan: the candidate that will still be in cache after its remaining triangles
+        int64_t best = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) continue;
+            int64_t priority = 0;
+            if ((int64_t)timestamp - cacheTime[v] + 2 * (int64_t)live[v] <= cacheSize) priority = timestamp - cacheTime[v];
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = v;
+            }
+        }
+        fan = best >= 0 ? best : skipDeadEnd();
+    }
+    indices.swap(result);
+}
+
+// Renumbers vertices in order of first use so fetches walk the vertex buffer linearly;
+// unreferenced vertices are dropped
+inline void optimizeVertexFetch(MeshData& mesh) {
+    std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+    std::vector<MeshVertex> ordered;
+    ordered.reserve(mesh.vertices.size());
+    for (auto& index : mesh.indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = (uint32_t)ordered.size();
+            ordered.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(ordered);
+}
+
+// Average cache misses per triangle for a FIFO cache; 0.5 is ideal for regular grids, 3 is no reuse
+inline float computeACMR(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = 16) {
+    if (indices.empty()) return 0.0f;
+    std::vector<uint32_t> insertedAt(vertexCount, 0);
+    uint32_t time = (uint32_t)cacheSize + 1, misses = 0;
+    for (uint32_t index : indices) {
+        if (time - insertedAt[index] > (uint32_t)cacheSize) {
+            insertedAt[index] = time++;
+            misses++;
+        }
+    }
+    return (float)misses / (indices.size() / 3);
+}
+
+// ---- OBJ ----
+
+// v/vt/vn triplet -> welded vertex. Corners are chained per position index rather than hashed:
+// faces reference positions close to each other in the file, so lookups stay in cache, where a
+// hash table would miss on nearly every corner of a multi-million triangle mesh.
+class CornerTable {
+private:
+    std::vector<uint32_t> firstVertex; // Per position
+    std::vector<uint32_t> nextVertex;  // Per vertex, same position
+    std::vector<int> texCoords, normals;
+
+public:
+    void reserve(size_t vertices) {
+        nextVertex.reserve(vertices);
+        texCoords.reserve(vertices);
+        normals.reserve(vertices);
+    }
+
+    // Returns the existing vertex, or registers the next vertex index (inserted = true)
+    uint32_t findOrInsert(int position, int texCoord, int normal, bool& inserted) {
+        if ((size_t)position >= firstVertex.size()) firstVertex.resize((size_t)position + 1 + firstVertex.size() / 2, UINT32_MAX);
+        for (uint32_t vertex = firstVertex[position]; vertex != UINT32_MAX; vertex = nextVertex[vertex]) {
+            if (texCoords[vertex] == texCoord && normals[vertex] == normal) {
+                inserted = false;
+                return vertex;
+            }
+        }
+        uint32_t vertex = (uint32_t)nextVertex.size();
+        nextVertex.push_back(firstVertex[position]);
+        texCoords.push_back(texCoord);
+        normals.push_back(normal);
+        firstVertex[position] = vertex;
+        inserted = true;
+        return vertex;
+    }
+};
+
+enum ObjStatement { OBJ_OTHER, OBJ_POSITION, OBJ_TEXCOORD, OBJ_NORMAL, OBJ_FACE };
+
+// Classifies the line at p and moves past the keyword
+inline ObjStatement objStatement(const char*& p, const char* end) {
+    skipSpaces(p, end);
+    if (p + 1 < end && p[0] == 'v') {
+        if (p[1] == ' ' || p[1] == '\t') { p += 2; return OBJ_POSITION; }
+        if (p + 2 < end && (p[2] == ' ' || p[2] == '\t')) {
+            if (p[1] == 't') { p += 3; return OBJ_TEXCOORD; }
+            if (p[1] == 'n') { p += 3; return OBJ_NORMAL; }
+        }
+    } else if (p + 1 < end && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+        p += 2;
+        return OBJ_FACE;
+    }
+    return OBJ_OTHER;
+}
+
+// Line-aligned slice of an OBJ file. A counting pass gives every chunk its global element offsets,
+// so chunks then parse in parallel straight into the shared attribute arrays.
+struct ObjChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    size_t positionCount = 0, texCoordCount = 0, normalCount = 0, lineCount = 0; // Within the chunk
+    size_t positionBase = 0, texCoordBase = 0, normalBase = 0, lineBase = 0;     // Before the chunk
+    std::vector<int> corners;            // 0-based position, texCoord, normal; -1 when absent
+    std::vector<uint32_t> polygonSizes;
+    size_t errorLine = 0;                // Global line number of the first bad face, 0 if none
+};
+
+inline void countObjChunk(ObjChunk& chunk) {
+    for (const char* p = chunk.begin; p < chunk.end; skipLine(p, chunk.end)) {
+        chunk.lineCount++;
+        switch (objStatement(p, chunk.end)) {
+        case OBJ_POSITION: chunk.positionCount++; break;
+        case OBJ_TEXCOORD: chunk.texCoordCount++; break;
+        case OBJ_NORMAL: chunk.normalCount++; break;
+        default: break;
+        }
+    }
+}
+
+inline void parseObjChunk(ObjChunk& chunk, float* positions, float* texCoords, float* normals,
+                          size_t positionTotal, size_t texCoordTotal, size_t normalTotal) {
+    size_t position = chunk.positionBase, texCoord = chunk.texCoordBase, normal = chunk.normalBase;
+    size_t line = chunk.lineBase;
+    chunk.corners.reserve((chunk.end - chunk.begin) / 8);
+    chunk.polygonSizes.reserve((chunk.end - chunk.begin) / 40);
+    const char* end = chunk.end;
+    for (const char* p = chunk.begin; p < end; skipLine(p, end)) {
+        line++;
+        switch (objStatement(p, end)) {
+        case OBJ_POSITION:
+            for (int k = 0; k < 3; k++) {
+                skipSpaces(p, end);
+                if (!parseFloat(p, end, positions[position * 3 + k])) positions[position * 3 + k] = 0.0f;
+            }
+            position++;
+            break;
+        case OBJ_TEXCOORD:
+            for (int k = 0; k < 2; k++) {
+                skipSpaces(p, end);
+                if (!parseFloat(p, end, texCoords[texCoord * 2 + k])) texCoords[texCoord * 2 + k] = 0.0f;
+            }
+            texCoord++;
+            break;
+        case OBJ_NORMAL:
+            for (int k = 0; k < 3; k++) {
+                skipSpaces(p, end);
+                if (!parseFloat(p, end, normals[normal * 3 + k])) normals[normal * 3 + k] = 0.0f;
+            }
+            normal++;
+            break;
+        case OBJ_FACE: {
+            uint32_t cornerCount = 0;
+            for (;;) {
+                skipSpaces(p, end);
+                int v = 0, vt = 0, vn = 0;
+                if (!parseInt(p, end, v)) break;
+                if (p < end && *p == '/') {
+                    p++;
+                    parseInt(p, end, vt); // Empty in "v//vn"
+                    if (p < end && *p == '/') {
+                        p++;
+                        parseInt(p, end, vn);
+                    }
+                }
+                // 1-based, negative counts back from the latest element
+                int64_t resolved[3] = {
+                    v < 0 ? (int64_t)position + v : (int64_t)v - 1,
+                    vt < 0 ? (int64_t)texCoord + vt : (int64_t)vt - 1,
+                    vn < 0 ? (int64_t)normal + vn : (int64_t)vn - 1
+                };
+                if (resolved[0] < 0 || resolved[0] >= (int64_t)positionTotal || resolved[1] >= (int64_t)texCoordTotal ||
+                    resolved[2] >= (int64_t)normalTotal || (vt < 0 && resolved[1] < 0) || (vn < 0 && resolved[2] < 0)) {
+                    if (!chunk.errorLine) chunk.errorLine = line;
+                    break;
+                }
+                chunk.corners.push_back((int)resolved[0]);
+                chunk.corners.push_back((int)resolved[1]);
+                chunk.corners.push_back((int)resolved[2]);
+                cornerCount++;
+            }
+            chunk.polygonSizes.push_back(cornerCount);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+// v/vt/vn/f statements; polygons are fan-triangulated, everything else (groups, materials,
+// smoothing groups, lines) is skipped. Corners with the same v/vt/vn triplet share a vertex.
+// threadCount 0 = hardware_concurrency; welding is serial so vertex order stays deterministic.
+inline bool importOBJ(const char* path, MeshData& mesh, int threadCount = 0) {
+    MappedFile file;
+    if (!file.open(path)) {
+        printf("Failed to open mesh file: %s\n", path);
+        return false;
+    }
+    const char* text = (const char*)file.data();
+    const char* textEnd = text + file.size();
+
+    // Chunks of at least 1 MB, cut after a newline
+    if (threadCount <= 0) threadCount = (int)std::thread::hardware_concurrency();
+    if (threadCount < 1) threadCount = 1;
+    size_t chunkCount = file.size() / (1 << 20) + 1;
+    if (chunkCount > (size_t)threadCount * 4) chunkCount = (size_t)threadCount * 4;
+    std::vector<ObjChunk> chunks;
+    const char* begin = text;
+    for (size_t i = 1; i <= chunkCount && begin < textEnd; i++) {
+        const char* end = i == chunkCount ? textEnd : text + file.size() / chunkCount * i;
+        if (end < begin) end = begin;
+        skipLine(end, textEnd);
+        if (i == chunkCount) end = textEnd;
+        chunks.emplace_back();
+        chunks.back().begin = begin;
+        chunks.back().end = end;
+        begin = end;
+    }
+
+    auto runChunks = [&](auto&& job) {
+        std::atomic<size_t> next(0);
+        auto worker = [&]() {
+            for (size_t i = next.fetch_add(1); i < chunks.size(); i = next.fetch_add(1)) job(chunks[i]);
+        };
+        std::vector<std::thread> threads;
+        for (int i = 1; i < threadCount && (size_t)i < chunks.size(); i++) threads.emplace_back(worker);
+        worker();
+        for (auto& t : threads) t.join();
+    };
+
+    runChunks([](ObjChunk& chunk) { countObjChunk(chunk); });
+    size_t positionTotal = 0, texCoordTotal = 0, normalTotal = 0, lineTotal = 0;
+    for (auto& chunk : chunks) {
+        chunk.positionBase = positionTotal;
+        chunk.texCoordBase = texCoordTotal;
+        chunk.normalBase = normalTotal;
+        chunk.lineBase = lineTotal;
+        positionTotal += chunk.positionCount;
+        texCoordTotal += chunk.texCoordCount;
+        normalTotal += chunk.normalCount;
+        lineTotal += chunk.lineCount;
+    }
+    if (positionTotal > (size_t)INT32_MAX || texCoordTotal > (size_t)INT32_MAX || normalTotal > (size_t)INT32_MAX) {
+        printf("Mesh file too large: %s\n", path);
+        return false;
+    }
+    std::vector<float> positions(positionTotal * 3), texCoords(texCoordTotal * 2), normals(normalTotal * 3);
+    runChunks([&](ObjChunk& chunk) {
+        parseObjChunk(chunk, positions.data(), texCoords.data(), normals.data(), positionTotal, texCoordTotal, normalTotal);
+    });
+
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    mesh.vertices.reserve(positionTotal + positionTotal / 4);
+    CornerTable corners;
+    corners.reserve(positionTotal + positionTotal / 4);
+    std::vector<uint32_t> polygon;
+    for (auto& chunk : chunks) {
+        if (chunk.errorLine) {
+            printf("Invalid face index in %s at line %zu\n", path, chunk.errorLine);
+            return false;
+        }
+        const int* corner = chunk.corners.data();
+        for (uint32_t size : chunk.polygonSizes) {
+            polygon.clear();
+            for (uint32_t c = 0; c < size; c++, corner += 3) {
+                bool inserted;
+                uint32_t index = corners.findOrInsert(corner[0], corner[1], corner[2], inserted);
+                if (inserted) {
+                    MeshVertex vertex = {};
+                    memcpy(vertex.position, &positions[(size_t)corner[0] * 3], sizeof(vertex.position));
+                    if (corner[1] >= 0) memcpy(vertex.texCoord, &texCoords[(size_t)corner[1] * 2], sizeof(vertex.texCoord));
+                    if (corner[2] >= 0) memcpy(vertex.normal, &normals[(size_t)corner[2] * 3], sizeof(vertex.normal));
+                    mesh.vertices.push_back(vertex);
+                }
+                polygon.push_back(index);
+            }
+            for (size_t i = 2; i < polygon.size(); i++) {
+                mesh.indices.push_back(polygon[0]);
+                mesh.indices.push_back(polygon[i - 1]);
+                mesh.indices.push_back(polygon[i]);
+            }
+        }
+        // Release each chunk's corners as soon as they are welded
+        std::vector<int>().swap(chunk.corners);
+    }
+    if (mesh.indices.empty()) {
+        printf("No triangles in mesh file: %s\n", path);
+        return false;
+    }
+    computeMissingNormals(mesh);
+    return true;
+}
+
+// ---- glTF ----
+
+// Minimal JSON DOM for glTF manifests. Strings are views into the source text and keep their
+// escapes, which glTF keys and URIs practically never use.
+struct JsonValue {
+    enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+    Type type = JSON_NULL;
+    double number = 0.0;
+    std::string_view string;
+    std::vector<std::string_view> keys; // Objects only, parallel to items
+    std::vector<JsonValue> items;
+
+    const JsonValue* get(std::string_view key) const {
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == key) return &items[i];
+        }
+        return nullptr;
+    }
+
+    const JsonValue* at(size_t index) const {
+        return type == JSON_ARRAY && index < items.size() ? &items[index] : nullptr;
+    }
+
+    double getNumber(std::string_view key, double fallback) const {
+        const JsonValue* value = get(key);
+        return value && value->type == JSON_NUMBER ? value->number : fallback;
+    }
+
+    std::string_view getString(std::string_view key) const {
+        const JsonValue* value = get(key);
+        return value && value->type == JSON_STRING ? value->string : std::string_view();
+    }
+};
+
+class JsonParser {
+private:
+    const char* p;
+    const char* end;
+    int depth = 0;
+
+    void skipWhitespace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    }
+
+    bool parseString(std::string_view& out) {
+        if (p >= end || *p != '"') return false;
+        const char* start = ++p;
+        while (p < end && *p != '"') p += *p == '\\' ? 2 : 1;
+        if (p >= end) return false;
+        out = std::string_view(start, p - start);
+        p++;
+        return true;
+    }
+
+public:
+    JsonParser(const char* text, size_t size) : p(text), end(text + size) {}
+
+    bool parse(JsonValue& value) {
+        if (++depth > 64) return false;
+        skipWhitespace();
+        if (p >= end) return false;
+        bool ok = true;
+        if (*p == '{') {
+            value.type = JsonValue::JSON_OBJECT;
+            p++;
+            skipWhitespace();
+            if (p < end && *p == '}') {
+                p++;
+            } else {
+                for (;;) {
+                    skipWhitespace();
+                    std::string_view key;
+                    if (!parseString(key)) { ok = false; break; }
+                    skipWhitespace();
+                    if (p >= end || *p != ':') { ok = false; break; }
+                    p++;
+                    value.keys.push_back(key);
+                    value.items.emplace_back();
+                    if (!parse(value.items.back())) { ok = false; break; }
+                    skipWhitespace();
+                    if (p < end && *p == ',') { p++; continue; }
+                    if (p < end && *p == '}') { p++; break; }
+                    ok = false;
+                    break;
+                }
+            }
+        } else if (*p == '[') {
+            value.type = JsonValue::JSON_ARRAY;
+            p++;
+            skipWhitespace();
+            if (p < end && *p == ']') {
+                p++;
+            } else {
+                for (;;) {
+                    value.items.emplace_back();
+                    if (!parse(value.items.back())) { ok = false; break; }
+                    skipWhitespace();
+                    if (p < end && *p == ',') { p++; continue; }
+                    if (p < end && *p == ']') { p++; break; }
+                    ok = false;
+                    break;
+                }
+            }
+        } else if (*p == '"') {
+            value.type = JsonValue::JSON_STRING;
+            ok = parseString(value.string);
+        } else if (end - p >= 4 && memcmp(p, "true", 4) == 0) {
+            value.type = JsonValue::JSON_BOOL;
+            value.number = 1.0;
+            p += 4;
+        } else if (end - p >= 5 && memcmp(p, "false", 5) == 0) {
+            value.type = JsonValue::JSON_BOOL;
+            p += 5;
+        } else if (end - p >= 4 && memcmp(p, "null", 4) == 0) {
+            p += 4;
+        } else {
+            value.type = JsonValue::JSON_NUMBER;
+            ok = parseNumber(p, end, value.number);
+        }
+        depth--;
+        return ok;
+    }
+};
+
+inline bool decodeBase64(std::string_view text, std::vector<unsigned char>& out) {
+    auto sextet = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+' || c == '-') return 62;
+        if (c == '/' || c == '_') return 63;
+        return -1;
+    };
+    out.clear();
+    out.reserve(text.size() / 4 * 3);
+    uint32_t bits = 0;
+    int bitCount = 0;
+    for (char c : text) {
+        if (c == '=') break;
+        int value = sextet(c);
+        if (value < 0) return false;
+        bits = (bits << 6) | (uint32_t)value;
+        bitCount += 6;
+        if (bitCount >= 8) {
+            bitCount -= 8;
+            out.push_back((unsigned char)(bits >> bitCount));
+        }
+    }
+    return true;
+}
+
+// Column-major 4x4, as glTF stores node matrices
+struct GltfMatrix {
+    float m[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+    GltfMatrix operator*(const GltfMatrix& other) const {
+        GltfMatrix result;
+        for (int column = 0; column < 4; column++) {
+            for (int row = 0; row < 4; row++) {
+                float sum = 0.0f;
+                for (int k = 0; k < 4; k++) sum += m[k * 4 + row] * other.m[column * 4 + k];
+                result.m[column * 4 + row] = sum;
+            }
+        }
+        return result;
+    }
+};
+
+class GltfImporter {
+private:
+    struct Buffer {
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+    };
+
+    const char* path;
+    std::string directory;
+    JsonValue root;
+    std::vector<Buffer> buffers;
+    std::vector<std::unique_ptr<MappedFile>> mappedBuffers;
+    std::vector<std::vector<unsigned char>> decodedBuffers;
+    MeshData& mesh;
+
+    static int componentSize(int componentType) {
+        switch (componentType) {
+        case 5120: case 5121: return 1; // BYTE, UNSIGNED_BYTE
+        case 5122: case 5123: return 2; // SHORT, UNSIGNED_SHORT
+        case 5125: case 5126: return 4; // UNSIGNED_INT, FLOAT
+        default: return 0;
+        }
+    }
+
+    static int typeComponents(std::string_view type) {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        return 0;
+    }
+
+    static float readComponent(const unsigned char* source, int componentType, bool normalized) {
+        switch (componentType) {
+        case 5126: { float v; memcpy(&v, source, 4); return v; }
+        case 5125: { uint32_t v; memcpy(&v, source, 4); return (float)v; }
+        case 5123: { uint16_t v; memcpy(&v, source, 2); return normalized ? v / 65535.0f : (float)v; }
+        case 5122: { int16_t v; memcpy(&v, source, 2); return normalized ? fmaxf(v / 32767.0f, -1.0f) : (float)v; }
+        case 5121: return normalized ? source[0] / 255.0f : (float)source[0];
+        case 5120: return normalized ? fmaxf((int8_t)source[0] / 127.0f, -1.0f) : (float)(int8_t)source[0];
+        default: return 0.0f;
+        }
+    }
+
+    struct AccessorView {
+        const unsigned char* data = nullptr;
+        size_t count = 0;
+        size_t stride = 0;
+        int componentType = 0;
+        int components = 0;
+        bool normalized = false;
+    };
+
+    // Resolves an accessor to a strided view into its buffer, with bounds checks
+    bool resolveAccessor(int index, AccessorView& view) const {
+        const JsonValue* accessors = root.get("accessors");
+        const JsonValue* accessor = accessors ? accessors->at(index) : nullptr;
+        if (!accessor) return false;
+        view.count = (size_t)accessor->getNumber("count", 0);
+        view.componentType = (int)accessor->getNumber("componentType", 0);
+        view.components = typeComponents(accessor->getString("type"));
+        const JsonValue* normalized = accessor->get("normalized");
+        view.normalized = normalized && normalized->number != 0.0;
+        int elementSize = componentSize(view.componentType) * view.components;
+        if (elementSize == 0) return false;
+        const JsonValue* bufferViews = root.get("bufferViews");
+        const JsonValue* bufferView = bufferViews ? bufferViews->at((size_t)accessor->getNumber("bufferView", -1)) : nullptr;
+        if (!bufferView) return false; // Sparse-only accessors are not supported
+        size_t bufferIndex = (size_t)bufferView->getNumber("buffer", -1);
+        if (bufferIndex >= buffers.size()) return false;
+        const Buffer& buffer = buffers[bufferIndex];
+        size_t offset = (size_t)bufferView->getNumber("byteOffset", 0) + (size_t)accessor->getNumber("byteOffset", 0);
+        size_t viewLength = (size_t)bufferView->getNumber("byteLength", 0);
+        view.stride = (size_t)bufferView->getNumber("byteStride", 0);
+        if (view.stride == 0) view.stride = elementSize;
+        size_t span = view.count ? (view.count - 1) * view.stride + elementSize : 0;
+        size_t viewEnd = (size_t)bufferView->getNumber("byteOffset", 0) + viewLength;
+        if (offset + span > viewEnd || viewEnd > buffer.size) return false;
+        view.data = buffer.data + offset;
+        return true;
+    }
+
+    bool loadBuffers(const unsigned char* glbChunk, size_t glbChunkSize) {
+        const JsonValue* list = root.get("buffers");
+        if (!list) return true;
+        for (const auto& entry : list->items) {
+            std::string_view uri = entry.getString("uri");
+            Buffer buffer;
+            if (uri.empty()) {
+                // The GLB binary chunk
+                buffer.data = glbChunk;
+                buffer.size = glbChunkSize;
+            } else if (uri.substr(0, 5) == "data:") {
+                size_t comma = uri.find(',');
+                decodedBuffers.emplace_back();
+                if (comma == std::string_view::npos || !decodeBase64(uri.substr(comma + 1), decodedBuffers.back())) {
+                    printf("Invalid data URI in %s\n", path);
+                    return false;
+                }
+                buffer.data = decodedBuffers.back().data();
+                buffer.size = decodedBuffers.back().size();
+            } else {
+                std::string bufferPath = directory + std::string(uri);
+                mappedBuffers.push_back(std::make_unique<MappedFile>());
+                if (!mappedBuffers.back()->open(bufferPath.c_str())) {
+                    printf("Failed to open glTF buffer: %s\n", bufferPath.c_str());
+                    return false;
+                }
+                buffer.data = mappedBuffers.back()->data();
+                buffer.size = mappedBuffers.back()->size();
+            }
+            if (buffer.size < (size_t)entry.getNumber("byteLength", 0)) {
+                printf("glTF buffer shorter than declared in %s\n", path);
+                return false;
+            }
+            buffers.push_back(buffer);
+        }
+        return true;
+    }
+
+    bool importPrimitive(const JsonValue& primitive, const GltfMatrix& transform) {
+        if ((int)primitive.getNumber("mode", 4) != 4) return true; // Only triangle lists
+        const JsonValue* attributes = primitive.get("attributes");
+        AccessorView positions, normals, texCoords;
+        if (!attributes || !resolveAccessor((int)attributes->getNumber("POSITION", -1), positions) || positions.components != 3) {
+            printf("glTF primitive without usable POSITION in %s\n", path);
+            return false;
+        }
+        bool hasNormals = resolveAccessor((int)attributes->getNumber("NORMAL", -1), normals) && normals.count == positions.count;
+        bool hasTexCoords = resolveAccessor((int)attributes->getNumber("TEXCOORD_0", -1), texCoords) && texCoords.count == positions.count;
+
+        // Normals take the inverse transpose; the cofactor matrix is that up to scale
+        const float* m = transform.m;
+        float normalMatrix[9] = { // Row-major
+            m[5] * m[10] - m[9] * m[6], m[9] * m[2] - m[1] * m[10], m[1] * m[6] - m[5] * m[2],
+            m[8] * m[6] - m[4] * m[10], m[0] * m[10] - m[8] * m[2], m[4] * m[2] - m[0] * m[6],
+            m[4] * m[9] - m[8] * m[5], m[8] * m[1] - m[0] * m[9], m[0] * m[5] - m[4] * m[1]
+        };
+        uint32_t base = (uint32_t)mesh.vertices.size();
+        for (size_t i = 0; i < positions.count; i++) {
+            MeshVertex vertex = {};
+            float p[3];
+            for (int k = 0; k < 3; k++) p[k] = readComponent(positions.data + i * positions.stride + k * componentSize(positions.componentType), positions.componentType, positions.normalized);
+            for (int row = 0; row < 3; row++) {
+                vertex.position[row] = m[row] * p[0] + m[4 + row] * p[1] + m[8 + row] * p[2] + m[12 + row];
+            }
+            if (hasNormals) {
+                float n[3];
+                for (int k = 0; k < 3; k++) n[k] = readComponent(normals.data + i * normals.stride + k * componentSize(normals.componentType), normals.componentType, normals.normalized);
+                float length = 0.0f;
+                for (int row = 0; row < 3; row++) {
+                    vertex.normal[row] = normalMatrix[row * 3] * n[0] + normalMatrix[row * 3 + 1] * n[1] + normalMatrix[row * 3 + 2] * n[2];
+                    length += vertex.normal[row] * vertex.normal[row];
+                }
+                if (length > 0.0f) {
+                    length = sqrtf(length);
+                    for (int row = 0; row < 3; row++) vertex.normal[row] /= length;
+                }
+            }
+            if (hasTexCoords) {
+                for (int k = 0; k < 2; k++) vertex.texCoord[k] = readComponent(texCoords.data + i * texCoords.stride + k * componentSize(texCoords.componentType), texCoords.componentType, texCoords.normalized);
+                vertex.texCoord[1] = 1.0f - vertex.texCoord[1]; // glTF UV origin is top-left
+            }
+            mesh.vertices.push_back(vertex);
+        }
+
+        size_t firstIndex = mesh.indices.size();
+        AccessorView indices;
+        if (primitive.get("indices")) {
+            if (!resolveAccessor((int)primitive.getNumber("indices", -1), indices) || indices.components != 1) {
+                printf("Invalid glTF index accessor in %s\n", path);
+                return false;
+            }
+            for (size_t i = 0; i < indices.count; i++) {
+                uint32_t index = (uint32_t)readComponent(indices.data + i * indices.stride, indices.componentType, false);
+                if (index >= positions.count) {
+                    printf("glTF index out of range in %s\n", path);
+                    return false;
+                }
+                mesh.indices.push_back(base + index);
+            }
+        } else {
+            for (size_t i = 0; i < positions.count; i++) mesh.indices.push_back(base + (uint32_t)i);
+        }
+        mesh.indices.resize(firstIndex + (mesh.indices.size() - firstIndex) / 3 * 3);
+
+        // A negative determinant mirrors the mesh, which flips the winding
+        float determinant = m[0] * normalMatrix[0] + m[4] * normalMatrix[1] + m[8] * normalMatrix[2];
+        if (determinant < 0.0f) {
+            for (size_t i = firstIndex; i < mesh.indices.size(); i += 3) std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+        }
+        return true;
+    }
+
+    bool importMesh(int index, const GltfMatrix& transform) {
+        const JsonValue* meshes = root.get("meshes");
+        const JsonValue* gltfMesh = meshes ? meshes->at(index) : nullptr;
+        const JsonValue* primitives = gltfMesh ? gltfMesh->get("primitives") : nullptr;
+        if (!primitives) return false;
+        for (const auto& primitive : primitives->items) {
+            if (!importPrimitive(primitive, transform)) return false;
+        }
+        return true;
+    }
+
+    bool importNode(int index, const GltfMatrix& parent, int depth) {
+        const JsonValue* nodes = root.get("nodes");
+        const JsonValue* node = nodes ? nodes->at(index) : nullptr;
+        if (!node || depth > 64) return false;
+        GltfMatrix local;
+        if (const JsonValue* matrix = node->get("matrix")) {
+            for (size_t i = 0; i < 16 && i < matrix->items.size(); i++) local.m[i] = (float)matrix->items[i].number;
+        } else {
+            float t[3] = { 0, 0, 0 }, r[4] = { 0, 0, 0, 1 }, s[3] = { 1, 1, 1 };
+            if (const JsonValue* value = node->get("translation")) for (size_t i = 0; i < 3 && i < value->items.size(); i++) t[i] = (float)value->items[i].number;
+            if (const JsonValue* value = node->get("rotation")) for (size_t i = 0; i < 4 && i < value->items.size(); i++) r[i] = (float)value->items[i].number;
+            if (const JsonValue* value = node->get("scale")) for (size_t i = 0; i < 3 && i < value->items.size(); i++) s[i] = (float)value->items[i].number;
+            float x = r[0], y = r[1], z = r[2], w = r[3];
+            float rotation[9] = {
+                1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w),
+                2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w),
+                2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y)
+            };
+            for (int column = 0; column < 3; column++) {
+                for (int row = 0; row < 3; row++) local.m[column * 4 + row] = rotation[column * 3 + row] * s[column];
+            }
+            local.m[12] = t[0];
+            local.m[13] = t[1];
+            local.m[14] = t[2];
+        }
+        GltfMatrix world = parent * local;
+        if (node->get("mesh") && !importMesh((int)node->getNumber("mesh", -1), world)) return false;
+        if (const JsonValue* children = node->get("children")) {
+            for (const auto& child : children->items) {
+                if (!importNode((int)child.number, world, depth + 1)) return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    GltfImporter(const char* gltfPath, MeshData& output) : path(gltfPath), mesh(output) {
+        std::string pathString(gltfPath);
+        size_t slash = pathString.find_last_of("/\\");
+        directory = slash == std::string::npos ? "" : pathString.substr(0, slash + 1);
+    }
+
+    bool import() {
+        MappedFile file;
+        if (!file.open(path)) {
+            printf("Failed to open mesh file: %s\n", path);
+            return false;
+        }
+        const unsigned char* json = file.data();
+        size_t jsonSize = file.size();
+        const unsigned char* binChunk = nullptr;
+        size_t binChunkSize = 0;
+        if (file.size() >= 20 && memcmp(file.data(), "glTF", 4) == 0) {
+            // GLB: 12-byte header, JSON chunk, optional BIN chunk
+            uint32_t version, chunkLength, chunkType;
+            memcpy(&version, file.data() + 4, 4);
+            memcpy(&chunkLength, file.data() + 12, 4);
+            memcpy(&chunkType, file.data() + 16, 4);
+            if (version != 2 || chunkType != 0x4E4F534A || 20 + (size_t)chunkLength > file.size()) {
+                printf("Invalid GLB file: %s\n", path);
+                return false;
+            }
+            json = file.data() + 20;
+            jsonSize = chunkLength;
+            size_t next = 20 + (size_t)chunkLength;
+            if (next + 8 <= file.size()) {
+                memcpy(&chunkLength, file.data() + next, 4);
+                memcpy(&chunkType, file.data() + next + 4, 4);
+                if (chunkType == 0x004E4942 && next + 8 + chunkLength <= file.size()) {
+                    binChunk = file.data() + next + 8;
+                    binChunkSize = chunkLength;
+                }
+            }
+        }
+        JsonParser parser((const char*)json, jsonSize);
+        if (!parser.parse(root) || root.type != JsonValue::JSON_OBJECT) {
+            printf("Invalid glTF JSON: %s\n", path);
+            return false;
+        }
+        if (!loadBuffers(binChunk, binChunkSize)) return false;
+
+        mesh.vertices.clear();
+        mesh.indices.clear();
+        GltfMatrix identity;
+        const JsonValue* scenes = root.get("scenes");
+        const JsonValue* scene = scenes ? scenes->at((size_t)root.getNumber("scene", 0)) : nullptr;
+        if (scene && scene->get("nodes")) {
+            for (const auto& node : scene->get("nodes")->items) {
+                if (!importNode((int)node.number, identity, 0)) {
+                    printf("Invalid glTF node hierarchy in %s\n", path);
+                    return false;
+                }
+            }
+        } else if (const JsonValue* meshes = root.get("meshes")) {
+            // No scene: every mesh untransformed
+            for (size_t i = 0; i < meshes->items.size(); i++) {
+                if (!importMesh((int)i, identity)) return false;
+            }
+        }
+        if (mesh.indices.empty()) {
+            printf("No triangles in mesh file: %s\n", path);
+            return false;
+        }
+        return true;
+    }
+};
+
+// Scene hierarchy is flattened into one mesh in world space; only TEXCOORD_0 is kept
+inline bool importGLTF(const char* path, MeshData& mesh) {
+    GltfImporter importer(path, mesh);
+    if (!importer.import()) return false;
+    weldVertices(mesh);
+    // Welding never merges a vertex without a normal into one with, so each primitive that
+    // lacks NORMAL gets normals from its own triangles
+    computeMissingNormals(mesh);
+    return true;
+}
+
+// Imports by extension (.obj, .gltf, .glb) and optimizes for rendering
+inline bool importMesh(const char* path, MeshData& mesh) {
+    std::string name(path);
+    size_t dot = name.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : name.substr(dot + 1);
+    for (auto& c : extension) c = (char)tolower((unsigned char)c);
+    bool ok;
+    if (extension == "obj") ok = importOBJ(path, mesh);
+    else if (extension == "gltf" || extension == "glb") ok = importGLTF(path, mesh);
+    else {
+        printf("Unsupported mesh format: %s\n", path);
+        return false;
+    }
+    if (!ok) return false;
+    optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    optimizeVertexFetch(mesh);
+    return true;
+}
+
+#endif
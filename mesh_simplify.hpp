@@ -0,0 +1,552 @@
+#ifndef MESH_SIMPLIFY_HPP
+#define MESH_SIMPLIFY_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include "mesh_data.hpp"
+#include "mesh_import.hpp"
+
+// Quadric error metric simplification (Garland & Heckbert) by half-edge collapse: a vertex
+// collapses onto a neighbour instead of a new optimal point, so every level only needs a new
+// index buffer and all LODs share the base vertex buffer with its UVs and normals intact.
+// Open borders and UV/normal seams are kept in place (they may be collapse targets, not sources),
+// which keeps silhouettes and texture seams from tearing. Collapses that would fold the surface
+// (flipped triangles) or pinch it into a non-manifold edge (link condition) are rejected.
+//
+// The quadric cost only orders collapses and gates them against the level limits: it is an
+// area-weighted mean of squared plane distances, so its square root is an RMS figure that
+// understates the largest deviation. The error recorded per level is measured instead: the
+// largest distance from a removed vertex to the level's surface (a lower bound of the Hausdorff
+// distance, exact at the original vertices).
+
+// Errors are relative to the mesh bounding radius
+static const float MESH_LOD_ERRORS[] = { 0.004f, 0.015f, 0.05f, 0.15f };
+
+// Plane quadric: ax+by+cz+d squared, stored as the symmetric 4x4 upper triangle
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+    double weight = 0;
+
+    void addPlane(double a, double b, double c, double d, double w) {
+        a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+        b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+        c2 += w * c * c; cd += w * c * d; d2 += w * d * d;
+        weight += w;
+    }
+
+    void add(const Quadric& q) {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd; d2 += q.d2; weight += q.weight;
+    }
+
+    // Weighted sum of squared plane distances at p
+    double evaluate(const float* p) const {
+        double x = p[0], y = p[1], z = p[2];
+        double result = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                      + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                      + c2 * z * z + 2 * cd * z + d2;
+        return result > 0.0 ? result : 0.0;
+    }
+};
+
+// Closest point on triangle abc to p (Ericson, Real-Time Collision Detection 5.1.5); returns the
+// squared distance
+inline float pointTriangleDistanceSquared(const float* p, const float* a, const float* b, const float* c) {
+    float ab[3], ac[3], ap[3], closest[3];
+    for (int k = 0; k < 3; k++) {
+        ab[k] = b[k] - a[k];
+        ac[k] = c[k] - a[k];
+        ap[k] = p[k] - a[k];
+    }
+    auto dot = [](const float* x, const float* y) { return x[0] * y[0] + x[1] * y[1] + x[2] * y[2]; };
+    auto squared = [&](const float* q) {
+        float d[3] = { p[0] - q[0], p[1] - q[1], p[2] - q[2] };
+        return dot(d, d);
+    };
+    float d1 = dot(ab, ap), d2 = dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) return squared(a);
+    float bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+    float d3 = dot(ab, bp), d4 = dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) return squared(b);
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        float v = d1 / (d1 - d3);
+        for (int k = 0; k < 3; k++) closest[k] = a[k] + v * ab[k];
+        return squared(closest);
+    }
+    float cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+    float d5 = dot(ab, cp), d6 = dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) return squared(c);
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        float w = d2 / (d2 - d6);
+        for (int k = 0; k < 3; k++) closest[k] = a[k] + w * ac[k];
+        return squared(closest);
+    }
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+        float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        for (int k = 0; k < 3; k++) closest[k] = b[k] + w * (c[k] - b[k]);
+        return squared(closest);
+    }
+    float denominator = 1.0f / (va + vb + vc);
+    float v = vb * denominator, w = vc * denominator;
+    for (int k = 0; k < 3; k++) closest[k] = a[k] + ab[k] * v + ac[k] * w;
+    return squared(closest);
+}
+
+// Uniform grid over a triangle list for nearest-surface queries, about one triangle per cell.
+// Cells are hashed into a fixed bucket count; a bucket shared by distant cells only costs extra
+// distance tests.
+class TriangleGrid {
+private:
+    const std::vector<MeshVertex>* vertices = nullptr;
+    const std::vector<uint32_t>* indices = nullptr;
+    float origin[3] = { 0, 0, 0 };
+    float cellSize = 1.0f;
+    size_t mask = 0;
+    std::vector<uint32_t> offsets;   // Bucket -> first entry
+    std::vector<uint32_t> triangles; // Entries, grouped by bucket
+
+    void cellOf(const float* p, int64_t cell[3]) const {
+        for (int k = 0; k < 3; k++) cell[k] = (int64_t)floorf((p[k] - origin[k]) / cellSize);
+    }
+
+    size_t bucket(int64_t x, int64_t y, int64_t z) const {
+        return (size_t)((uint64_t)x * 73856093u ^ (uint64_t)y * 19349663u ^ (uint64_t)z * 83492791u) & mask;
+    }
+
+    template <typename Visit>
+    void forEachCell(uint32_t triangle, Visit visit) const {
+        int64_t lo[3], hi[3];
+        const float* p = (*vertices)[(*indices)[triangle * 3]].position;
+        cellOf(p, lo);
+        cellOf(p, hi);
+        for (int c = 1; c < 3; c++) {
+            int64_t cell[3];
+            cellOf((*vertices)[(*indices)[triangle * 3 + c]].position, cell);
+            for (int k = 0; k < 3; k++) {
+                lo[k] = std::min(lo[k], cell[k]);
+                hi[k] = std::max(hi[k], cell[k]);
+            }
+        }
+        for (int64_t x = lo[0]; x <= hi[0]; x++) {
+            for (int64_t y = lo[1]; y <= hi[1]; y++) {
+                for (int64_t z = lo[2]; z <= hi[2]; z++) visit(bucket(x, y, z));
+            }
+        }
+    }
+
+public:
+    // Keeps references to both; they must outlive the queries
+    void build(const std::vector<MeshVertex>& vertexList, const std::vector<uint32_t>& indexList) {
+        vertices = &vertexList;
+        indices = &indexList;
+        uint32_t triangleCount = (uint32_t)(indexList.size() / 3);
+        // Cell size: the mean triangle extent
+        double extent = 0.0;
+        for (int k = 0; k < 3; k++) origin[k] = INFINITY;
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            float lo[3] = { INFINITY, INFINITY, INFINITY }, hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+            for (int c = 0; c < 3; c++) {
+                const float* p = vertexList[indexList[t * 3 + c]].position;
+                for (int k = 0; k < 3; k++) {
+                    lo[k] = fminf(lo[k], p[k]);
+                    hi[k] = fmaxf(hi[k], p[k]);
+                }
+            }
+            for (int k = 0; k < 3; k++) origin[k] = fminf(origin[k], lo[k]);
+            extent += fmaxf(hi[0] - lo[0], fmaxf(hi[1] - lo[1], hi[2] - lo[2]));
+        }
+        cellSize = triangleCount ? (float)(extent / triangleCount) : 1.0f;
+        if (!(cellSize > 0.0f)) cellSize = 1.0f;
+        size_t buckets = 64;
+        while (buckets < (size_t)triangleCount * 2) buckets *= 2;
+        mask = buckets - 1;
+        offsets.assign(buckets + 1, 0);
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            forEachCell(t, [&](size_t b) { offsets[b + 1]++; });
+        }
+        for (size_t b = 0; b < buckets; b++) offsets[b + 1] += offsets[b];
+        triangles.resize(offsets[buckets]);
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            forEachCell(t, [&](size_t b) { triangles[fill[b]++] = t; });
+        }
+    }
+
+    // Squared distance from p to the nearest triangle. Searches shells of cells outwards and
+    // stops once no unvisited cell can be closer than the best hit.
+    float nearestSquared(const float* p) const {
+        if (triangles.empty()) return 0.0f;
+        int64_t centre[3];
+        cellOf(p, centre);
+        float nearest = INFINITY;
+        for (int64_t r = 0; r <= 1024; r++) {
+            for (int64_t x = -r; x <= r; x++) {
+                for (int64_t y = -r; y <= r; y++) {
+                    bool face = x == -r || x == r || y == -r || y == r;
+                    for (int64_t z = -r; z <= r; z += face ? 1 : 2 * r) {
+                        size_t b = bucket(centre[0] + x, centre[1] + y, centre[2] + z);
+                        for (uint32_t e = offsets[b]; e < offsets[b + 1]; e++) {
+                            const uint32_t* corners = &(*indices)[triangles[e] * 3];
+                            nearest = fminf(nearest, pointTriangleDistanceSquared(p, (*vertices)[corners[0]].position,
+                                                                                  (*vertices)[corners[1]].position, (*vertices)[corners[2]].position));
+                        }
+                        if (r == 0) break;
+                    }
+                }
+            }
+            // Cells outside this shell are at least r cells away
+            float reach = (float)r * cellSize;
+            if (nearest <= reach * reach) break;
+        }
+        return nearest;
+    }
+};
+
+inline float meshBoundingRadius(const std::vector<MeshVertex>& vertices, float center[3]) {
+    float lo[3] = { INFINITY, INFINITY, INFINITY }, hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (const auto& vertex : vertices) {
+        for (int k = 0; k < 3; k++) {
+            lo[k] = fminf(lo[k], vertex.position[k]);
+            hi[k] = fmaxf(hi[k], vertex.position[k]);
+        }
+    }
+    for (int k = 0; k < 3; k++) center[k] = vertices.empty() ? 0.0f : (lo[k] + hi[k]) * 0.5f;
+    float radius = 0.0f;
+    for (const auto& vertex : vertices) {
+        float dx = vertex.position[0] - center[0], dy = vertex.position[1] - center[1], dz = vertex.position[2] - center[2];
+        radius = fmaxf(radius, dx * dx + dy * dy + dz * dz);
+    }
+    return sqrtf(radius);
+}
+
+// Simplifies progressively and snapshots one level each time no collapse below the next entry of
+// errorLimits (ascending, mesh units; compared with the RMS quadric cost) is left, so all levels
+// cost about as much as the finest one. Each level records its measured deviation, never less than
+// the previous level's. Candidate collapses and the measurement run on threadCount threads
+// (0 = hardware_concurrency).
+inline void simplifyMeshLevels(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& sourceIndices,
+                               const float* errorLimits, int levelCount, std::vector<MeshLevel>& levels, int threadCount = 0) {
+    levels.assign(levelCount, MeshLevel());
+    std::vector<uint32_t> indices = sourceIndices;
+    size_t vertexCount = vertices.size();
+    if (indices.size() < 3 || vertexCount == 0) {
+        for (auto& level : levels) level.indices = indices;
+        return;
+    }
+    if (threadCount <= 0) threadCount = (int)std::thread::hardware_concurrency();
+    if (threadCount < 1) threadCount = 1;
+
+    // Vertices split only by attributes share one position; topology works on those
+    std::vector<uint32_t> position(vertexCount);
+    std::vector<uint32_t> wedges(vertexCount, 0);
+    {
+        size_t capacity = 64;
+        while (capacity < vertexCount * 2) capacity *= 2;
+        std::vector<uint32_t> table(capacity, UINT32_MAX);
+        for (size_t v = 0; v < vertexCount; v++) {
+            uint32_t words[3];
+            memcpy(words, vertices[v].position, sizeof(words));
+            size_t slot = hashVertexWords(words, 3) & (capacity - 1);
+            while (table[slot] != UINT32_MAX && memcmp(vertices[table[slot]].position, words, sizeof(words)) != 0) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            if (table[slot] == UINT32_MAX) table[slot] = (uint32_t)v;
+            position[v] = table[slot];
+        }
+        std::vector<char> used(vertexCount, 0);
+        for (uint32_t index : indices) {
+            if (!used[index]) {
+                used[index] = 1;
+                wedges[position[index]]++;
+            }
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const float* p0 = vertices[indices[i]].position;
+        const float* p1 = vertices[indices[i + 1]].position;
+        const float* p2 = vertices[indices[i + 2]].position;
+        double e1[3] = { p1[0] - (double)p0[0], p1[1] - (double)p0[1], p1[2] - (double)p0[2] };
+        double e2[3] = { p2[0] - (double)p0[0], p2[1] - (double)p0[1], p2[2] - (double)p0[2] };
+        double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length <= 0.0) continue;
+        double a = n[0] / length, b = n[1] / length, c = n[2] / length;
+        double d = -(a * p0[0] + b * p0[1] + c * p0[2]);
+        // Area weighting keeps the error independent of tessellation density
+        Quadric plane;
+        plane.addPlane(a, b, c, d, length * 0.5);
+        for (int k = 0; k < 3; k++) quadrics[position[indices[i + k]]].add(plane);
+    }
+
+    // Border (one triangle) and non-manifold (three or more) edges lock their vertices
+    std::vector<char> locked(vertexCount, 0);
+    {
+        std::vector<uint64_t> edges;
+        edges.reserve(indices.size());
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                uint64_t a = position[indices[i + k]], b = position[indices[i + (k + 1) % 3]];
+                edges.push_back(a < b ? (a << 32 | b) : (b << 32 | a));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        for (size_t i = 0; i < edges.size();) {
+            size_t j = i;
+            while (j < edges.size() && edges[j] == edges[i]) j++;
+            if (j - i != 2) {
+                locked[edges[i] >> 32] = 1;
+                locked[edges[i] & 0xFFFFFFFF] = 1;
+            }
+            i = j;
+        }
+        for (size_t v = 0; v < vertexCount; v++) {
+            if (wedges[v] > 1) locked[v] = 1;
+        }
+    }
+
+    struct Collapse {
+        uint32_t from, to; // Positions
+        uint32_t wedge;    // Vertex the source's corners are rewritten to
+        float error;
+    };
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> offsets, adjacency;
+    std::vector<char> touched(vertexCount);
+    std::vector<uint32_t> target(vertexCount, UINT32_MAX); // Source position -> replacement vertex
+    std::vector<std::vector<Collapse>> threadCollapses(threadCount);
+    std::vector<uint32_t> linkFrom, linkTo;
+    // Position each position was collapsed onto (itself while it survives), for the measurement
+    std::vector<uint32_t> collapsedOnto(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) collapsedOnto[v] = (uint32_t)v;
+    std::vector<float> threadErrors(threadCount);
+    float levelError = 0.0f;
+    int level = 0;
+    double errorLimitSquared = (double)errorLimits[0] * errorLimits[0];
+
+    for (int pass = 0; level < levelCount; pass++) {
+        // Position -> triangles
+        offsets.assign(vertexCount + 1, 0);
+        for (uint32_t index : indices) offsets[position[index] + 1]++;
+        for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+        adjacency.resize(indices.size());
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++) adjacency[fill[position[indices[i]]]++] = (uint32_t)(i / 3);
+        }
+
+        // Cheapest direction per edge; each interior edge is seen from both triangles, keep a < b
+        size_t triangleCount = indices.size() / 3;
+        int workers = triangleCount < 65536 ? 1 : threadCount;
+        auto evaluate = [&](int worker) {
+            std::vector<Collapse>& out = threadCollapses[worker];
+            out.clear();
+            size_t first = triangleCount * worker / workers, last = triangleCount * (worker + 1) / workers;
+            for (size_t i = first * 3; i < last * 3; i += 3) {
+                for (int k = 0; k < 3; k++) {
+                    uint32_t wa = indices[i + k], wb = indices[i + (k + 1) % 3];
+                    uint32_t a = position[wa], b = position[wb];
+                    if (a >= b) continue;
+                    Quadric sum = quadrics[a];
+                    sum.add(quadrics[b]);
+                    double normalize = sum.weight > 0.0 ? sum.weight : 1.0;
+                    double costAB = locked[a] ? INFINITY : sum.evaluate(vertices[b].position) / normalize;
+                    double costBA = locked[b] ? INFINITY : sum.evaluate(vertices[a].position) / normalize;
+                    double cost = fmin(costAB, costBA);
+                    if (cost > errorLimitSquared) continue;
+                    if (costAB <= costBA) out.push_back({ a, b, wb, (float)sqrt(cost) });
+                    else out.push_back({ b, a, wa, (float)sqrt(cost) });
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (int worker = 1; worker < workers; worker++) threads.emplace_back(evaluate, worker);
+        evaluate(0);
+        for (auto& t : threads) t.join();
+        collapses.clear();
+        for (int worker = 0; worker < workers; worker++) {
+            collapses.insert(collapses.end(), threadCollapses[worker].begin(), threadCollapses[worker].end());
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+        // A vertex takes part in at most one collapse per pass; checks below see earlier collapses
+        // of the same pass through target, so neighbouring collapses stay consistent
+        std::fill(touched.begin(), touched.end(), 0);
+        auto current = [&](uint32_t index) {
+            uint32_t moved = target[position[index]];
+            return moved != UINT32_MAX ? moved : index;
+        };
+        size_t performed = 0;
+        for (const Collapse& collapse : collapses) {
+            if (touched[collapse.from] || touched[collapse.to]) continue;
+            // Reject collapses that flip or fold a surrounding triangle
+            const float* to = vertices[collapse.to].position;
+            bool flips = false;
+            int removed = 0;
+            for (uint32_t k = offsets[collapse.from]; k < offsets[collapse.from + 1] && !flips; k++) {
+                uint32_t triangle = adjacency[k];
+                const float* p[3];
+                const float* moved[3];
+                uint32_t corners[3];
+                bool hasTarget = false;
+                for (int c = 0; c < 3; c++) {
+                    uint32_t index = current(indices[triangle * 3 + c]);
+                    corners[c] = position[index];
+                    p[c] = vertices[index].position;
+                    moved[c] = corners[c] == collapse.from ? to : p[c];
+                    if (corners[c] == collapse.to) hasTarget = true;
+                }
+                // Already degenerate from an earlier collapse this pass
+                if (corners[0] == corners[1] || corners[1] == corners[2] || corners[0] == corners[2]) continue;
+                if (hasTarget) {
+                    removed++;
+                    continue;
+                }
+                float before[3], after[3];
+                float e1[3], e2[3], f1[3], f2[3];
+                for (int c = 0; c < 3; c++) {
+                    e1[c] = p[1][c] - p[0][c]; e2[c] = p[2][c] - p[0][c];
+                    f1[c] = moved[1][c] - moved[0][c]; f2[c] = moved[2][c] - moved[0][c];
+                }
+                before[0] = e1[1] * e2[2] - e1[2] * e2[1]; before[1] = e1[2] * e2[0] - e1[0] * e2[2]; before[2] = e1[0] * e2[1] - e1[1] * e2[0];
+                after[0] = f1[1] * f2[2] - f1[2] * f2[1]; after[1] = f1[2] * f2[0] - f1[0] * f2[2]; after[2] = f1[0] * f2[1] - f1[1] * f2[0];
+                float dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+                float lengths = sqrtf((before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+                                      (after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+                if (dot <= 0.2f * lengths) flips = true;
+            }
+            if (flips || removed == 0) continue;
+
+            // Link condition: the only neighbours both ends share are the apexes of the triangles on
+            // the edge; any other shared one would leave a pinched, non-manifold edge behind
+            linkFrom.clear();
+            linkTo.clear();
+            auto gatherLink = [&](uint32_t centre, std::vector<uint32_t>& link) {
+                for (uint32_t k = offsets[centre]; k < offsets[centre + 1]; k++) {
+                    uint32_t triangle = adjacency[k];
+                    uint32_t corners[3];
+                    for (int c = 0; c < 3; c++) corners[c] = position[current(indices[triangle * 3 + c])];
+                    if (corners[0] == corners[1] || corners[1] == corners[2] || corners[0] == corners[2]) continue;
+                    for (int c = 0; c < 3; c++) {
+                        if (corners[c] != collapse.from && corners[c] != collapse.to) link.push_back(corners[c]);
+                    }
+                }
+                std::sort(link.begin(), link.end());
+                link.erase(std::unique(link.begin(), link.end()), link.end());
+            };
+            gatherLink(collapse.from, linkFrom);
+            gatherLink(collapse.to, linkTo);
+            int shared = 0;
+            for (size_t x = 0, y = 0; x < linkFrom.size() && y < linkTo.size();) {
+                if (linkFrom[x] < linkTo[y]) x++;
+                else if (linkTo[y] < linkFrom[x]) y++;
+                else { shared++; x++; y++; }
+            }
+            if (shared != removed) continue;
+
+            // The wedge the target has inside the collapsing fan (sources are never seams)
+            uint32_t wedge = collapse.wedge;
+            for (uint32_t k = offsets[collapse.from]; k < offsets[collapse.from + 1]; k++) {
+                uint32_t triangle = adjacency[k];
+                for (int c = 0; c < 3; c++) {
+                    uint32_t index = current(indices[triangle * 3 + c]);
+                    if (position[index] == collapse.to) wedge = index;
+                }
+            }
+            target[collapse.from] = wedge;
+            collapsedOnto[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            performed++;
+            touched[collapse.from] = 1;
+            touched[collapse.to] = 1;
+        }
+        if (performed == 0) {
+            // Nothing left under this level's limit; offsets and adjacency still match indices.
+            // Every removed position is measured against the level's surface. The fan of the
+            // position it ended on gives a cheap upper bound, so the grid search only runs for
+            // positions that could raise the error above what is already known.
+            for (size_t v = 0; v < vertexCount; v++) {
+                uint32_t root = collapsedOnto[v];
+                while (collapsedOnto[root] != root) root = collapsedOnto[root];
+                collapsedOnto[v] = root;
+            }
+            TriangleGrid grid;
+            grid.build(vertices, indices);
+            int measureWorkers = triangleCount < 65536 ? 1 : threadCount;
+            auto measure = [&](int worker) {
+                float worst = levelError * levelError;
+                size_t first = vertexCount * worker / measureWorkers, last = vertexCount * (worker + 1) / measureWorkers;
+                for (size_t v = first; v < last; v++) {
+                    uint32_t root = collapsedOnto[v];
+                    if (root == v || position[v] != v) continue;
+                    float bound = INFINITY;
+                    for (uint32_t k = offsets[root]; k < offsets[root + 1] && bound > worst; k++) {
+                        const uint32_t* corners = &indices[adjacency[k] * 3];
+                        bound = fminf(bound, pointTriangleDistanceSquared(vertices[v].position, vertices[corners[0]].position,
+                                                                          vertices[corners[1]].position, vertices[corners[2]].position));
+                    }
+                    if (bound <= worst) continue;
+                    worst = fmaxf(worst, grid.nearestSquared(vertices[v].position));
+                }
+                threadErrors[worker] = worst;
+            };
+            std::vector<std::thread> measureThreads;
+            for (int worker = 1; worker < measureWorkers; worker++) measureThreads.emplace_back(measure, worker);
+            measure(0);
+            for (auto& t : measureThreads) t.join();
+            for (int worker = 0; worker < measureWorkers; worker++) levelError = fmaxf(levelError, sqrtf(threadErrors[worker]));
+            levels[level].indices = indices;
+            levels[level].error = levelError;
+            if (++level < levelCount) errorLimitSquared = (double)errorLimits[level] * errorLimits[level];
+            continue;
+        }
+
+        // Rewrite corners and drop triangles that became degenerate
+        size_t write = 0;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            uint32_t corners[3];
+            for (int c = 0; c < 3; c++) {
+                uint32_t index = indices[i + c];
+                corners[c] = target[position[index]] != UINT32_MAX ? target[position[index]] : index;
+            }
+            if (position[corners[0]] == position[corners[1]] || position[corners[1]] == position[corners[2]] ||
+                position[corners[0]] == position[corners[2]]) continue;
+            indices[write++] = corners[0];
+            indices[write++] = corners[1];
+            indices[write++] = corners[2];
+        }
+        indices.resize(write);
+        for (const Collapse& collapse : collapses) target[collapse.from] = UINT32_MAX;
+    }
+}
+
+// Fills mesh.lods with up to levelCount coarser index buffers at MESH_LOD_ERRORS of the bounding
+// radius, each reordered for the vertex cache
+inline void generateMeshLODs(MeshData& mesh, int levelCount, int threadCount = 0) {
+    int maxLevels = (int)(sizeof(MESH_LOD_ERRORS) / sizeof(MESH_LOD_ERRORS[0]));
+    if (levelCount > maxLevels) levelCount = maxLevels;
+    if (levelCount <= 0) {
+        mesh.lods.clear();
+        return;
+    }
+    float center[3];
+    float radius = meshBoundingRadius(mesh.vertices, center);
+    float errorLimits[sizeof(MESH_LOD_ERRORS) / sizeof(MESH_LOD_ERRORS[0])];
+    for (int level = 0; level < levelCount; level++) errorLimits[level] = MESH_LOD_ERRORS[level] * radius;
+    simplifyMeshLevels(mesh.vertices, mesh.indices, errorLimits, levelCount, mesh.lods, threadCount);
+    std::vector<std::thread> threads;
+    for (auto& lod : mesh.lods) {
+        threads.emplace_back([&mesh, &lod]() { optimizeVertexCache(lod.indices, mesh.vertices.size()); });
+    }
+    for (auto& t : threads) t.join();
+}
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef OBJECT_ID_BUFFER_HPP
+#define OBJECT_ID_BUFFER_HPP
+
+#include <GL/glew.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Pixel-exact picking: an R32UI target the OBJECT_ID variants write object id + 1 into (0 = none).
+// Reads go through a small ring of pixel pack buffers guarded by fences, so a request issued this
+// frame is resolved a frame or two later without glReadPixels waiting for the GPU.
+#define OBJECT_ID_READBACK_SLOTS 3
+#define OBJECT_ID_REGION 5 // Square read around the cursor; the nearest covered pixel wins
+
+struct ObjectIdResult {
+    int objectId; // -1 when nothing covers the region
+    bool isClick;
+};
+
+class ObjectIdBuffer {
+private:
+    struct Readback {
+        GLuint pbo = 0;
+        GLsync fence = 0;
+        int width = 0, height = 0;   // Region actually read (clipped at the edges)
+        int centerX = 0, centerY = 0; // Cursor inside the region
+        bool isClick = false;
+    };
+
+    GLuint framebuffer = 0, idTexture = 0, depthBuffer = 0;
+    int width = 0, height = 0;
+    Readback readbacks[OBJECT_ID_READBACK_SLOTS];
+    int nextSlot = 0;
+
+    void release(Readback& readback) {
+        if (readback.fence) glDeleteSync(readback.fence);
+        readback.fence = 0;
+    }
+
+public:
+    bool isReady() const {
+        return framebuffer != 0;
+    }
+
+    // (Re)creates the target when the framebuffer size changes
+    void resize(int newWidth, int newHeight) {
+        if (newWidth == width && newHeight == height && framebuffer) return;
+        if (newWidth <= 0 || newHeight <= 0) return;
+        destroyTargets();
+        width = newWidth;
+        height = newHeight;
+        glGenTextures(1, &idTexture);
+        glBindTexture(GL_TEXTURE_2D, idTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, idTexture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            printf("Object id framebuffer incomplete\n");
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            destroyTargets();
+            return;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        for (Readback& readback : readbacks) {
+            if (readback.pbo) continue;
+            glGenBuffers(1, &readback.pbo);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, OBJECT_ID_REGION * OBJECT_ID_REGION * sizeof(GLuint), nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // Binds and clears the target; draw the OBJECT_ID variants, then end()
+    void begin() {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        GLuint none[4] = { 0, 0, 0, 0 };
+        glClearBufferuiv(GL_COLOR, 0, none);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    void end() {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // Queues a read around framebuffer pixel (x, y), origin bottom-left. A pending click is never
+    // overwritten; a hover request is simply skipped while all slots are busy.
+    bool request(int x, int y, bool isClick) {
+        if (!isReady() || x < 0 || y < 0 || x >= width || y >= height) return false;
+        Readback& readback = readbacks[nextSlot];
+        if (readback.fence) {
+            if (readback.isClick || !isClick) return false;
+            release(readback);
+        }
+        int x0 = x - OBJECT_ID_REGION / 2 > 0 ? x - OBJECT_ID_REGION / 2 : 0;
+        int y0 = y - OBJECT_ID_REGION / 2 > 0 ? y - OBJECT_ID_REGION / 2 : 0;
+        int x1 = x0 + OBJECT_ID_REGION < width ? x0 + OBJECT_ID_REGION : width;
+        int y1 = y0 + OBJECT_ID_REGION < height ? y0 + OBJECT_ID_REGION : height;
+        readback.width = x1 - x0;
+        readback.height = y1 - y0;
+        readback.centerX = x - x0;
+        readback.centerY = y - y0;
+        readback.isClick = isClick;
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        glReadPixels(x0, y0, readback.width, readback.height, GL_RED_INTEGER, GL_UNSIGNED_INT, (void*)0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        nextSlot = (nextSlot + 1) % OBJECT_ID_READBACK_SLOTS;
+        return true;
+    }
+
+    // Oldest finished request, without blocking. Call until it returns false.
+    bool poll(ObjectIdResult& result) {
+        for (int i = 0; i < OBJECT_ID_READBACK_SLOTS; i++) {
+            Readback& readback = readbacks[(nextSlot + i) % OBJECT_ID_READBACK_SLOTS];
+            if (!readback.fence) continue;
+            if (glClientWaitSync(readback.fence, 0, 0) == GL_TIMEOUT_EXPIRED) return false;
+            release(readback);
+
+            GLuint ids[OBJECT_ID_REGION * OBJECT_ID_REGION];
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+            const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.width * readback.height * sizeof(GLuint), GL_MAP_READ_BIT);
+            if (mapped) memcpy(ids, mapped, readback.width * readback.height * sizeof(GLuint));
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            result.objectId = -1;
+            result.isClick = readback.isClick;
+            int bestDistance = OBJECT_ID_REGION * OBJECT_ID_REGION * 2;
+            for (int y = 0; mapped && y < readback.height; y++) {
+                for (int x = 0; x < readback.width; x++) {
+                    GLuint id = ids[y * readback.width + x];
+                    int dx = x - readback.centerX, dy = y - readback.centerY;
+                    if (id && dx * dx + dy * dy < bestDistance) {
+                        bestDistance = dx * dx + dy * dy;
+                        result.objectId = (int)id - 1;
+                    }
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void destroyTargets() {
+        if (framebuffer) glDeleteFramebuffers(1, &framebuffer);
+        if (idTexture) glDeleteTextures(1, &idTexture);
+        if (depthBuffer) glDeleteRenderbuffers(1, &depthBuffer);
+        framebuffer = idTexture = depthBuffer = 0;
+        width = height = 0;
+    }
+
+    void destroy() {
+        destroyTargets();
+        for (Readback& readback : readbacks) {
+            release(readback);
+            if (readback.pbo) glDeleteBuffers(1, &readback.pbo);
+            readback.pbo = 0;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef PICKING_HPP
+#define PICKING_HPP
+
+#include <math.h>
+#include <glm/glm.hpp>
+#include "bvh.hpp"
+
+// Ray through a window position (pixels, origin top-left as reported by glfwGetCursorPos), from the
+// near plane towards the far plane of the given view-projection
+inline Ray screenRay(double x, double y, int width, int height, const glm::mat4& viewProjection) {
+    glm::mat4 inverse = glm::inverse(viewProjection);
+    float ndcX = (float)(x / width) * 2.0f - 1.0f;
+    float ndcY = 1.0f - (float)(y / height) * 2.0f;
+    glm::vec4 nearPoint = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    Ray ray;
+    ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+    ray.dir = glm::normalize(glm::vec3(farPoint) / farPoint.w - ray.origin);
+    return ray;
+}
+
+// Sub-frustum of a window rectangle (pixels, origin top-left, corners in any order): the
+// rectangle is scaled up to the full NDC square and the planes are taken from the result
+inline Frustum marqueeFrustum(double x0, double y0, double x1, double y1, int width, int height, const glm::mat4& viewProjection) {
+    float left = (float)(fmin(x0, x1) / width) * 2.0f - 1.0f;
+    float right = (float)(fmax(x0, x1) / width) * 2.0f - 1.0f;
+    float bottom = 1.0f - (float)(fmax(y0, y1) / height) * 2.0f;
+    float top = 1.0f - (float)(fmin(y0, y1) / height) * 2.0f;
+    float halfWidth = fmaxf((right - left) * 0.5f, 1e-6f);
+    float halfHeight = fmaxf((top - bottom) * 0.5f, 1e-6f);
+    glm::mat4 rectangle(1.0f);
+    rectangle[0][0] = 1.0f / halfWidth;
+    rectangle[1][1] = 1.0f / halfHeight;
+    rectangle[3][0] = -(left + right) * 0.5f / halfWidth;
+    rectangle[3][1] = -(bottom + top) * 0.5f / halfHeight;
+    return frustumFromMatrix(rectangle * viewProjection);
+}
+
+// Local mesh bounds placed like cubeOrientedBox; the unit cube is (-0.5, 0.5)
+inline OrientedBox meshOrientedBox(const SceneObject& obj, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    OrientedBox box = cubeOrientedBox(obj);
+    glm::vec3 localCenter = (boundsMin + boundsMax) * (0.5f * obj.scale);
+    box.center += box.axes[0] * localCenter.x + box.axes[1] * localCenter.y + box.axes[2] * localCenter.z;
+    box.halfExtents = (boundsMax - boundsMin) * (0.5f * obj.scale);
+    return box;
+}
+
+// Nearest intersection of a ray (unit dir) with a sphere within (0, tMax]
+inline bool intersectSphere(const Ray& ray, const glm::vec3& center, float radius, float tMax, float& tHit) {
+    glm::vec3 offset = ray.origin - center;
+    float b = glm::dot(offset, ray.dir);
+    float c = glm::dot(offset, offset) - radius * radius;
+    float discriminant = b * b - c;
+    if (discriminant < 0.0f) return false;
+    float root = sqrtf(discriminant);
+    float t = -b - root;
+    if (t <= 0.0f) t = -b + root;
+    if (t <= 0.0f || t > tMax) return false;
+    tHit = t;
+    return true;
+}
+
+#endif
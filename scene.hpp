@@ -2,11 +2,15 @@
 #define SCENE_HPP
 
 #include <glm/glm.hpp>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <cstdlib>
 #include <ctime>
+#include <cfloat>
+#include "selection_set.hpp"
 
 enum ObjectType {
     CUBE,
@@ -26,6 +30,20 @@ struct SceneObject {
     float lightIntensity;
     glm::vec3 lightDirection;
     bool isVisible;
+    int meshId = 0;                  // Index into the mesh registry, 0 = cube
+    int materialId = 0;              // Index into the MaterialLibrary
+    glm::vec3 tint = glm::vec3(1.0f);
+};
+
+// One edit for a whole selection: offsets added to every object, rotation and scale to cubes only
+struct TransformDelta {
+    glm::vec3 translation = glm::vec3(0.0f);
+    glm::vec2 rotation = glm::vec2(0.0f);
+    float scale = 0.0f;
+
+    bool empty() const {
+        return translation == glm::vec3(0.0f) && rotation == glm::vec2(0.0f) && scale == 0.0f;
+    }
 };
 
 class Scene {
@@ -33,13 +51,27 @@ private:
     std::vector<SceneObject> objects;
     std::unordered_map<int, size_t> objectIndexMap;
     int nextId;
+    unsigned version = 0;       // Bumped by every change, including writes through getObject()
+    unsigned layoutVersion = 0; // Bumped by every change except transform edits
+    std::vector<size_t> movedObjects; // Indices of transform edits since the last takeMovedObjects()
+
+    void markChanged() {
+        version++;
+        layoutVersion++;
+        movedObjects.clear(); // Indices may have shifted; the layout change covers everything
+    }
+
+    void markTransformed(size_t index) {
+        version++;
+        movedObjects.push_back(index);
+    }
 
 public:
     Scene() : nextId(0) {
         srand(static_cast<unsigned int>(time(nullptr)));
     }
 
-    void addObject(const std::string& name, const glm::vec3& position, const glm::vec2& rotation, float scale) {
+    void addObject(const std::string& name, const glm::vec3& position, const glm::vec2& rotation, float scale, int meshId = 0) {
         SceneObject obj;
         obj.id = nextId++;
         obj.name = name;
@@ -51,8 +83,10 @@ public:
         obj.lightIntensity = 0.0f;
         obj.lightDirection = glm::vec3(0.0f, -1.0f, 0.0f);
         obj.isVisible = true;
+        obj.meshId = meshId;
         objectIndexMap[obj.id] = objects.size();
         objects.push_back(obj);
+        markChanged();
     }
 
     void addLight(SceneObject& light) {
@@ -85,12 +119,14 @@ public:
         light.isVisible = true; // All lights are visible now
         objectIndexMap[light.id] = objects.size();
         objects.push_back(light);
+        markChanged();
     }
 
     void updateObjectPosition(int id, const glm::vec3& position) {
         auto it = objectIndexMap.find(id);
         if (it != objectIndexMap.end()) {
             objects[it->second].position = position;
+            markTransformed(it->second);
         }
     }
 
@@ -98,6 +134,7 @@ public:
         auto it = objectIndexMap.find(id);
         if (it != objectIndexMap.end()) {
             objects[it->second].rotation = rotation;
+            markTransformed(it->second);
         }
     }
 
@@ -105,6 +142,16 @@ public:
         auto it = objectIndexMap.find(id);
         if (it != objectIndexMap.end()) {
             objects[it->second].scale = scale;
+            markTransformed(it->second);
+        }
+    }
+
+    void updateObjectMaterial(int id, int materialId, const glm::vec3& tint) {
+        auto it = objectIndexMap.find(id);
+        if (it != objectIndexMap.end()) {
+            objects[it->second].materialId = materialId;
+            objects[it->second].tint = tint;
+            markChanged();
         }
     }
 
@@ -117,22 +164,94 @@ public:
             for (size_t i = index; i < objects.size(); i++) {
                 objectIndexMap[objects[i].id] = i;
             }
+            markChanged();
             return true;
         }
         return false;
     }
 
+    // Removes every object the predicate accepts in one pass, keeping the order of the rest;
+    // returns how many were removed
+    template <typename Predicate>
+    size_t removeObjectsIf(Predicate predicate) {
+        size_t kept = 0;
+        for (size_t i = 0; i < objects.size(); i++) {
+            if (predicate(objects[i])) continue;
+            if (kept != i) objects[kept] = std::move(objects[i]);
+            kept++;
+        }
+        size_t removed = objects.size() - kept;
+        if (!removed) return 0;
+        objects.resize(kept);
+        objectIndexMap.clear();
+        for (size_t i = 0; i < objects.size(); i++) {
+            objectIndexMap[objects[i].id] = i;
+        }
+        markChanged();
+        return removed;
+    }
+
+    // Applies one delta to every selected object. Scale is clamped per object like the gizmo does.
+    void transformObjects(const SelectionSet& ids, const TransformDelta& delta) {
+        if (delta.empty()) return;
+        ids.forEach([&](int id) {
+            auto it = objectIndexMap.find(id);
+            if (it == objectIndexMap.end()) return;
+            SceneObject& obj = objects[it->second];
+            obj.position += delta.translation;
+            if (obj.type == CUBE) {
+                obj.rotation += delta.rotation;
+                obj.scale = std::min(std::max(obj.scale + delta.scale, 0.1f), 2.0f);
+            }
+            markTransformed(it->second);
+        });
+    }
+
     SceneObject* getObject(int id) {
         auto it = objectIndexMap.find(id);
         if (it != objectIndexMap.end()) {
+            markChanged();
             return &objects[it->second];
         }
         return nullptr;
     }
 
+    // Read-only lookup; unlike getObject() it does not mark the scene changed
+    const SceneObject* findObject(int id) const {
+        auto it = objectIndexMap.find(id);
+        return it != objectIndexMap.end() ? &objects[it->second] : nullptr;
+    }
+
     const std::vector<SceneObject>& getObjects() const {
         return objects;
     }
+
+    unsigned getVersion() const {
+        return version;
+    }
+
+    unsigned getLayoutVersion() const {
+        return layoutVersion;
+    }
+
+    // Object indices (ascending, unique) whose transforms changed since the last call, for
+    // consumers that patch in place while the layout version is unchanged. Take it once per frame.
+    void takeMovedObjects(std::vector<size_t>& indices) {
+        indices.swap(movedObjects);
+        movedObjects.clear();
+        if (!std::is_sorted(indices.begin(), indices.end())) std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    }
+
+    // Moves not yet taken this frame (unsorted, may repeat), for consumers updated mid-frame
+    const std::vector<size_t>& getPendingMovedObjects() const {
+        return movedObjects;
+    }
+
+    // Every id handed out so far is below this
+    int getNextId() const {
+        return nextId;
+    }
 };
 
 #endif
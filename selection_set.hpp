@@ -0,0 +1,129 @@
+#ifndef SELECTION_SET_HPP
+#define SELECTION_SET_HPP
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit; bits must not be 0
+inline int lowestSetBit(uint32_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return (int)index;
+#else
+    return __builtin_ctz(bits);
+#endif
+}
+
+// Selected object ids as a bitset indexed by id (ids are small and dense, see Scene::addObject),
+// so membership is one bit test during instance packing and the words can be uploaded as is for
+// the GPU-driven path. The active object is the one the gizmo and properties panel act on.
+class SelectionSet {
+private:
+    std::vector<uint32_t> words;
+    size_t count = 0;
+    int active = -1;
+    unsigned version = 0; // Bumped on every change, for re-uploading the bits
+
+public:
+    bool contains(int id) const {
+        if (id < 0 || (size_t)(id >> 5) >= words.size()) return false;
+        return (words[id >> 5] >> (id & 31)) & 1u;
+    }
+
+    // makeActive false leaves the active object as it is, for adding many at once (see setActive)
+    void add(int id, bool makeActive = true) {
+        if (id < 0) return;
+        if ((size_t)(id >> 5) >= words.size()) words.resize((id >> 5) + 1, 0);
+        uint32_t bit = 1u << (id & 31);
+        if (!(words[id >> 5] & bit)) {
+            words[id >> 5] |= bit;
+            count++;
+        }
+        if (makeActive) active = id;
+        version++;
+    }
+
+    void remove(int id) {
+        if (!contains(id)) return;
+        words[id >> 5] &= ~(1u << (id & 31));
+        count--;
+        if (active == id) active = first();
+        version++;
+    }
+
+    void toggle(int id) {
+        if (contains(id)) remove(id);
+        else add(id);
+    }
+
+    void clear() {
+        if (!count && active == -1) return;
+        std::fill(words.begin(), words.end(), 0u);
+        count = 0;
+        active = -1;
+        version++;
+    }
+
+    // Replaces the selection with a single object, or empties it for -1
+    void set(int id) {
+        clear();
+        add(id);
+    }
+
+    // Calls visit(id) for every selected id in ascending order
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        for (size_t w = 0; w < words.size(); w++) {
+            uint32_t bits = words[w];
+            while (bits) {
+                int bit = lowestSetBit(bits);
+                visit((int)(w * 32 + bit));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    // Lowest selected id, -1 when empty
+    int first() const {
+        if (!count) return -1;
+        for (size_t w = 0; w < words.size(); w++) {
+            if (words[w]) return (int)(w * 32 + lowestSetBit(words[w]));
+        }
+        return -1;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    int getActive() const {
+        return active;
+    }
+
+    // Only selected ids (or -1) can be active
+    void setActive(int id) {
+        if (id != -1 && !contains(id)) return;
+        if (active == id) return;
+        active = id;
+        version++;
+    }
+
+    const std::vector<uint32_t>& getWords() const {
+        return words;
+    }
+
+    unsigned getVersion() const {
+        return version;
+    }
+};
+
+#endif
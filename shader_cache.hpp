@@ -0,0 +1,139 @@
+#ifndef SHADER_CACHE_HPP
+#define SHADER_CACHE_HPP
+
+#include <GL/glew.h>
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+// On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary).
+// Entries are keyed by a hash of the final shader sources plus the driver identification
+// strings, so a driver update or any source edit simply misses and recompiles.
+class ProgramBinaryCache {
+private:
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    static const uint32_t MAGIC = 0x4250584E; // "NXPB"
+    static const uint32_t VERSION = 1;
+
+    std::string directory;
+    std::string driverId;
+    bool supported = false;
+
+    std::string entryPath(uint64_t key) const {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        return directory + "/" + name;
+    }
+
+public:
+    static uint64_t hash(const std::string& data, uint64_t seed = 14695981039346656037ull) {
+        uint64_t h = seed;
+        for (unsigned char c : data) {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    // Needs a current context; disables itself when the driver exposes no binary formats
+    void init(const std::string& cacheDirectory) {
+        directory = cacheDirectory;
+        GLint formats = 0;
+        if (GLEW_ARB_get_program_binary) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        }
+        supported = formats > 0;
+        const char* vendor = (const char*)glGetString(GL_VENDOR);
+        const char* renderer = (const char*)glGetString(GL_RENDERER);
+        const char* version = (const char*)glGetString(GL_VERSION);
+        driverId = std::string(vendor ? vendor : "") + "|" + (renderer ? renderer : "") + "|" + (version ? version : "");
+        if (supported) {
+            std::error_code error;
+            std::filesystem::create_directories(directory, error);
+            if (error) {
+                printf("Program binary cache disabled: cannot create %s\n", directory.c_str());
+                supported = false;
+            }
+        }
+    }
+
+    bool isSupported() const {
+        return supported;
+    }
+
+    uint64_t makeKey(const std::string& vertexSource, const std::string& fragmentSource) const {
+        uint64_t key = hash(driverId);
+        key = hash(vertexSource, key);
+        key = hash("\x1f", key);
+        return hash(fragmentSource, key);
+    }
+
+    // Returns a linked program or 0 when the entry is missing or rejected by the driver
+    GLuint load(uint64_t key) const {
+        if (!supported) return 0;
+        std::string path = entryPath(key);
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file) return 0;
+
+        FileHeader header;
+        std::vector<unsigned char> binary;
+        bool valid = fread(&header, sizeof(header), 1, file) == 1 && header.magic == MAGIC &&
+                     header.version == VERSION && header.key == key && header.length > 0;
+        if (valid) {
+            binary.resize(header.length);
+            valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+        }
+        fclose(file);
+        if (!valid) {
+            std::remove(path.c_str());
+            return 0;
+        }
+
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            // Driver rejected the blob (e.g. internal format change); drop it and recompile
+            glDeleteProgram(program);
+            std::remove(path.c_str());
+            return 0;
+        }
+        return program;
+    }
+
+    void store(uint64_t key, GLuint program) const {
+        if (!supported || !program) return;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+        std::vector<unsigned char> binary(length);
+        GLenum format = 0;
+        GLsizei written = 0;
+        glGetProgramBinary(program, length, &written, &format, binary.data());
+        if (written <= 0) return;
+
+        FileHeader header = { MAGIC, VERSION, key, format, (uint32_t)written };
+        std::string path = entryPath(key);
+        std::string temp = path + ".tmp";
+        FILE* file = fopen(temp.c_str(), "wb");
+        if (!file) return;
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary.data(), 1, written, file) == (size_t)written;
+        fclose(file);
+        // Write-then-rename so a crash never leaves a truncated entry behind
+        if (!ok || std::rename(temp.c_str(), path.c_str()) != 0) {
+            std::remove(temp.c_str());
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef SHADER_SOURCE_HPP
+#define SHADER_SOURCE_HPP
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+// Read shader file
+inline std::string readShaderFile(const char* filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        printf("Failed to open shader file: %s\n", filename);
+        return "";
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// Reads a shader and expands #include "file" lines (paths relative to the including file).
+// Every file that was read is appended to dependencies, so callers can watch or hash them.
+inline bool loadShaderSource(const std::string& path, std::string& out, std::vector<std::string>* dependencies = nullptr, int depth = 0) {
+    if (depth > 16) {
+        printf("Shader include depth exceeded at %s\n", path.c_str());
+        return false;
+    }
+    std::string source = readShaderFile(path.c_str());
+    if (source.empty()) return false;
+    if (dependencies) dependencies->push_back(path);
+
+    std::string directory;
+    size_t slash = path.find_last_of("/\\");
+    if (slash != std::string::npos) directory = path.substr(0, slash + 1);
+
+    std::istringstream lines(source);
+    std::string line;
+    while (std::getline(lines, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos && line.compare(start, 8, "#include") == 0) {
+            size_t open = line.find('"', start);
+            size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+            if (close == std::string::npos) {
+                printf("Malformed #include in %s: %s\n", path.c_str(), line.c_str());
+                return false;
+            }
+            if (!loadShaderSource(directory + line.substr(open + 1, close - open - 1), out, dependencies, depth + 1)) {
+                return false;
+            }
+            continue;
+        }
+        out += line;
+        out += '\n';
+    }
+    return true;
+}
+
+// Inserts defines right after the #version line (GLSL requires #version to come first)
+inline std::string injectDefines(const std::string& source, const std::string& defines) {
+    if (defines.empty()) return source;
+    size_t version = source.find("#version");
+    if (version == std::string::npos) return defines + source;
+    size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos) return source + "\n" + defines;
+    return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+}
+
+#endif
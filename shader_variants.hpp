@@ -0,0 +1,463 @@
+#ifndef SHADER_VARIANTS_HPP
+#define SHADER_VARIANTS_HPP
+
+#include <GL/glew.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include "shader_source.hpp"
+#include "frame_constants.hpp"
+#include "shader_cache.hpp"
+#include "asset_archive.hpp"
+
+// Feature bits; each set bit becomes a #define in both shader stages
+enum ShaderFeature : unsigned {
+    SHADER_LIT               = 1u << 0, // Textured cube with lighting
+    SHADER_LIGHT_PROXY       = 1u << 1, // Light source marker, flat light colour
+    SHADER_OUTLINE           = 1u << 2, // Selection outline
+    SHADER_GIZMO             = 1u << 3, // Coloured gizmo lines (position + colour layout)
+    SHADER_DEPTH_ONLY        = 1u << 4, // Depth prepass, no colour output
+    SHADER_LIGHT_POINT       = 1u << 5, // With SHADER_LIT: point light
+    SHADER_LIGHT_DIRECTIONAL = 1u << 6, // With SHADER_LIT: directional light (neither = ambient only)
+    SHADER_LIGHTMAP          = 1u << 7, // With SHADER_LIT: per-instance baked lightmap lookup
+    SHADER_PROBES            = 1u << 8, // With SHADER_LIT: irradiance probe ambient
+    SHADER_LOD_FADE          = 1u << 9, // Instanced passes: screen-door dither by per-instance LOD fade
+    SHADER_IMPOSTOR          = 1u << 10, // Instanced passes: camera-facing quad sampling the impostor atlas
+    SHADER_IMPOSTOR_BAKE     = 1u << 11, // Mesh UV + normal into an impostor atlas frame (MRT)
+    SHADER_GPU_DRIVEN        = 1u << 12, // Instanced passes: instances referenced by the GPU culling lists
+    SHADER_OBJECT_ID         = 1u << 13  // Object id + 1 into an R32UI target (object_id_buffer.hpp)
+};
+
+static const struct {
+    unsigned bit;
+    const char* define;
+} SHADER_FEATURE_DEFINES[] = {
+    { SHADER_LIT, "LIT" },
+    { SHADER_LIGHT_PROXY, "LIGHT_PROXY" },
+    { SHADER_OUTLINE, "OUTLINE" },
+    { SHADER_GIZMO, "GIZMO" },
+    { SHADER_DEPTH_ONLY, "DEPTH_ONLY" },
+    { SHADER_LIGHT_POINT, "LIGHT_POINT" },
+    { SHADER_LIGHT_DIRECTIONAL, "LIGHT_DIRECTIONAL" },
+    { SHADER_LIGHTMAP, "LIGHTMAP" },
+    { SHADER_PROBES, "PROBES" },
+    { SHADER_LOD_FADE, "LOD_FADE" },
+    { SHADER_IMPOSTOR, "IMPOSTOR" },
+    { SHADER_IMPOSTOR_BAKE, "IMPOSTOR_BAKE" },
+    { SHADER_GPU_DRIVEN, "GPU_DRIVEN" },
+    { SHADER_OBJECT_ID, "OBJECT_ID" },
+};
+
+inline std::string shaderFeatureDefines(unsigned features) {
+    std::string defines;
+    for (const auto& feature : SHADER_FEATURE_DEFINES) {
+        if (features & feature.bit) {
+            defines += "#define ";
+            defines += feature.define;
+            defines += "\n";
+        }
+    }
+    return defines;
+}
+
+// Uniform locations cache, one per linked program
+struct ShaderUniforms {
+    GLint material_diffuse;
+    GLint material_specular;
+    GLint material_shininess;
+    GLint lightmap;
+    GLint probeSH[3];
+    GLint gizmoModel;
+    GLint impostorViewProjection;
+    GLint impostorRadius;
+    GLint impostorGrid;
+    GLint impostorSurface;
+    GLint impostorNormal;
+    GLint instanceData;
+    GLint selectionBits;
+    GLint hoveredObjectId;
+};
+
+struct ShaderVariant {
+    GLuint program = 0;
+    unsigned features = 0;
+    ShaderUniforms uniforms;
+};
+
+inline void cacheShaderUniforms(GLuint program, ShaderUniforms& uniforms) {
+    GLuint frameBlock = glGetUniformBlockIndex(program, "FrameConstants");
+    if (frameBlock != GL_INVALID_INDEX) glUniformBlockBinding(program, frameBlock, FRAME_CONSTANTS_BINDING);
+    GLuint passBlock = glGetUniformBlockIndex(program, "PassConstants");
+    if (passBlock != GL_INVALID_INDEX) glUniformBlockBinding(program, passBlock, PASS_CONSTANTS_BINDING);
+
+    uniforms.material_diffuse = glGetUniformLocation(program, "material_diffuse");
+    uniforms.material_specular = glGetUniformLocation(program, "material_specular");
+    uniforms.material_shininess = glGetUniformLocation(program, "material_shininess");
+    uniforms.lightmap = glGetUniformLocation(program, "lightmap");
+    uniforms.probeSH[0] = glGetUniformLocation(program, "probeSH_r");
+    uniforms.probeSH[1] = glGetUniformLocation(program, "probeSH_g");
+    uniforms.probeSH[2] = glGetUniformLocation(program, "probeSH_b");
+    uniforms.gizmoModel = glGetUniformLocation(program, "gizmoModel");
+    uniforms.impostorViewProjection = glGetUniformLocation(program, "impostorViewProjection");
+    uniforms.impostorRadius = glGetUniformLocation(program, "impostorRadius");
+    uniforms.impostorGrid = glGetUniformLocation(program, "impostorGrid");
+    uniforms.impostorSurface = glGetUniformLocation(program, "impostor_surface");
+    uniforms.impostorNormal = glGetUniformLocation(program, "impostor_normal");
+    uniforms.instanceData = glGetUniformLocation(program, "instanceData");
+    uniforms.selectionBits = glGetUniformLocation(program, "selectionBits");
+    uniforms.hoveredObjectId = glGetUniformLocation(program, "hoveredObjectId");
+}
+
+// Program whose compile and link were issued but not yet checked
+struct PendingProgram {
+    GLuint vertexShader = 0;
+    GLuint fragmentShader = 0;
+    GLuint program = 0;
+    uint64_t cacheKey = 0;
+    bool cacheable = false;
+};
+
+// Issues compile and link without querying any status, so the driver can work in the background.
+// retrievable asks the driver to keep the binary for glGetProgramBinary.
+inline void submitShaderProgram(const std::string& vertexShaderCode, const std::string& fragmentShaderCode, bool retrievable, PendingProgram& pending) {
+    const char* vertexShaderSource = vertexShaderCode.c_str();
+    const char* fragmentShaderSource = fragmentShaderCode.c_str();
+
+    pending.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(pending.vertexShader, 1, &vertexShaderSource, NULL);
+    glCompileShader(pending.vertexShader);
+
+    pending.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(pending.fragmentShader, 1, &fragmentShaderSource, NULL);
+    glCompileShader(pending.fragmentShader);
+
+    pending.program = glCreateProgram();
+    glAttachShader(pending.program, pending.vertexShader);
+    glAttachShader(pending.program, pending.fragmentShader);
+    if (retrievable) glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(pending.program);
+}
+
+// Non-blocking completion check; only valid with GL_KHR_parallel_shader_compile
+inline bool isShaderProgramComplete(const PendingProgram& pending) {
+    GLint done = GL_TRUE;
+    glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+// Checks compile and link results and releases the shader objects. Returns the program or 0 on failure.
+inline GLuint finishShaderProgram(PendingProgram& pending) {
+    GLint success;
+    char infoLog[512];
+    GLuint shaderProgram = pending.program;
+    glGetShaderiv(pending.vertexShader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(pending.vertexShader, 512, NULL, infoLog);
+        printf("Vertex shader compilation error: %s\n", infoLog);
+        shaderProgram = 0;
+    }
+    if (shaderProgram) {
+        glGetShaderiv(pending.fragmentShader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(pending.fragmentShader, 512, NULL, infoLog);
+            printf("Fragment shader compilation error: %s\n", infoLog);
+            shaderProgram = 0;
+        }
+    }
+    if (shaderProgram) {
+        glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+            printf("Shader program linking error: %s\n", infoLog);
+            shaderProgram = 0;
+        }
+    }
+
+    glDeleteShader(pending.vertexShader);
+    glDeleteShader(pending.fragmentShader);
+    if (!shaderProgram) glDeleteProgram(pending.program);
+    pending.vertexShader = pending.fragmentShader = pending.program = 0;
+    return shaderProgram;
+}
+
+// Create shader program from preprocessed sources, blocking until it is linked
+inline GLuint createShaderProgram(const std::string& vertexShaderCode, const std::string& fragmentShaderCode, bool retrievable = false) {
+    PendingProgram pending;
+    submitShaderProgram(vertexShaderCode, fragmentShaderCode, retrievable, pending);
+    return finishShaderProgram(pending);
+}
+
+// Compute program (GL 4.3+) from a preprocessed source, blocking. Returns 0 on failure.
+inline GLuint createComputeProgram(const std::string& computeShaderCode) {
+    const char* source = computeShaderCode.c_str();
+    GLint success;
+    char infoLog[512];
+    GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        printf("Compute shader compilation error: %s\n", infoLog);
+        glDeleteShader(shader);
+        return 0;
+    }
+    GLuint program = glCreateProgram();
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    glDeleteShader(shader);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        printf("Compute program linking error: %s\n", infoLog);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// Compiles specialised programs from one vertex/fragment source pair, keyed by feature mask.
+// request() only submits work; poll() picks up finished programs once per frame, and get()
+// blocks for a single variant when the caller cannot draw without it. reload() rebuilds every
+// variant from fresh sources and swaps each one in only after it links.
+class ShaderLibrary {
+private:
+    std::string vertexFile;
+    std::string fragmentFile;
+    std::string vertexSource;
+    std::string fragmentSource;
+    std::unordered_map<unsigned, ShaderVariant> variants;
+    std::function<void(ShaderVariant&)> onLinked;
+    std::unordered_map<unsigned, PendingProgram> pending;
+    std::unordered_map<unsigned, PendingProgram> reloads; // Replacements for variants that are already built
+    std::vector<std::string> dependencies;
+    ProgramBinaryCache* binaryCache = nullptr;
+    const AssetArchive* archive = nullptr;
+    bool parallelCompile = false;
+    int cacheHits = 0;
+    int compiles = 0;
+
+    ShaderVariant buildVariant(unsigned features, GLuint program) {
+        ShaderVariant variant;
+        variant.features = features;
+        variant.program = program;
+        if (variant.program) {
+            cacheShaderUniforms(variant.program, variant.uniforms);
+            glUseProgram(variant.program);
+            if (onLinked) onLinked(variant);
+            glUseProgram(0);
+        }
+        return variant;
+    }
+
+    const ShaderVariant& addVariant(unsigned features, GLuint program) {
+        if (!program) printf("Shader variant 0x%x failed to build\n", features);
+        return variants[features] = buildVariant(features, program);
+    }
+
+    // Program and uniform locations are replaced together, so a draw never sees a mix of both
+    void swapVariant(unsigned features, GLuint program) {
+        ShaderVariant& variant = variants[features];
+        GLuint previous = variant.program;
+        variant = buildVariant(features, program);
+        if (previous) glDeleteProgram(previous);
+    }
+
+    // Returns a program restored from the binary cache, or submits a compile into program and returns 0
+    GLuint prepare(unsigned features, PendingProgram& program) {
+        std::string defines = shaderFeatureDefines(features);
+        std::string vertex = injectDefines(vertexSource, defines);
+        std::string fragment = injectDefines(fragmentSource, defines);
+        program.cacheable = binaryCache && binaryCache->isSupported();
+        if (program.cacheable) {
+            program.cacheKey = binaryCache->makeKey(vertex, fragment);
+            GLuint cached = binaryCache->load(program.cacheKey);
+            if (cached) {
+                cacheHits++;
+                return cached;
+            }
+        }
+        submitShaderProgram(vertex, fragment, program.cacheable, program);
+        return 0;
+    }
+
+    static void discard(std::unordered_map<unsigned, PendingProgram>& programs) {
+        for (auto& entry : programs) {
+            glDeleteShader(entry.second.vertexShader);
+            glDeleteShader(entry.second.fragmentShader);
+            glDeleteProgram(entry.second.program);
+        }
+        programs.clear();
+    }
+
+    const ShaderVariant& complete(unsigned features) {
+        PendingProgram program = pending[features];
+        pending.erase(features);
+        GLuint linked = finishShaderProgram(program);
+        compiles++;
+        if (linked && program.cacheable) binaryCache->store(program.cacheKey, linked);
+        return addVariant(features, linked);
+    }
+
+    void completeReload(unsigned features) {
+        PendingProgram program = reloads[features];
+        reloads.erase(features);
+        GLuint linked = finishShaderProgram(program);
+        compiles++;
+        if (!linked) {
+            printf("Shader variant 0x%x reload failed, keeping previous program\n", features);
+            return;
+        }
+        if (program.cacheable) binaryCache->store(program.cacheKey, linked);
+        swapVariant(features, linked);
+    }
+
+public:
+    // Optional; when set, variants are loaded from and saved to the program binary cache
+    void setBinaryCache(ProgramBinaryCache* cache) {
+        binaryCache = cache;
+    }
+
+    // Optional; cooked (already preprocessed) sources in the archive take precedence over loose files
+    void setArchive(const AssetArchive* assetArchive) {
+        archive = assetArchive;
+    }
+
+    // Reads one stage: from the archive when it has the file, else from disk with #include expansion
+    bool readSource(const std::string& path, std::string& out, std::vector<std::string>* files) const {
+        AssetSlice slice;
+        if (archive && archive->find(path, slice) && slice.type == ASSET_SHADER) {
+            out.assign((const char*)slice.data, slice.size);
+            return true;
+        }
+        return loadShaderSource(path, out, files);
+    }
+
+    // onLinkedCallback runs with the new program bound, to set constant uniforms such as samplers
+    bool init(const char* vertexPath, const char* fragmentPath, std::function<void(ShaderVariant&)> onLinkedCallback) {
+        vertexFile = vertexPath;
+        fragmentFile = fragmentPath;
+        onLinked = onLinkedCallback;
+        parallelCompile = GLEW_KHR_parallel_shader_compile;
+        if (parallelCompile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu); // Let the driver pick the thread count
+        vertexSource.clear();
+        fragmentSource.clear();
+        dependencies.clear();
+        if (!readSource(vertexFile, vertexSource, &dependencies) || !readSource(fragmentFile, fragmentSource, &dependencies)) {
+            printf("Error reading shader files\n");
+            return false;
+        }
+        return true;
+    }
+
+    // Re-reads the sources and resubmits every variant. Built variants keep drawing with their
+    // current program until poll() swaps in the new one; failed compiles leave them untouched.
+    bool reload() {
+        std::string newVertex, newFragment;
+        std::vector<std::string> newDependencies;
+        if (!readSource(vertexFile, newVertex, &newDependencies) || !readSource(fragmentFile, newFragment, &newDependencies)) {
+            printf("Shader reload skipped: sources could not be read\n");
+            return false;
+        }
+        vertexSource.swap(newVertex);
+        fragmentSource.swap(newFragment);
+        dependencies.swap(newDependencies);
+
+        std::vector<unsigned> unbuilt;
+        for (const auto& entry : pending) unbuilt.push_back(entry.first);
+        discard(pending);
+        discard(reloads);
+        for (unsigned features : unbuilt) request(features);
+        for (const auto& entry : variants) {
+            PendingProgram program;
+            GLuint cached = prepare(entry.first, program);
+            if (cached) swapVariant(entry.first, cached);
+            else reloads[entry.first] = program;
+        }
+        return true;
+    }
+
+    // Every file read by the last successful init() or reload(), includes in first-seen order.
+    // Stages taken from the archive read no files, so with both cooked this is empty.
+    const std::vector<std::string>& getDependencies() const {
+        return dependencies;
+    }
+
+    // Starts building a variant unless it is already built or in flight. Cached binaries load immediately.
+    void request(unsigned features) {
+        if (variants.count(features) || pending.count(features)) return;
+        PendingProgram program;
+        GLuint cached = prepare(features, program);
+        if (cached) addVariant(features, cached);
+        else pending[features] = program;
+    }
+
+    // Collects finished programs and reloads. Without parallel compile the status query blocks,
+    // so only one program is finished per call to spread the cost over frames.
+    void poll() {
+        std::vector<unsigned> ready, reloaded;
+        bool budget = true;
+        for (const auto& entry : pending) {
+            if (parallelCompile ? isShaderProgramComplete(entry.second) : budget) {
+                ready.push_back(entry.first);
+                budget = false;
+            }
+        }
+        for (const auto& entry : reloads) {
+            if (parallelCompile ? isShaderProgramComplete(entry.second) : budget) {
+                reloaded.push_back(entry.first);
+                budget = false;
+            }
+        }
+        for (unsigned features : ready) {
+            complete(features);
+        }
+        for (unsigned features : reloaded) {
+            completeReload(features);
+        }
+    }
+
+    // Returns the variant if it is built, otherwise submits it and returns nullptr
+    const ShaderVariant* tryGet(unsigned features) {
+        auto it = variants.find(features);
+        if (it != variants.end()) return &it->second;
+        request(features);
+        it = variants.find(features);
+        return it != variants.end() ? &it->second : nullptr;
+    }
+
+    // Returns the variant for a feature mask, blocking until it is built. program is 0 on failure.
+    const ShaderVariant& get(unsigned features) {
+        auto it = variants.find(features);
+        if (it != variants.end()) return it->second;
+        request(features);
+        it = variants.find(features);
+        if (it != variants.end()) return it->second;
+        return complete(features);
+    }
+
+    int getPendingCount() const {
+        return (int)(pending.size() + reloads.size());
+    }
+
+    int getCacheHits() const {
+        return cacheHits;
+    }
+
+    int getCompileCount() const {
+        return compiles;
+    }
+
+    void destroy() {
+        discard(pending);
+        discard(reloads);
+        for (auto& entry : variants) {
+            if (entry.second.program) glDeleteProgram(entry.second.program);
+        }
+        variants.clear();
+    }
+};
+
+#endif
@@ -0,0 +1,467 @@
+#ifndef TEXTURE_STREAMER_HPP
+#define TEXTURE_STREAMER_HPP
+
+#include <GL/glew.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "image_loader.hpp"
+#include "compressed_texture.hpp"
+#include "asset_archive.hpp"
+
+// One mip level inside TextureData::bytes
+struct TextureLevel {
+    int width;
+    int height;
+    size_t offset;
+    size_t size;
+};
+
+// Decoded texture ready for upload: every level is already in its final GL layout.
+// blockBytes is non-zero for block-compressed formats, whose rows are 4-texel block rows.
+// source, when set, points at level data owned elsewhere (a mapped archive) instead of bytes.
+struct TextureData {
+    GLenum internalFormat = GL_RGBA8;
+    GLenum format = GL_RGBA;
+    GLenum type = GL_UNSIGNED_BYTE;
+    int blockBytes = 0;
+    std::vector<TextureLevel> levels;
+    std::vector<unsigned char> bytes;
+    const unsigned char* source = nullptr;
+
+    const unsigned char* data() const {
+        return source ? source : bytes.data();
+    }
+};
+
+inline GLenum blockFormatInternalFormat(BlockFormat format, bool srgb) {
+    switch (format) {
+    case BLOCK_BC1: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case BLOCK_BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+}
+
+// Compressed mip chains are uploaded untouched, so no CPU work beyond reading the file
+inline void compressedTextureData(CompressedImage& image, TextureData& data) {
+    data.internalFormat = blockFormatInternalFormat(image.format, image.srgb);
+    data.blockBytes = blockFormatBytes(image.format);
+    data.levels.clear();
+    for (const auto& level : image.levels) {
+        data.levels.push_back({ level.width, level.height, level.offset, level.size });
+    }
+    data.bytes.swap(image.bytes);
+    data.source = image.source;
+}
+
+inline void imageTextureData(const Image& image, TextureData& data) {
+    std::vector<Image> mips;
+    buildMipChain(image, mips);
+    data.levels.clear();
+    data.bytes.clear();
+    for (const auto& mip : mips) {
+        data.levels.push_back({ mip.width, mip.height, data.bytes.size(), mip.pixels.size() });
+        data.bytes.insert(data.bytes.end(), mip.pixels.begin(), mip.pixels.end());
+    }
+}
+
+// Worker-thread side: cooked archive entries and .dds/.ktx2 files as stored, anything else as
+// BMP to RGBA8 with a CPU-built mip chain. Rows go up bottom first in every case; cooked entries
+// keep the BMP row order they were encoded from.
+inline bool decodeTexture(const std::string& path, TextureData& data, const AssetArchive* archive = nullptr) {
+    AssetSlice slice;
+    if (archive && archive->find(path, slice) && slice.type == ASSET_TEXTURE) {
+        CompressedImage compressed;
+        if (!parseDDS(slice.data, slice.size, compressed, path.c_str(), true)) return false;
+        compressedTextureData(compressed, data);
+        return true;
+    }
+
+    size_t dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+    if (extension == "dds" || extension == "ktx2") {
+        CompressedImage compressed;
+        if (!loadCompressedImage(path, compressed)) return false;
+        compressedTextureData(compressed, data);
+        return true;
+    }
+
+    Image image;
+    if (!decodeBMP(path.c_str(), image)) return false;
+    imageTextureData(image, data);
+    return true;
+}
+
+// Texture array layer: always RGBA8, resampled to the array size when the file differs
+inline bool decodeTextureLayer(const std::string& path, int width, int height, TextureData& data) {
+    Image image;
+    if (!decodeBMP(path.c_str(), image)) return false;
+    if (image.width != width || image.height != height) {
+        Image resized;
+        resizeImage(image, width, height, resized);
+        image.pixels.swap(resized.pixels);
+        image.width = width;
+        image.height = height;
+    }
+    imageTextureData(image, data);
+    return true;
+}
+
+// Loads textures without stalling the render loop. Files are decoded on worker threads;
+// update() then streams at most bytesPerFrame of pixel data per frame through a ring of
+// pixel-unpack buffers. Until a texture is fully resident, get() returns a placeholder.
+// Texture arrays are streamed the same way, one decode job and one upload per layer.
+class TextureStreamer {
+private:
+    static const int STAGING_BUFFERS = 3;
+
+    struct Texture {
+        std::vector<std::string> paths; // One per layer
+        GLenum target = GL_TEXTURE_2D;
+        int width = 0;                  // Layer size, arrays only
+        int height = 0;
+        GLuint texture = 0;
+        int layersRemaining = 1;
+        bool resident = false;
+    };
+
+    struct Job {
+        int id;
+        int layer;
+    };
+
+    struct Upload {
+        int id;
+        int layer = 0;
+        TextureData data;
+        int level = 0;
+        int row = 0;
+    };
+
+    // glTexSubImage2D/3D issued after the staging buffer is unmapped
+    struct SubImage {
+        GLuint texture;
+        GLenum target;
+        const TextureData* data;
+        int layer;
+        int level;
+        int row;
+        int rows;
+        GLintptr offset;
+    };
+
+    std::vector<Texture> textures;
+    std::deque<Upload> uploads; // Render thread only
+    int outstanding = 0;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> jobs;
+    std::deque<Upload> decoded;
+    std::vector<Job> failed;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    const AssetArchive* archive = nullptr;
+    GLuint placeholder = 0;
+    GLuint placeholderArray = 0;
+    GLuint stagingBuffers[STAGING_BUFFERS] = {};
+    GLsync fences[STAGING_BUFFERS] = {};
+    int currentBuffer = 0;
+    GLsizeiptr bytesPerFrame = 0;
+
+    void workerLoop() {
+        for (;;) {
+            Upload upload;
+            std::string path;
+            GLenum target;
+            int width, height;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (stopping) return;
+                upload.id = jobs.front().id;
+                upload.layer = jobs.front().layer;
+                jobs.pop_front();
+                const Texture& texture = textures[upload.id];
+                path = texture.paths[upload.layer];
+                target = texture.target;
+                width = texture.width;
+                height = texture.height;
+            }
+            bool ok = target == GL_TEXTURE_2D_ARRAY ? decodeTextureLayer(path, width, height, upload.data)
+                                                    : decodeTexture(path, upload.data, archive);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ok) decoded.push_back(std::move(upload));
+            else failed.push_back({ upload.id, upload.layer });
+        }
+    }
+
+    // Upload granularity: texel rows, or 4-texel block rows for compressed data
+    static size_t rowBytes(const TextureData& data, const TextureLevel& level) {
+        return data.blockBytes ? (size_t)((level.width + 3) / 4) * data.blockBytes : (size_t)level.width * 4;
+    }
+
+    static int rowCount(const TextureData& data, const TextureLevel& level) {
+        return data.blockBytes ? (level.height + 3) / 4 : level.height;
+    }
+
+    static bool isFormatSupported(const TextureData& data) {
+        switch (data.internalFormat) {
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            return GLEW_EXT_texture_compression_s3tc;
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+            return GLEW_EXT_texture_compression_s3tc && GLEW_EXT_texture_sRGB;
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+            return GLEW_ARB_texture_compression_bptc;
+        default:
+            return true;
+        }
+    }
+
+    // Allocates every level up front (no pixel data) so levels and layers can arrive in any order
+    void allocate(Texture& texture, const TextureData& data) {
+        if (texture.texture) return;
+        GLenum target = texture.target;
+        glGenTextures(1, &texture.texture);
+        glBindTexture(target, texture.texture);
+        for (size_t i = 0; i < data.levels.size(); i++) {
+            const TextureLevel& level = data.levels[i];
+            if (target == GL_TEXTURE_2D_ARRAY) {
+                glTexImage3D(target, (GLint)i, data.internalFormat, level.width, level.height, (GLsizei)texture.paths.size(), 0, data.format, data.type, NULL);
+            } else if (data.blockBytes) {
+                glCompressedTexImage2D(target, (GLint)i, data.internalFormat, level.width, level.height, 0, (GLsizei)level.size, NULL);
+            } else {
+                glTexImage2D(target, (GLint)i, data.internalFormat, level.width, level.height, 0, data.format, data.type, NULL);
+            }
+        }
+        glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, (GLint)data.levels.size() - 1);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, data.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(target, 0);
+    }
+
+    // A layer finished (or failed): the texture becomes resident once every layer is done
+    void finishLayer(int id) {
+        Texture& texture = textures[id];
+        if (--texture.layersRemaining > 0) return;
+        texture.resident = texture.texture != 0;
+        outstanding--;
+    }
+
+public:
+    // Needs a current context. workerCount 0 means one thread per core minus the render thread.
+    void init(GLsizeiptr uploadBytesPerFrame, int workerCount = 0) {
+        bytesPerFrame = uploadBytesPerFrame;
+        glGenBuffers(STAGING_BUFFERS, stagingBuffers);
+        for (int i = 0; i < STAGING_BUFFERS; i++) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffers[i]);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, bytesPerFrame, NULL, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        const unsigned char grey[4] = { 128, 128, 128, 255 };
+        glGenTextures(1, &placeholder);
+        glBindTexture(GL_TEXTURE_2D, placeholder);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glGenTextures(1, &placeholderArray);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, placeholderArray);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, 1, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        if (workerCount <= 0) {
+            int cores = (int)std::thread::hardware_concurrency();
+            workerCount = cores > 1 ? cores - 1 : 1;
+        }
+        stopping = false;
+        for (int i = 0; i < workerCount; i++) {
+            workers.emplace_back(&TextureStreamer::workerLoop, this);
+        }
+    }
+
+    // Cooked textures are looked up here first, by the same path load() gets; must outlive the streamer
+    void setArchive(const AssetArchive* assetArchive) {
+        archive = assetArchive;
+    }
+
+    // Queues a file for loading and returns its id; get(id) is valid immediately
+    int load(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Texture texture;
+        texture.paths.push_back(path);
+        textures.push_back(texture);
+        int id = (int)textures.size() - 1;
+        jobs.push_back({ id, 0 });
+        outstanding++;
+        wake.notify_one();
+        return id;
+    }
+
+    // Queues a GL_TEXTURE_2D_ARRAY with one layer per file, every layer width x height (RGBA8).
+    // A layer that fails to load stays black; the others still become resident.
+    int loadArray(const std::vector<std::string>& paths, int width, int height) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Texture texture;
+        texture.paths = paths;
+        texture.target = GL_TEXTURE_2D_ARRAY;
+        texture.width = width;
+        texture.height = height;
+        texture.layersRemaining = (int)paths.size();
+        textures.push_back(texture);
+        int id = (int)textures.size() - 1;
+        for (int layer = 0; layer < (int)paths.size(); layer++) {
+            jobs.push_back({ id, layer });
+        }
+        outstanding++;
+        wake.notify_all();
+        return id;
+    }
+
+    // Texture to bind for id: the real one once every level is resident, else the placeholder
+    GLuint get(int id) const {
+        if (id < 0 || id >= (int)textures.size()) return placeholder;
+        const Texture& texture = textures[id];
+        if (!texture.resident) return texture.target == GL_TEXTURE_2D_ARRAY ? placeholderArray : placeholder;
+        return texture.texture;
+    }
+
+    // Textures that are not resident yet (decoding or uploading)
+    int getPendingCount() const {
+        return outstanding;
+    }
+
+    // Render thread, once per frame. Never waits on the GPU: if the next staging buffer is
+    // still in use, uploading resumes next frame.
+    void update() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const Job& job : failed) {
+                printf("Failed to load texture %s, keeping placeholder\n", textures[job.id].paths[job.layer].c_str());
+                finishLayer(job.id);
+            }
+            failed.clear();
+            while (!decoded.empty()) {
+                Upload upload = std::move(decoded.front());
+                decoded.pop_front();
+                if (!isFormatSupported(upload.data)) {
+                    printf("Texture format 0x%x not supported by this driver, keeping placeholder: %s\n",
+                           upload.data.internalFormat, textures[upload.id].paths[upload.layer].c_str());
+                    finishLayer(upload.id);
+                    continue;
+                }
+                allocate(textures[upload.id], upload.data);
+                uploads.push_back(std::move(upload));
+            }
+        }
+        if (uploads.empty()) return;
+
+        int slot = currentBuffer;
+        if (fences[slot]) {
+            if (glClientWaitSync(fences[slot], 0, 0) == GL_TIMEOUT_EXPIRED) return;
+            glDeleteSync(fences[slot]);
+            fences[slot] = 0;
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffers[slot]);
+        unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytesPerFrame,
+                                                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!mapped) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return;
+        }
+
+        // Copy whole rows into the staging buffer until the budget runs out (the budget must hold at least one row)
+        std::vector<SubImage> subImages;
+        size_t completed = 0;
+        GLsizeiptr used = 0;
+        for (auto& upload : uploads) {
+            while (upload.level < (int)upload.data.levels.size()) {
+                const TextureLevel& level = upload.data.levels[upload.level];
+                size_t bytesPerRow = rowBytes(upload.data, level);
+                int remaining = rowCount(upload.data, level) - upload.row;
+                int rows = (int)((bytesPerFrame - used) / bytesPerRow);
+                if (rows == 0) break;
+                if (rows > remaining) rows = remaining;
+                memcpy(mapped + used, upload.data.data() + level.offset + upload.row * bytesPerRow, rows * bytesPerRow);
+                const Texture& texture = textures[upload.id];
+                subImages.push_back({ texture.texture, texture.target, &upload.data, upload.layer, upload.level, upload.row, rows, used });
+                used += (GLsizeiptr)((rows * bytesPerRow + 15) & ~(size_t)15);
+                upload.row += rows;
+                if (upload.row == rowCount(upload.data, level)) {
+                    upload.level++;
+                    upload.row = 0;
+                }
+            }
+            if (upload.level < (int)upload.data.levels.size()) break;
+            completed++;
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        for (const auto& sub : subImages) {
+            const TextureLevel& level = sub.data->levels[sub.level];
+            glBindTexture(sub.target, sub.texture);
+            if (sub.target == GL_TEXTURE_2D_ARRAY) {
+                glTexSubImage3D(sub.target, sub.level, 0, sub.row, sub.layer, level.width, sub.rows, 1, sub.data->format, sub.data->type, (const void*)sub.offset);
+            } else if (sub.data->blockBytes) {
+                // Block rows: y and height in texels, the last block row may be partial
+                int y = sub.row * 4;
+                int height = sub.rows * 4 < level.height - y ? sub.rows * 4 : level.height - y;
+                glCompressedTexSubImage2D(GL_TEXTURE_2D, sub.level, 0, y, level.width, height, sub.data->internalFormat,
+                                          (GLsizei)(sub.rows * rowBytes(*sub.data, level)), (const void*)sub.offset);
+            } else {
+                glTexSubImage2D(GL_TEXTURE_2D, sub.level, 0, sub.row, level.width, sub.rows, sub.data->format, sub.data->type, (const void*)sub.offset);
+            }
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        currentBuffer = (slot + 1) % STAGING_BUFFERS;
+
+        for (size_t i = 0; i < completed; i++) {
+            finishLayer(uploads.front().id);
+            uploads.pop_front();
+        }
+    }
+
+    void destroy() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+        workers.clear();
+        for (int i = 0; i < STAGING_BUFFERS; i++) {
+            if (fences[i]) glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+        glDeleteBuffers(STAGING_BUFFERS, stagingBuffers);
+        for (auto& texture : textures) {
+            if (texture.texture) glDeleteTextures(1, &texture.texture);
+        }
+        textures.clear();
+        uploads.clear();
+        if (placeholder) glDeleteTextures(1, &placeholder);
+        if (placeholderArray) glDeleteTextures(1, &placeholderArray);
+        placeholder = placeholderArray = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,121 @@
+// nexyl-cook: converts a source asset folder into one packed archive for the engine.
+// Usage: nexyl-cook <source-dir> <output.pak> [--threads N]
+//   *.bmp              -> BC1/BC3 DDS with full mip chain
+//   *.obj/.gltf/.glb   -> welded, cache-optimized indexed mesh in engine vertex layout with QEM LODs
+//   *.glsl/.vert/.frag -> shader source with #include expanded
+// Entries are named by their path relative to source-dir, so the engine finds them under
+// the same names it would use for loose files.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <filesystem>
+#include "image_loader.hpp"
+#include "bc_encoder.hpp"
+#include "compressed_texture.hpp"
+#include "mesh_data.hpp"
+#include "mesh_import.hpp"
+#include "mesh_simplify.hpp"
+#include "shader_source.hpp"
+#include "asset_archive.hpp"
+
+// Simplified levels per mesh; the engine draws the base mesh plus these (NUM_LODS = 3)
+static const int MESH_COOK_LODS = 2;
+
+struct CookJob {
+    std::string path; // On disk
+    std::string name; // In the archive
+    AssetType type;
+};
+
+// Runs one job; encoderThreads is how many threads the texture encoder or simplifier may use
+static bool cookAsset(const CookJob& job, int encoderThreads, std::vector<unsigned char>& out) {
+    if (job.type == ASSET_TEXTURE) {
+        Image image;
+        if (!decodeBMP(job.path.c_str(), image)) return false;
+        CompressedImage compressed;
+        compressImage(image, compressed, encoderThreads);
+        writeDDS(compressed, out);
+        return true;
+    }
+    if (job.type == ASSET_MESH) {
+        MeshData mesh;
+        if (!importMesh(job.path.c_str(), mesh)) return false;
+        generateMeshLODs(mesh, MESH_COOK_LODS, encoderThreads);
+        writeMeshBlob(mesh, out);
+        return true;
+    }
+    std::string source;
+    if (!loadShaderSource(job.path, source)) return false;
+    out.assign(source.begin(), source.end());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printf("Usage: %s <source-dir> <output.pak> [--threads N]\n", argv[0]);
+        return 1;
+    }
+    std::filesystem::path sourceDir = argv[1];
+    std::string outputPath = argv[2];
+    int threadCount = (int)std::thread::hardware_concurrency();
+    for (int i = 3; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--threads") threadCount = atoi(argv[++i]);
+    }
+    if (threadCount < 1) threadCount = 1;
+
+    std::vector<CookJob> jobs;
+    std::error_code error;
+    for (auto it = std::filesystem::recursive_directory_iterator(sourceDir, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+        if (!it->is_regular_file()) continue;
+        std::string extension = it->path().extension().string();
+        CookJob job;
+        job.path = it->path().string();
+        job.name = std::filesystem::relative(it->path(), sourceDir).generic_string();
+        if (extension == ".bmp") job.type = ASSET_TEXTURE;
+        else if (extension == ".obj" || extension == ".gltf" || extension == ".glb") job.type = ASSET_MESH;
+        else if (extension == ".glsl" || extension == ".vert" || extension == ".frag") job.type = ASSET_SHADER;
+        else continue;
+        jobs.push_back(job);
+    }
+    if (error) {
+        printf("Failed to read %s: %s\n", sourceDir.string().c_str(), error.message().c_str());
+        return 1;
+    }
+
+    // Assets are cooked in parallel; with fewer assets than threads the spare threads go to the encoder
+    auto start = std::chrono::steady_clock::now();
+    int workerCount = (int)jobs.size() < threadCount ? (int)jobs.size() : threadCount;
+    int encoderThreads = workerCount > 0 ? threadCount / workerCount : 1;
+    AssetArchiveWriter writer;
+    std::mutex writerMutex;
+    std::atomic<int> next(0);
+    std::atomic<int> failures(0);
+    auto worker = [&]() {
+        for (int i = next.fetch_add(1); i < (int)jobs.size(); i = next.fetch_add(1)) {
+            std::vector<unsigned char> data;
+            if (!cookAsset(jobs[i], encoderThreads, data)) {
+                printf("Failed to cook %s\n", jobs[i].path.c_str());
+                failures++;
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(writerMutex);
+            printf("Cooked %s (%zu bytes)\n", jobs[i].name.c_str(), data.size());
+            writer.add(jobs[i].name, jobs[i].type, std::move(data));
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workerCount; i++) threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads) t.join();
+
+    if (!writer.write(outputPath)) return 1;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Wrote %zu assets to %s in %.2f s (%d failed)\n", writer.getEntryCount(), outputPath.c_str(), seconds, failures.load());
+    return failures > 0 ? 1 : 0;
+}
@@ -1,46 +1,177 @@
 #version 330 core
+// Варианты собираются с #define из shader_variants.hpp:
+// LIT, LIGHT_PROXY, OUTLINE, GIZMO, DEPTH_ONLY, IMPOSTOR_BAKE
+// (+ LIGHTMAP, PROBES для LIT, LOD_FADE, IMPOSTOR, GPU_DRIVEN и OBJECT_ID для инстансов)
 layout (location = 0) in vec3 aPos;
+
+#include "constants.glsl"
+
+#ifdef GIZMO
+// Раскладка гизмо: позиция + цвет, матрица модели на весь вызов
+layout (location = 2) in vec3 aColor;
+uniform mat4 gizmoModel;
+out vec3 GizmoColor;
+#elif defined(GPU_DRIVEN)
+// Ссылка (экземпляр, fade) из списков отсечения на GPU (cull.glsl), данные — из буфера текстуры
+layout (location = 13) in uvec2 instanceRef;
+uniform samplerBuffer instanceData; // INSTANCE_DATA_TEXELS на экземпляр, см. gpu_culling.hpp
+uniform usamplerBuffer selectionBits; // бит на id объекта, см. selection_set.hpp
+uniform int hoveredObjectId;
+mat4 instanceModel;
+vec4 instanceLightmapRect;
+vec4 instanceMaterial;
+float instanceSelected;
+float instanceFade;
+int instanceObjectId;
+
+void fetchInstance() {
+    int base = int(instanceRef.x) * 7;
+    instanceModel = mat4(texelFetch(instanceData, base), texelFetch(instanceData, base + 1),
+                         texelFetch(instanceData, base + 2), texelFetch(instanceData, base + 3));
+    instanceLightmapRect = texelFetch(instanceData, base + 4);
+    instanceMaterial = texelFetch(instanceData, base + 5);
+    instanceObjectId = floatBitsToInt(texelFetch(instanceData, base + 6).x);
+    bool selected = ((texelFetch(selectionBits, instanceObjectId >> 5).r >> uint(instanceObjectId & 31)) & 1u) != 0u;
+    instanceSelected = selected ? 1.0 : (instanceObjectId == hoveredObjectId ? 0.5 : 0.0);
+    instanceFade = uintBitsToFloat(instanceRef.y);
+}
+#else
+layout (location = 3) in mat4 instanceModel;
+#endif
+
+#ifdef IMPOSTOR_BAKE
+// Запекание атласа импостора: меш в пространстве объекта, вид кадра задаётся явно
 layout (location = 1) in vec2 aTexCoord;
 layout (location = 2) in vec3 aNormal;
-layout (location = 3) in mat4 instanceModel;
-layout (location = 7) in float instanceSelected;
-layout (location = 8) in float instanceIsLightSource;
-layout (location = 9) in float instanceLightIntensity;
-// Новые атрибуты для гизмо
-layout (location = 2) in vec3 aColor; // Цвет гизмо (если используется)
-layout (location = 3) in float aGizmoType; // Тип гизмо
-
-layout (std140) uniform Matrices {
-    mat4 projection;
-    mat4 view;
-};
+uniform mat4 impostorViewProjection;
+out vec2 TexCoord;
+out vec3 Normal;
+#endif
+
+#ifdef IMPOSTOR
+// aPos.xy — угол квадрата в [-1, 1]
+uniform float impostorRadius;
+uniform int impostorGrid;
+out vec2 ImpostorUV;
+flat out mat3 ImpostorRotation;
+
+// Octahedral map, same as octahedralDirection() in impostors.hpp
+vec3 impostorDirection(vec2 e) {
+    vec3 d = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (d.z < 0.0) d.xy = (1.0 - abs(d.yx)) * vec2(d.x >= 0.0 ? 1.0 : -1.0, d.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(d);
+}
+
+vec2 impostorEncode(vec3 d) {
+    d /= abs(d.x) + abs(d.y) + abs(d.z);
+    if (d.z < 0.0) d.xy = (1.0 - abs(d.yx)) * vec2(d.x >= 0.0 ? 1.0 : -1.0, d.y >= 0.0 ? 1.0 : -1.0);
+    return d.xy;
+}
+
+// Ближайший к направлению взгляда кадр атласа; квадрат ориентирован так же, как кадр при запекании
+vec3 impostorCorner(mat4 model) {
+    float scale = length(model[0].xyz);
+    mat3 rotation = mat3(model) / scale;
+    vec3 toViewer = normalize(transpose(rotation) * (viewPos - model[3].xyz));
+    vec2 cell = clamp(floor((impostorEncode(toViewer) * 0.5 + 0.5) * float(impostorGrid)), 0.0, float(impostorGrid - 1));
+    vec3 frameDir = impostorDirection((cell + 0.5) / float(impostorGrid) * 2.0 - 1.0);
+    vec3 up = abs(frameDir.y) > 0.99 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(-frameDir, up));
+    up = cross(right, -frameDir);
+    ImpostorUV = (cell + aPos.xy * 0.5 + 0.5) / float(impostorGrid);
+    ImpostorRotation = rotation;
+    return (right * aPos.x + up * aPos.y) * impostorRadius;
+}
+#endif
 
+#ifdef LIT
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec3 aNormal;
 out vec2 TexCoord;
 out vec3 Normal;
 out vec3 FragPos;
-out float isSelected;
-out float isLightSource;
-out float lightIntensity;
-// Переменные для гизмо
-out vec3 GizmoColor;
-out float GizmoType;
+#ifndef GPU_DRIVEN
+layout (location = 11) in vec4 instanceMaterial; // (слой material_diffuse, tint.rgb)
+#endif
+flat out vec4 Material;
+#endif
+
+#ifdef LIGHTMAP
+#ifndef GPU_DRIVEN
+layout (location = 10) in vec4 instanceLightmapRect; // (u0, v0, texelsPerFace, baked)
+#endif
+out vec3 LocalPos;
+flat out vec4 LightmapRect;
+#endif
+
+#ifdef OUTLINE
+#ifndef GPU_DRIVEN
+layout (location = 7) in float instanceSelected; // 1 — выбран, 0.5 — под курсором
+#endif
+flat out float isSelected;
+#endif
+
+#ifdef OBJECT_ID
+#ifndef GPU_DRIVEN
+layout (location = 14) in int instanceObjectId;
+#endif
+flat out int ObjectId;
+#endif
+
+#ifdef LOD_FADE
+#ifndef GPU_DRIVEN
+layout (location = 12) in float instanceFade; // f: новый уровень, f - 1: старый
+#endif
+flat out float LodFade;
+#endif
 
 void main() {
+#if defined(GIZMO)
+    gl_Position = viewProjection * gizmoModel * vec4(aPos, 1.0);
+    GizmoColor = aColor;
+#elif defined(IMPOSTOR_BAKE)
+    gl_Position = impostorViewProjection * vec4(aPos, 1.0);
+    TexCoord = aTexCoord;
+    Normal = aNormal;
+#else
+#ifdef GPU_DRIVEN
+    fetchInstance();
+#endif
     mat4 model = instanceModel;
-    mat4 mvp = projection * view * model;
-    gl_Position = mvp * vec4(aPos, 1.0);
-    
+#ifdef IMPOSTOR
+    vec3 localPos = impostorCorner(model);
+#else
+    vec3 localPos = aPos;
+#endif
+    gl_Position = viewProjection * model * vec4(localPos, 1.0);
+#if defined(GPU_DRIVEN) && !defined(LOD_FADE)
+    // Список перехода без дизеринга (LOD_FADE ещё собирается): уходящий уровень (fade < 0) за пределы отсечения
+    if (instanceFade < 0.0) gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+#endif
+#endif
+
+#ifdef LIT
     TexCoord = aTexCoord;
-    
     mat3 normalMatrix = mat3(transpose(inverse(model)));
     Normal = normalMatrix * aNormal;
-    
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    FragPos = vec3(model * vec4(localPos, 1.0));
+    Material = instanceMaterial;
+#endif
+
+#ifdef LIGHTMAP
+    LocalPos = aPos;
+    LightmapRect = instanceLightmapRect;
+#endif
+
+#ifdef OUTLINE
     isSelected = instanceSelected;
-    isLightSource = instanceIsLightSource;
-    lightIntensity = instanceLightIntensity;
-    
-    // Передаем данные для гизмо
-    GizmoColor = aColor;
-    GizmoType = aGizmoType;
+#endif
+
+#ifdef OBJECT_ID
+    ObjectId = instanceObjectId;
+#endif
+
+#ifdef LOD_FADE
+    LodFade = instanceFade;
+#endif
 }